@@ -152,6 +152,7 @@ typedef struct app_s {
     double paint_time; // last paint duration in seconds
     double paint_max;  // max of last 128 paint
     double paint_avg;  // EMA of last 128 paints
+    int32_t paint_culled; // views (with culled subtrees) skipped by last paint
 } app_t;
 
 extern app_t app;
@@ -29,6 +29,17 @@ begin_c
 #define color_hdr_g(c)    (((c) >> 16) & 0xFFFF)
 #define color_hdr_b(c)    (((c) >> 32) & 0xFFFF)
 
+// r, g, b, a in range [0..0xFFFF] (a is stored with 14 bit precision)
+#define color_hdr_rgba(r, g, b, a) ((ui_color_t)(color_hdr |   \
+    (uint64_t)(uint16_t)(r) | ((uint64_t)(uint16_t)(g) << 16) | \
+    ((uint64_t)(uint16_t)(b) << 32) |                           \
+    ((uint64_t)((uint16_t)(a) >> 2) << 48)))
+
+// nearest 8 bit rgb() of hdr color (alpha is dropped)
+#define color_hdr_to_rgb(c) rgb((color_hdr_r(c) * 255 + 32767) / 65535, \
+                                (color_hdr_g(c) * 255 + 32767) / 65535, \
+                                (color_hdr_b(c) * 255 + 32767) / 65535)
+
 #define rgb(r,g,b) ((ui_color_t)(((uint8_t)(r) | ((uint16_t)((uint8_t)(g))<<8)) | \
     (((uint32_t)(uint8_t)(b))<<16)))
 #define rgba(r, g, b, a) (ui_color_t)((rgb(r, g, b)) | (((uint8_t)a) << 24))
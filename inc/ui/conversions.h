@@ -0,0 +1,39 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Pixel format conversion kernels on raw buffers.
+// Spans of `n` pixels are converted from source `s` to destination `d`.
+// Same size pixel formats can be converted in place (d == s).
+// Vectorized with SSE2 on x64 and NEON on arm64, plain C elsewhere.
+// Premultiplication rounds exactly: round(c * alpha / 255).
+// Large images are converted in parallel horizontal bands (see bands())
+// with output identical to single threaded conversion.
+
+typedef void (*conversions_span_t)(uint8_t* d, const uint8_t* s, int32_t n);
+
+typedef struct {
+    // RGB <-> BGR 3 bytes per pixel:
+    void (*swap_rb3)(uint8_t* d, const uint8_t* s, int32_t n);
+    // RGBX -> BGRA and BGRX -> BGRA with alpha = 0xFF:
+    void (*rgbx_to_bgra)(uint8_t* d, const uint8_t* s, int32_t n);
+    void (*bgrx_to_bgra)(uint8_t* d, const uint8_t* s, int32_t n);
+    // RGBA -> premultiplied BGRA and BGRA -> premultiplied BGRA:
+    void (*rgba_premultiply)(uint8_t* d, const uint8_t* s, int32_t n);
+    void (*bgra_premultiply)(uint8_t* d, const uint8_t* s, int32_t n);
+    // 8 bit greyscale -> BGRA with alpha = 0xFF:
+    void (*grey_to_bgra)(uint8_t* d, const uint8_t* s, int32_t n);
+    // applies span to `h` rows of `w` pixels, strides are in bytes:
+    void (*rows)(conversions_span_t span, uint8_t* d, int32_t d_stride,
+                 const uint8_t* s, int32_t s_stride, int32_t w, int32_t h);
+    // calls band() for horizontal bands [y0..y1) covering [0..h).
+    // Above 512K pixels bands run in parallel on thread pool workers
+    // and the calling thread; band() must only write its own rows.
+    void (*bands)(void* that, void (*band)(void* that, int32_t y0, int32_t y1),
+                  int32_t w, int32_t h);
+} conversions_if;
+
+extern conversions_if conversions;
+
+end_c
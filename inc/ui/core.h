@@ -23,6 +23,7 @@ typedef struct image_s {
     int32_t stride; // bytes per scanline rounded up to: (w * bpp + 3) & ~3
     ui_bitmap_t bitmap;
     void* pixels;
+    struct image_s* mip; // lazily built half size BGRA copy or null
 } image_t;
 
 typedef struct dpi_s { // max(dpi_x, dpi_y)
@@ -98,6 +99,7 @@ typedef struct ui_s {
         int32_t const tap;
         int32_t const dtap;
         int32_t const press;
+        int32_t const loaded; // images decoded (see loader.h)
    } message;
    struct { // mouse buttons bitset mask
         struct {
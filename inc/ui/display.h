@@ -0,0 +1,54 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Display lists: recorded sequences of gdi.* drawing calls.
+//
+// display.record(&list) starts appending gdi.* calls made on the calling
+// thread to the list until display.stop(). Calls are still executed
+// while recording, so the frame is drawn as usual. display.replay()
+// executes recorded calls again translated by (dx, dy) without calling
+// the code that produced them (text formatting, layout math, etc).
+//
+// display.paint(&list, view, key) is paint() with caching: it replays
+// the list if the view size and application supplied `key` (hash of
+// the view content) did not change since it was recorded and otherwise
+// records view->paint(view) again. Only drawing done by view->paint()
+// itself is cached, children are painted by app as usual.
+//
+// Recorded are state changes (colors, pens, brushes, fonts, clip,
+// push/pop) and primitives including text already formatted. Fonts,
+// pens, brushes, images and pixels are recorded by reference and must
+// outlive the list; lists are not portable between processes.
+// Drawing redirected into images by raster.begin() is not recorded.
+
+typedef struct display_list_s display_list_t;
+
+typedef struct display_list_s {
+    uint8_t* data;  // commands
+    int64_t bytes;  // used
+    int64_t capacity;
+    int32_t x; // view->x, view->y, w, h at the time of recording
+    int32_t y;
+    int32_t w;
+    int32_t h;
+    uint64_t key; // see display.paint()
+    int32_t commands; // number of recorded commands
+    display_list_t* previous; // nested display.record()
+} display_list_t;
+
+typedef struct {
+    void (*record)(display_list_t* list); // clears the list
+    void (*stop)(void);
+    void (*replay)(const display_list_t* list, int32_t dx, int32_t dy);
+    void (*paint)(display_list_t* list, ui_view_t* view, uint64_t key);
+    bool (*equal)(const display_list_t* a, const display_list_t* b);
+    // load() copies and validates previously recorded list data:
+    errno_t (*load)(display_list_t* list, const uint8_t* data, int64_t bytes);
+    void (*dispose)(display_list_t* list);
+} display_if;
+
+extern display_if display;
+
+end_c
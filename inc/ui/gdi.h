@@ -15,16 +15,104 @@ enum {
     gdi_font_quality_cleartype_natural = 6
 };
 
+enum {
+    gdi_mipmap_off   = 0,
+    gdi_mipmap_box   = 1, // 2x2 average of stored values
+    gdi_mipmap_gamma = 2  // 2x2 average in linear light (slower to build)
+};
+
+typedef struct gdi_counters_s {
+    int32_t state_changes;   // pen, brush, font, colors and clip changes
+    int32_t state_elided;    // redundant changes skipped
+    int32_t objects_created; // pens and brushes created
+    int32_t objects_reused;  // create_pen() and create_brush() cache hits
+} gdi_counters_t;
+
+// Render context of a thread drawing with Win32 GDI into its own DC
+// (e.g. memory DC with image.bitmap selected). gdi.begin(&context, dc)
+// directs gdi.* drawing calls made on the calling thread into dc with
+// the context's own pen position, push()/pop() stack, clip rectangles,
+// state cache and counters until gdi.end(). Threads without context
+// (the UI thread) draw on app.canvas using gdi.x, gdi.y and
+// gdi.counters. Worker threads rendering independent tiles each begin()
+// their own context and use move_to() or position() instead of gdi.x, y.
+// Pens and brushes cache, fonts and measurements are shared.
+// The context is ~24KB (push() stack): prefer static or heap storage.
+
+typedef struct gdi_state_s { // known state of canvas inside push()/pop()
+    ui_canvas_t dc;
+    int32_t x; // pen position saved by push()
+    int32_t y;
+    ui_pen_t pen;     // null if unknown
+    ui_brush_t brush;
+    ui_font_t font;
+    int64_t pen_color;   // DC_PEN color or -1 if unknown
+    int64_t brush_color; // DC_BRUSH color or -1 if unknown
+    int64_t text_color;  // -1 if unknown
+    ui_rect_t clip;      // set_clip() rectangle {0, 0, 0, 0} no clipping
+    bool clip_known;
+    ui_rect_t visible;   // bounds and clip intersection
+} gdi_state_t;
+
+typedef struct gdi_xy_s { // pen position of the calling thread
+    int32_t* x;
+    int32_t* y;
+} gdi_xy_t;
+
+typedef struct gdi_context_s gdi_context_t;
+
+typedef struct gdi_context_s {
+    ui_canvas_t canvas; // render target
+    int32_t x; // instead of gdi.x
+    int32_t y; // instead of gdi.y
+    ui_rect_t bounds; // canvas clip box at outermost push() (damaged area)
+    gdi_counters_t counters;   // instead of gdi.counters
+    gdi_counters_t last_frame; // instead of gdi.last_frame
+    gdi_state_t state;
+    gdi_state_t stack[256]; // saved by push()
+    int32_t top;
+    ui_canvas_t memory; // memory DC for blitting images
+    ui_bitmap_t bitmap; // selected into canvas at begin() (image drawn into)
+    gdi_context_t* previous; // nested begin()
+} gdi_context_t;
+
+typedef struct gdi_measure_stats_s {
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions;
+} gdi_measure_stats_t;
+
 typedef struct gdi_s {
     ui_brush_t  brush_color;
     ui_brush_t  brush_hollow;
     ui_pen_t pen_hollow;
-    ui_region_t clip;
+    // Inside outermost push()/pop() (app paint) gdi tracks the state of
+    // app.canvas and skips set_*() calls that do not change it.
+    // Pens and brushes are cached by (color, width): create_pen() may
+    // return the same pen again and delete_pen() of cached pen is no-op.
+    gdi_counters_t counters;   // since outermost push()
+    gdi_counters_t last_frame; // counters at last outermost pop()
+    // per thread render context (see gdi_context_t above):
+    void (*begin)(gdi_context_t* context, ui_canvas_t canvas);
+    void (*end)(void);
+    gdi_context_t* (*current)(void); // null when drawing on app.canvas
+    // &gdi.x, &gdi.y or pen position of current gdi or raster context:
+    gdi_xy_t (*position)(void);
     // bpp bytes (not bits!) per pixel. bpp = -3 or -4 does not swap RGB to BRG:
     void (*image_init)(image_t* image, int32_t w, int32_t h, int32_t bpp,
         const uint8_t* pixels);
     void (*image_init_rgbx)(image_t* image, int32_t w, int32_t h,
         int32_t bpp, const uint8_t* pixels); // sets all alphas to 0xFF
+    // reconverts pixels of the same w, h and bpp into existing image:
+    void (*image_update)(image_t* image, int32_t bpp, const uint8_t* pixels);
+    // image_invalidate() drops scaled copies after image.pixels were
+    // modified directly (see image_filter below):
+    void (*image_invalidate)(image_t* image);
+    // image_acquire() reuses bitmap of released image with the same w, h
+    // and bpp (pixels are undefined) use image_update() to fill it;
+    // image_release() returns bitmap to the pool instead of deleting it
+    void (*image_acquire)(image_t* image, int32_t w, int32_t h, int32_t bpp);
+    void (*image_release)(image_t* image);
     void (*image_dispose)(image_t* image);
     ui_color_t (*set_text_color)(ui_color_t c);
     ui_brush_t (*create_brush)(ui_color_t c);
@@ -37,8 +125,18 @@ typedef struct gdi_s {
     void  (*delete_pen)(ui_pen_t p);
     void (*set_clip)(int32_t x, int32_t y, int32_t w, int32_t h);
     // use set_clip(0, 0, 0, 0) to clear clip region
-    void (*push)(int32_t x, int32_t y); // also calls SaveDC(app.canvas)
-    void (*pop)(void); // also calls RestoreDC(-1, app.canvas)
+    // Inside push()/pop() clipping is tracked as integer rectangles
+    // saved by push() and restored by pop() (no regions are created).
+    // intersect_clip() narrows the clip to its intersection with
+    // (x, y, w, h) until matching pop(). visible() is false when
+    // (x, y, w, h) is entirely outside of the clip (and the area that
+    // canvas was clipped to at outermost push(), e.g. WM_PAINT damaged
+    // rectangle) thus drawing it can be skipped. Outside push()/pop()
+    // visible() is always true.
+    void (*intersect_clip)(int32_t x, int32_t y, int32_t w, int32_t h);
+    bool (*visible)(int32_t x, int32_t y, int32_t w, int32_t h);
+    void (*push)(int32_t x, int32_t y); // also calls SaveDC(canvas)
+    void (*pop)(void); // also calls RestoreDC(-1, canvas)
     void (*pixel)(int32_t x, int32_t y, ui_color_t c);
     ui_point_t (*move_to)(int32_t x, int32_t y); // returns previous (x, y)
     void (*line)(int32_t x, int32_t y); // line to x, y with gdi.pen moves x, y
@@ -50,6 +148,9 @@ typedef struct gdi_s {
                       ui_color_t border, ui_color_t fill);
     void (*fill_with)(int32_t x, int32_t y, int32_t w, int32_t h, ui_color_t c);
     void (*poly)(ui_point_t* points, int32_t count);
+    // polygon() filled with gdi.brush only (outline with poly()), rule:
+    // polyfill_even_odd or polyfill_non_zero (see polyfill.h)
+    void (*polygon)(ui_point_t* points, int32_t count, int32_t rule);
     void (*rounded)(int32_t x, int32_t y, int32_t w, int32_t h,
         int32_t rx, int32_t ry); // see RoundRect, pen, brush
     void (*gradient)(int32_t x, int32_t y, int32_t w, int32_t h,
@@ -70,6 +171,19 @@ typedef struct gdi_s {
         image_t* image, double alpha);
     void (*draw_image)(int32_t x, int32_t y, int32_t w, int32_t h,
         image_t* image);
+    // draw_image() of bpp 3 and 4 images at other than natural size
+    // blits copy scaled once with resample.bgra(image_filter) and cached
+    // until image_update(), image_release() or image_dispose() or until
+    // the image is drawn into (begin() on DC with image.bitmap selected,
+    // raster.begin()). After writing image.pixels directly call
+    // image_invalidate(). resample_auto by default, -1 StretchBlt() on
+    // each call:
+    int32_t image_filter;
+    // shrinking to half size or less resamples from the nearest level of
+    // image.mip chain (each level built once by resample.half() and
+    // dropped together with the scaled copies, when the image is drawn
+    // into as well). gdi_mipmap_box by default:
+    int32_t image_mipmap;
     // text:
     void (*cleartype)(bool on);
     void (*font_smoothing_contrast)(int32_t c); // [1000..2202] or -1 for 1400 default
@@ -90,6 +204,20 @@ typedef struct gdi_s {
     // width can be -1 which measures text with "\n" or
     // positive number of pixels
     ui_point_t (*measure_multiline)(ui_font_t f, int32_t w, const char* format, ...);
+    // measure_text() and measure_multiline() results are kept in bounded
+    // LRU cache keyed by font, width, flags and formatted text hash.
+    // delete_font() invalidates it, call measure_invalidate() after
+    // fonts are recreated (e.g. on DPI change) or modified in place.
+    void (*measure_invalidate)(void);
+    // n bytes of UTF-8 text without printf formatting:
+    ui_point_t (*measure_text_n)(ui_font_t f, const char* s, int32_t n);
+    // measure_offsets() x[k] is the offset of the end of k-th code point
+    // of n bytes of UTF-8 text, x[0] = 0, from a single measurement of
+    // the whole text (fractional advances are not rounded per glyph).
+    // Fills at most count + 1 offsets, returns number of code points:
+    int32_t (*measure_offsets)(ui_font_t f, const char* s, int32_t n,
+        int32_t* x, int32_t count);
+    gdi_measure_stats_t measure_stats;
     double height_multiplier; // see line_spacing()
     double (*line_spacing)(double height_multiplier); // default 1.0
     int32_t x; // incremented by text, print
@@ -100,6 +228,9 @@ typedef struct gdi_s {
     // gdi.y += height * line_spacing
     void (*vtextln)(const char* format, va_list vl);
     void (*textln)(const char* format, ...);
+    // n bytes of UTF-8 text without printf formatting:
+    void (*text_n)(const char* s, int32_t n);   // x += width
+    void (*textln_n)(const char* s, int32_t n); // y += height * line_spacing
     // mono:
     void (*vprint)(const char* format,va_list vl); // x += width
     void (*print)(const char* format, ...);        // x += width
@@ -0,0 +1,44 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Streaming animated GIF decoder.
+//
+// gif.open() parses the header and counts frames without decoding them.
+// A worker thread decodes frames in order, one at a time, into a small
+// ring of reusable w x h premultiplied BGRA buffers, prefetching up to
+// gif_ring - 1 frames ahead of the consumer. Frame disposal and partial
+// (delta) frames are applied incrementally to a single composed canvas,
+// thus memory does not depend on the number of frames. Animation loops
+// forever: after the last frame decoding restarts from the first one.
+//
+// gif.next() returns the next frame in order and recycles the buffer of
+// the frame returned by the previous call. It only waits if the frame
+// has not been prefetched yet. Single consumer thread.
+// Data must stay valid (e.g. mapped) until gif.close().
+
+enum { gif_ring = 3 };
+
+typedef struct gif_frame_s {
+    const uint32_t* pixels; // [h][w] premultiplied BGRA, alpha 0 or 0xFF
+    int32_t index; // 0..frames - 1
+    int32_t delay; // milliseconds
+} gif_frame_t;
+
+typedef struct gif_s {
+    int32_t w; // logical screen
+    int32_t h;
+    int32_t frames;
+    struct gif_stream_s* stream; // decoder state and ring
+} gif_t;
+
+typedef struct {
+    errno_t (*open)(gif_t* g, const uint8_t* data, int64_t bytes);
+    const gif_frame_t* (*next)(gif_t* g);
+    void (*close)(gif_t* g);
+} gif_if;
+
+extern gif_if gif;
+
+end_c
@@ -0,0 +1,49 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Glyph atlas text renderer for software rendering into image_t.
+//
+// TrueType fonts are rasterized with stb_truetype (stb submodule).
+// Coverage masks are rendered once per (glyph, 1/4 pixel horizontal
+// phase) into an 8 bit atlas owned by the font and blended into BGRA
+// (bpp == 4) pixels. Pen position advances in fractional pixels, so
+// glyphs are positioned with subpixel precision. Like DrawTextW() no
+// kerning is applied. When the atlas is full it is cleared and refilled
+// on demand.
+//
+// No Win32 GDI is involved: a font can be used by several threads
+// drawing into different images concurrently.
+// Set raster_context_t.glyphs to draw gdi.text*() with glyphs instead
+// of DrawTextW() inside raster.begin()/end().
+
+typedef struct glyphs_font_s glyphs_font_t;
+
+typedef struct glyphs_stats_s {
+    int64_t hits;   // glyph found in atlas
+    int64_t misses; // glyph rasterized
+    int64_t resets; // atlas was full
+} glyphs_stats_t;
+
+typedef struct {
+    // ttf data must stay valid until dispose(), height in pixels:
+    glyphs_font_t* (*create)(const void* ttf, int64_t bytes, int32_t height);
+    void (*dispose)(glyphs_font_t* f);
+    int32_t (*height)(glyphs_font_t* f);   // line height in pixels
+    int32_t (*baseline)(glyphs_font_t* f); // ascent in pixels
+    // n bytes of UTF-8 text, "\n" starts new line, returns {w, h} extent
+    ui_point_t (*measure)(glyphs_font_t* f, const char* s, int32_t n);
+    // draws text with top left corner at x, y into bpp == 4 image
+    // clipped by `clip` (null for the whole image):
+    ui_point_t (*draw)(glyphs_font_t* f, image_t* image, const ui_rect_t* clip,
+        int32_t x, int32_t y, const char* s, int32_t n, ui_color_t c);
+    // d = c * m + d * (1 - m) for `n` pixels of 8 bit coverage mask `m`
+    // and opaque BGRA color `c` (SSE2 when available):
+    void (*blend_mask)(uint32_t* d, const uint8_t* m, int32_t n, uint32_t c);
+    glyphs_stats_t (*stats)(glyphs_font_t* f);
+} glyphs_if;
+
+extern glyphs_if glyphs;
+
+end_c
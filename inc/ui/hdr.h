@@ -0,0 +1,44 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// 16 bit per channel rendering: image_t with bpp == 8 holds premultiplied
+// BGRA pixels of uint16_t channels (uint64_t per pixel, blue in low bits)
+// in malloc()-ed memory without GDI bitmap. Fills, gradients and image
+// compositing are done with 16 bit precision and the result is converted
+// to 8 bit BGRA (bpp == 4, e.g. gdi.image_init() DIB section) with 8x8
+// ordered (Bayer) dithering thus gradients do not band.
+// Colors are opaque 8 bit rgb() or color_hdr (see color_hdr_rgba()).
+// Elsewhere (gdi, raster, glyphs) hdr colors are drawn as the nearest
+// 8 bit color. SSE2 when available. Large images are processed in
+// parallel horizontal bands (see conversions.bands()).
+
+typedef struct {
+    void (*init)(image_t* image, int32_t w, int32_t h); // bpp = 8, zeros
+    void (*dispose)(image_t* image);
+    // premultiplied 16 bit BGRA pixel of 8 bit or hdr color:
+    uint64_t (*pixel)(ui_color_t c);
+    // source over blend of color into [x..x + w) [y..y + h) of image:
+    void (*fill)(image_t* image, int32_t x, int32_t y, int32_t w, int32_t h,
+        ui_color_t c);
+    void (*gradient)(image_t* image, int32_t x, int32_t y, int32_t w, int32_t h,
+        ui_color_t from, ui_color_t to, bool vertical);
+    // source over blend of `s` (bpp 8 or premultiplied bpp 4) at x, y of
+    // `d` (bpp 8) with constant alpha [0..1]:
+    void (*blend)(image_t* d, int32_t x, int32_t y, const image_t* s,
+        double alpha);
+    // `d` (bpp 4) = dithered `s` (bpp 8) of the same size:
+    void (*dither)(image_t* d, const image_t* s);
+    // spans of `n` pixels:
+    // d = s * alpha + d * (1 - s.alpha * alpha), alpha [0..0xFFFF]
+    void (*blend_span)(uint64_t* d, const uint64_t* s, int32_t n,
+        uint32_t alpha);
+    // `s` pixel [i] is at (x + i, y) for dither threshold matrix:
+    void (*dither_span)(uint32_t* d, const uint64_t* s, int32_t n,
+        int32_t x, int32_t y);
+} hdr_if;
+
+extern hdr_if hdr;
+
+end_c
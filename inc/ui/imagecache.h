@@ -0,0 +1,50 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Persistent cache of decoded images.
+//
+// imagecache.store() writes premultiplied BGRA (bpp == 4) image and its
+// complete mip chain (see gdi.image_mipmap) into a file named by
+// key.hash. imagecache.key() hashes the encoded (PNG, JPEG...) bytes and
+// the requested size. The whole key (second independent hash and the
+// encoded length included) is stored in the file and compared on load,
+// thus a hash collision is a miss and never another image.
+// On the next run imagecache.load() maps the file: image.pixels and mip
+// levels are views of the file (copy on write) thus neither decoding,
+// premultiplication nor mipmapping is repeated and pages are read from
+// the file system cache on first touch.
+//
+// Images loaded from cache must be disposed with imagecache.dispose()
+// (which unmaps the file) and must not be gdi.image_release()-d into the
+// pool. Drawing into them is allowed and never modifies the file.
+// Files are replaced atomically, thus several processes may share the
+// folder. Files are never evicted: delete the folder to clear the cache.
+// All calls are thread safe.
+
+typedef struct imagecache_key_s {
+    uint64_t hash;  // names the file
+    uint64_t check; // independent hash of the same data
+    int64_t bytes;  // of encoded data
+    int32_t w;      // requested size (e.g. loader fit) or 0, 0
+    int32_t h;
+} imagecache_key_t;
+
+typedef struct {
+    // folder for cache files, created on first store(),
+    // null: %TEMP%\ui.imagecache
+    const char* folder;
+    int32_t hits;   // load() succeeded
+    int32_t misses; // load() found no file (or stale one)
+    imagecache_key_t (*key)(const void* data, int64_t bytes,
+        int32_t w, int32_t h);
+    // load() returns 0 or ERROR_NOT_FOUND:
+    errno_t (*load)(image_t* image, const imagecache_key_t* key);
+    errno_t (*store)(image_t* image, const imagecache_key_t* key);
+    void (*dispose)(image_t* image); // gdi.image_dispose() for other images
+} imagecache_if;
+
+extern imagecache_if imagecache;
+
+end_c
@@ -0,0 +1,39 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Linear light compositing of premultiplied sRGB BGRA (bpp == 4) pixels.
+//
+// Blending gamma encoded bytes darkens anti-aliased edges and the middle
+// of gradients. Here pixels are converted to linear light (12 bit) via
+// precomputed lookup tables, blended and converted back to sRGB.
+// Semi-transparent premultiplied pixels are unpremultiplied before
+// lookup, thus results are exact for any alpha, not only opaque pixels.
+// Runs of fully transparent or fully opaque source pixels are skipped
+// or copied 4 at a time (SSE2 when available); lookups are scalar.
+// Set raster_context_t.linear to blend images and fill gradients in
+// linear light inside raster.begin()/end().
+
+enum { linear_bits = 12 }; // linear light values [0..(1 << 12) - 1]
+
+typedef struct {
+    // [256] sRGB byte -> linear light, [1 << linear_bits] linear -> sRGB
+    const uint16_t* (*decode_table)(void);
+    const uint8_t*  (*encode_table)(void);
+    // premultiplied source over destination with constant alpha [0..255]
+    // applied to source (same contract as raster.blend_span()):
+    void (*blend_span)(uint32_t* d, const uint32_t* s, int32_t n,
+        int32_t alpha);
+    // BGRA color i/n of the way from rgba c0 to c1 interpolated in linear
+    // light (alpha is interpolated linearly):
+    uint32_t (*lerp)(ui_color_t c0, ui_color_t c1, int64_t i, int64_t n);
+    // box filter s[sh][sw] -> d[dh][dw] (dw <= sw, dh <= sh) averaging
+    // covered source pixels in linear light, strides in bytes:
+    void (*downscale)(uint8_t* d, int32_t dw, int32_t dh, int32_t d_stride,
+        const uint8_t* s, int32_t sw, int32_t sh, int32_t s_stride);
+} linear_if;
+
+extern linear_if linear;
+
+end_c
@@ -0,0 +1,61 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Asynchronous image decoding.
+//
+// loader.load(&request) returns immediately. A thread pool worker calls
+// request.decode(), premultiplies the pixels, shrinks them to fit into
+// request.w x request.h (keeping aspect ratio, see resample.h) and
+// creates bpp == 4 image_t on the worker, thus neither decoding nor
+// scaling blocks the UI thread. With request.preview > 0 a low
+// resolution copy (longest side request.preview pixels) is delivered
+// first, before the final image is scaled.
+//
+// Images are delivered on the UI thread via request.loaded(): preview
+// (final == false) zero or one time and final exactly once. Draw the
+// preview stretched to request.size. Ownership of the image passes to
+// the callee (copy *image and gdi.image_dispose() it later). Final image
+// is null when decoding failed or the request was canceled. After final
+// loaded() the request memory may be reused.
+// Results that arrive before the application window is created are
+// delivered when it opens.
+//
+// With request.cache the final image is kept in imagecache (see
+// imagecache.h) keyed by the encoded bytes and request.w x h: next time
+// it is mapped from the cache file without decoding and delivered
+// without preview. Dispose images of such requests with
+// imagecache.dispose().
+//
+// loader.cancel() (e.g. for images scrolled out of view) is a token:
+// the worker stops at the next step (decoding itself is not
+// interrupted) and not yet delivered preview is dropped.
+
+typedef struct loader_request_s loader_request_t;
+
+typedef struct loader_request_s {
+    const uint8_t* data; // encoded image, valid until final loaded()
+    int64_t bytes;
+    // decode() is called on worker thread and returns malloc()-ed RGBA
+    // pixels, 4 bytes per pixel (e.g. stbi_load_from_memory(..., 4)):
+    uint8_t* (*decode)(const uint8_t* data, int64_t bytes,
+        int32_t* w, int32_t* h);
+    int32_t w; // > 0: fit into w x h (never enlarged)
+    int32_t h; // 0, 0: natural size
+    int32_t preview; // > 0: longest side of low resolution preview
+    bool cache; // see imagecache.h
+    ui_point_t size; // of the final image, set before first loaded()
+    void (*loaded)(loader_request_t* r, image_t* image, bool final);
+    void* that; // for the application use
+    volatile int32_t canceled; // see loader.cancel()
+} loader_request_t;
+
+typedef struct {
+    void (*load)(loader_request_t* r);   // any thread
+    void (*cancel)(loader_request_t* r); // any thread
+} loader_if;
+
+extern loader_if loader;
+
+end_c
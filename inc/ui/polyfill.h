@@ -0,0 +1,54 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Scanline polygon filler with active edge table.
+//
+// polyfill.edges() builds the edge table of closed polygon sorted by the
+// first scanline of each edge. The table is relative to points[0] and is
+// kept when polygon is only moved (or not changed at all) since the last
+// call, thus polygons redrawn every frame (charts, scrolled views) are
+// not sorted again. Vertices are compared with the kept copy: hash of
+// vertices only rejects changed polygons quickly.
+// polyfill.fill() walks the scanlines inside clip keeping edges that
+// cross the scanline ordered by x and reports runs of rows with
+// identical spans to span(): rectangles and bars are a few calls. Pixel
+// is inside when its center is (vertices are pixel corners) like Win32
+// Polygon(): top and left edges are included, bottom and right excluded.
+// Edge intersections are exact (64-bit integer arithmetic) for vertices
+// within +/-2^28 of each other.
+
+enum {
+    polyfill_even_odd = 1, // Win32 ALTERNATE
+    polyfill_non_zero = 2  // Win32 WINDING
+};
+
+typedef struct polyfill_edge_s polyfill_edge_t;
+
+typedef struct polyfill_s {
+    polyfill_edge_t* edges; // sorted by first scanline
+    int32_t count;          // of edges
+    int32_t capacity;
+    int32_t points;         // polygon vertices count
+    uint64_t hash;          // of vertices relative to points[0]
+    ui_point_t* vertices;   // [points] relative to points[0] (capacity)
+    ui_point_t origin;      // points[0] of the last edges() call
+    ui_rect_t bounds;       // of polygon relative to origin
+    void* scratch;          // active edges and spans of fill()
+    int64_t scratch_bytes;
+} polyfill_t;
+
+typedef struct {
+    // returns true if previously built edges were reused:
+    bool (*edges)(polyfill_t* p, const ui_point_t* points, int32_t count);
+    // clip: null for whole polygon:
+    void (*fill)(polyfill_t* p, int32_t rule, const ui_rect_t* clip,
+        void* that, void (*span)(void* that, int32_t x, int32_t y,
+        int32_t w, int32_t h));
+    void (*dispose)(polyfill_t* p);
+} polyfill_if;
+
+extern polyfill_if polyfill;
+
+end_c
@@ -0,0 +1,94 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// Software rasterizer: implementation of gdi_t drawing primitives
+// that renders into BGRA (bpp == 4) image_t pixels instead of HDC.
+//
+// raster.begin(&context, &image) redirects gdi.* drawing calls made
+// on the calling thread into the image until raster.end(). Threads
+// without current context (e.g. UI thread painting on app.canvas)
+// keep using Win32 GDI. Each thread may render into its own image
+// with its own context concurrently. The context keeps its own pen
+// position (state.x, state.y): use gdi.move_to() or gdi.position()
+// instead of gdi.x and gdi.y inside raster.begin()/end().
+//
+// Text is drawn with DrawTextW() into the image DIB section thus the
+// image must be created by gdi.image_init() and glyph pixels have
+// alpha == 0 (Win32 GDI does not preserve alpha). Measurement
+// functions (measure_text(), get_em(), ...) are not redirected.
+// With context.glyphs set text is rendered by glyphs (see glyphs.h)
+// instead: no DIB section is needed and glyph alpha is 0xFF, but
+// gdi.multiline() only breaks lines at "\n".
+// With context.linear set images are blended and gradients are filled
+// in linear light (see linear.h).
+// With context.antialiased gdi.line(), gdi.poly() and gdi.rounded() are
+// anti-aliased: coverage of each pixel is computed from the distance of
+// its center to the outline. Lines go through pixel centers and have
+// round caps (pen width is the diameter). Polyline joins are the
+// overlapping caps of the adjacent segments.
+// raster.polygon() fills with the context brush and is always
+// anti-aliased (exact area coverage, non-zero winding).
+// Pens and brushes created inside raster.begin()/end() are software
+// objects that may be selected into any raster context and deleted
+// with gdi.delete_pen()/delete_brush() inside or outside of it. Win32
+// pens and solid brushes created outside (e.g. cached gdi.create_pen())
+// may be selected too: their color and width are read by GetObject()
+// on gdi.set_pen()/set_brush(). Any other handle is fatal.
+
+typedef struct raster_state_s { // saved by gdi.push() restored by gdi.pop()
+    int32_t x; // pen position (see gdi.position())
+    int32_t y;
+    ui_rect_t  clip; // inside image bounds
+    ui_brush_t brush;
+    ui_pen_t   pen;
+    ui_font_t  font;
+    ui_color_t brush_color; // color of gdi.brush_color brush
+    ui_color_t pen_color;   // color of gdi.set_colored_pen() pen
+    ui_color_t pen_rgb;     // color of other selected pen
+    int32_t    pen_width;   // of selected pen in pixels, 0 hollow
+    ui_color_t brush_rgb;   // color of selected (not gdi.brush_*) brush
+    ui_color_t text_color;
+} raster_state_t;
+
+typedef struct raster_vertex_s { // pixel (x, y) spans [x..x + 1) [y..y + 1)
+    float x;
+    float y;
+} raster_vertex_t;
+
+typedef struct raster_context_s raster_context_t;
+
+typedef struct raster_context_s {
+    image_t* image; // render target
+    raster_state_t state;
+    raster_state_t stack[64];
+    int32_t top;
+    ui_canvas_t dc; // memory DC for text with image->bitmap selected
+    ui_bitmap_t bitmap; // previously selected into dc
+    glyphs_font_t* glyphs; // not null: text is drawn by glyphs.draw()
+    bool linear; // blend images and fill gradients in linear light
+    bool antialiased; // lines, polylines and rounded rectangles
+    raster_context_t* previous; // nested raster.begin()
+} raster_context_t;
+
+typedef struct {
+    void (*begin)(raster_context_t* context, image_t* image);
+    void (*end)(void);
+    raster_context_t* (*current)(void); // null when drawing with HDC
+    // spans of `n` pixels (SSE2 when available):
+    void (*fill_span)(uint32_t* d, int32_t n, uint32_t bgra);
+    // premultiplied BGRA source over destination with constant
+    // alpha [0..255] applied to source:
+    void (*blend_span)(uint32_t* d, const uint32_t* s, int32_t n,
+        int32_t alpha);
+    // premultiplied bgra over destination with per pixel coverage:
+    void (*cover_span)(uint32_t* d, const uint8_t* cover, int32_t n,
+        uint32_t bgra);
+    // anti-aliased polygon filled with the current context brush:
+    void (*polygon)(const raster_vertex_t* v, int32_t count);
+} raster_if;
+
+extern raster_if raster;
+
+end_c
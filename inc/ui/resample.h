@@ -0,0 +1,36 @@
+#pragma once
+#include "ui/ui.h"
+
+begin_c
+
+// High quality image scaling of premultiplied BGRA (bpp == 4) pixels.
+// Separable two pass convolution with precomputed 14 bit fixed point
+// weights (SSE2 when available). Large images are processed in
+// parallel horizontal bands (see conversions.bands()).
+// resample_auto uses box filter on axes that shrink (averages all
+// covered source pixels) and bicubic (Catmull-Rom) on axes that grow.
+
+enum {
+    resample_auto    = 0,
+    resample_box     = 1,
+    resample_bicubic = 2,
+    resample_lanczos = 3 // Lanczos3, sharpest, slowest
+};
+
+typedef struct {
+    // s[sh][sw] -> d[dh][dw], strides in bytes:
+    void (*bgra)(uint8_t* d, int32_t dw, int32_t dh, int32_t d_stride,
+                 const uint8_t* s, int32_t sw, int32_t sh, int32_t s_stride,
+                 int32_t filter);
+    // 2x2 box filter s[sh][sw] -> d[(sh + 1) / 2][(sw + 1) / 2] (mipmap
+    // level), odd last column and row are averaged with themselves.
+    // gamma: premultiplied pixels are unpacked to linear light, averaged
+    // and packed back like linear.h does (scalar), otherwise stored
+    // values are averaged (SSE2):
+    void (*half)(uint8_t* d, int32_t d_stride, const uint8_t* s,
+                 int32_t sw, int32_t sh, int32_t s_stride, bool gamma);
+} resample_if;
+
+extern resample_if resample;
+
+end_c
@@ -2,8 +2,19 @@
 #include "ut/ut.h"
 #include "ui/core.h"
 #include "ui/colors.h"
+#include "ui/conversions.h"
+#include "ui/linear.h"
+#include "ui/resample.h"
+#include "ui/hdr.h"
+#include "ui/polyfill.h"
 #include "ui/gdi.h"
+#include "ui/imagecache.h"
+#include "ui/loader.h"
+#include "ui/gif.h"
+#include "ui/glyphs.h"
+#include "ui/raster.h"
 #include "ui/view.h"
+#include "ui/display.h"
 #include "ui/layout.h"
 #include "ui/label.h"
 #include "ui/button.h"
@@ -15,7 +15,18 @@
 #define canvas() ((HDC)app.canvas)
 
 #include "src/ui/core.c"
+#include "src/ui/conversions.c"
+#include "src/ui/linear.c"
+#include "src/ui/resample.c"
+#include "src/ui/hdr.c"
+#include "src/ui/polyfill.c"
 #include "src/ui/gdi.c"
+#include "src/ui/imagecache.c"
+#include "src/ui/loader.c"
+#include "src/ui/gif.c"
+#include "src/ui/raster.c"
+#include "src/ui/display.c"
+#include "src/ui/glyphs.c"
 #include "src/ui/colors.c"
 #include "src/ui/view.c"
 #include "src/ui/label.c"
@@ -54,6 +65,7 @@ int WINAPI WinMain(HINSTANCE unused(instance), HINSTANCE unused(previous),
 int main(int argc, const char* argv[]) {
     fatal_if_not_zero(CoInitializeEx(0, COINIT_MULTITHREADED | COINIT_SPEED_OVER_MEMORY));
     __winnls_init__();
+    app_install_gdi();
     app.argc = argc;
     app.argv = argv;
     app.tid = threads.id();
@@ -0,0 +1,452 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021 see LICENSE for details */
+#include "quick.h"
+#include "ui/win32.h"
+
+begin_c
+
+// Benchmarks of pixel processing and drawing primitives.
+// No window is created and results are reported via traceln().
+// Randomized regression tests (*.test.c) run first.
+
+static void init(void) { }
+
+static int bench(void);
+
+void gif_test(void); // see gif.test.c
+void polyfill_test(void); // see polyfill.test.c
+
+app_t app = {
+    .class_name = "bench",
+    .init = init,
+    .main = bench,
+    .no_ui = true
+};
+
+static uint8_t* bench_alloc(int64_t bytes) {
+    uint8_t* p = (uint8_t*)malloc(bytes);
+    fatal_if_null(p);
+    uint32_t seed = 1;
+    for (int64_t i = 0; i < bytes; i++) {
+        seed = seed * 1103515245 + 12345;
+        p[i] = (uint8_t)(seed >> 24);
+    }
+    return p;
+}
+
+static void bench_copy4(uint8_t* d, const uint8_t* s, int32_t n) {
+    memcpy(d, s, n * 4);
+}
+
+// bench_span() GB/s of bytes read and written by `span` on `n` pixels
+
+static void bench_span(const char* name, conversions_span_t span,
+        int32_t sbpp, int32_t dbpp, int32_t n) {
+    uint8_t* s = bench_alloc((int64_t)n * sbpp);
+    uint8_t* d = bench_alloc((int64_t)n * dbpp);
+    span(d, s, n); // warm up caches and page in destination
+    int64_t k = 0;
+    double elapsed = 0;
+    const double time = clock.seconds();
+    while (elapsed < 0.5) {
+        span(d, s, n);
+        k++;
+        elapsed = clock.seconds() - time;
+    }
+    const double bytes = (double)k * n * (sbpp + dbpp);
+    traceln("%-20s %8d pixels %7.2f GB/s", name, n, bytes / elapsed / 1e9);
+    free(d);
+    free(s);
+}
+
+static void bench_conversions(void) {
+    // in cache and out of cache span sizes:
+    static const int32_t sizes[] = { 16 * 1024, 16 * 1024 * 1024 };
+    for (int32_t i = 0; i < countof(sizes); i++) {
+        const int32_t n = sizes[i];
+        bench_span("memcpy",           bench_copy4, 4, 4, n);
+        bench_span("swap_rb3",         conversions.swap_rb3, 3, 3, n);
+        bench_span("rgbx_to_bgra",     conversions.rgbx_to_bgra, 4, 4, n);
+        bench_span("bgrx_to_bgra",     conversions.bgrx_to_bgra, 4, 4, n);
+        bench_span("rgba_premultiply", conversions.rgba_premultiply, 4, 4, n);
+        bench_span("bgra_premultiply", conversions.bgra_premultiply, 4, 4, n);
+        bench_span("grey_to_bgra",     conversions.grey_to_bgra, 1, 4, n);
+    }
+}
+
+// bench_rows() single threaded span loop vs band parallel conversions.rows()
+
+static void bench_rows(void) {
+    enum { w = 8192, h = 8192 }; // 64MP
+    uint8_t* s  = bench_alloc((int64_t)w * h * 4);
+    uint8_t* d0 = bench_alloc((int64_t)w * h * 4);
+    uint8_t* d1 = bench_alloc((int64_t)w * h * 4);
+    double time = clock.seconds();
+    for (int32_t y = 0; y < h; y++) {
+        const int64_t offset = (int64_t)y * w * 4;
+        conversions.rgba_premultiply(d0 + offset, s + offset, w);
+    }
+    const double single = clock.seconds() - time;
+    time = clock.seconds();
+    conversions.rows(conversions.rgba_premultiply, d1, w * 4, s, w * 4, w, h);
+    const double bands = clock.seconds() - time;
+    fatal_if(memcmp(d0, d1, (int64_t)w * h * 4) != 0, "bands differ");
+    traceln("rgba_premultiply %dx%d single %.3fms bands %.3fms x%.1f",
+        w, h, single * 1000.0, bands * 1000.0, single / bands);
+    free(d1);
+    free(d0);
+    free(s);
+}
+
+static void bench_image_init(void) {
+    enum { w = 4096, h = 4096, bpp = 4 };
+    uint8_t* pixels = bench_alloc((int64_t)w * h * bpp);
+    const int32_t count = 8;
+    double time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        image_t image = {0};
+        gdi.image_init(&image, w, h, bpp, pixels);
+        gdi.image_dispose(&image);
+    }
+    time = (clock.seconds() - time) / count;
+    traceln("gdi.image_init(%dx%dx%d) %.3fms %.2f GB/s", w, h, bpp,
+        time * 1000.0, (double)w * h * bpp * 2 / time / 1e9);
+    free(pixels);
+}
+
+// bench_frames() per frame image_init() + image_dispose() vs pooled
+// image_acquire() + image_update() + image_release() at video frame size
+
+static void bench_frames(void) {
+    enum { w = 1920, h = 1080, bpp = 4, count = 60 };
+    uint8_t* pixels = bench_alloc((int64_t)w * h * bpp);
+    double time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        image_t image = {0};
+        gdi.image_init(&image, w, h, bpp, pixels);
+        gdi.image_dispose(&image);
+    }
+    const double init = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        image_t image = {0};
+        gdi.image_acquire(&image, w, h, bpp);
+        gdi.image_update(&image, bpp, pixels);
+        gdi.image_release(&image);
+    }
+    const double pooled = (clock.seconds() - time) / count;
+    traceln("%dx%d frame init+dispose %.3fms acquire+update+release %.3fms",
+        w, h, init * 1000.0, pooled * 1000.0);
+    free(pixels);
+}
+
+// bench_text() printf style text and measurement vs span variants
+// drawing into memory DC bitmap (gdi needs app.window and app.canvas)
+
+static void bench_text(void) {
+    enum { w = 1024, h = 64, count = 10 * 1000 };
+    static const char* s = "The quick brown fox jumps over the lazy dog";
+    const int32_t n = (int32_t)strlen(s);
+    uint8_t* pixels = (uint8_t*)calloc(w * h, 4);
+    fatal_if_null(pixels);
+    image_t image = {0};
+    gdi.image_init(&image, w, h, 4, pixels);
+    HDC dc = CreateCompatibleDC(null);
+    fatal_if_null(dc);
+    HBITMAP bitmap = SelectBitmap(dc, (HBITMAP)image.bitmap);
+    HWND window = CreateWindowExA(0, "STATIC", "", 0, 0, 0, 0, 0,
+        null, null, null, null);
+    fatal_if_null(window);
+    app.window = (ui_window_t)window;
+    app.canvas = (ui_canvas_t)dc;
+    gdi.push(0, 0);
+    gdi.set_font(app.fonts.regular);
+    double time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) { gdi.x = 0; gdi.text("%.*s", n, s); }
+    const double text = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) { gdi.x = 0; gdi.text_n(s, n); }
+    const double text_n = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        gdi.measure_text(app.fonts.regular, "%.*s", n, s);
+    }
+    const double measure = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        gdi.measure_text_n(app.fonts.regular, s, n);
+    }
+    const double measure_n = (clock.seconds() - time) / count;
+    gdi.pop();
+    app.canvas = null;
+    app.window = null;
+    fatal_if_false(DestroyWindow(window));
+    SelectBitmap(dc, bitmap);
+    fatal_if_false(DeleteDC(dc));
+    gdi.image_dispose(&image);
+    free(pixels);
+    traceln("text %.3fus text_n %.3fus measure_text %.3fus measure_text_n %.3fus",
+        text * 1e6, text_n * 1e6, measure * 1e6, measure_n * 1e6);
+    traceln("measure cache hits %lld misses %lld",
+        gdi.measure_stats.hits, gdi.measure_stats.misses);
+}
+
+// bench_hdr() 16 bit per channel gradient, blend and dither to 8 bit
+
+static void bench_hdr(void) {
+    enum { w = 1920, h = 1080, count = 10 };
+    image_t image = {0};
+    hdr.init(&image, w, h);
+    image_t layer = {0};
+    hdr.init(&layer, w, h);
+    uint8_t* pixels = (uint8_t*)calloc(w * h, 4);
+    fatal_if_null(pixels);
+    image_t bgra = {0};
+    gdi.image_init(&bgra, w, h, 4, pixels);
+    hdr.gradient(&layer, 0, 0, w, h, color_hdr_rgba(0, 0, 0x8000, 0x8000),
+        color_hdr_rgba(0xFFFF, 0x4000, 0, 0x8000), false);
+    double time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        hdr.gradient(&image, 0, 0, w, h, rgb(16, 16, 24), rgb(40, 40, 64), true);
+    }
+    const double gradient = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) { hdr.blend(&image, 0, 0, &layer, 1.0); }
+    const double blend = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) { hdr.dither(&bgra, &image); }
+    const double dither = (clock.seconds() - time) / count;
+    gdi.image_dispose(&bgra);
+    free(pixels);
+    hdr.dispose(&layer);
+    hdr.dispose(&image);
+    traceln("hdr %dx%d gradient %.3fms blend %.3fms dither %.3fms",
+        w, h, gradient * 1e3, blend * 1e3, dither * 1e3);
+}
+
+// bench_linear() source over blending of semi-transparent pixels
+// gamma encoded (raster) vs linear light, and linear light 4:1 downscale
+
+static void bench_linear(void) {
+    enum { w = 1920, h = 1080, count = 10 };
+    uint32_t* s = (uint32_t*)malloc(w * h * sizeof(uint32_t));
+    uint32_t* d = (uint32_t*)malloc(w * h * sizeof(uint32_t));
+    fatal_if_null(s);
+    fatal_if_null(d);
+    for (int32_t i = 0; i < w * h; i++) {
+        const uint32_t a = (uint32_t)(i % w) * 255 / (w - 1); // 0..255 ramp
+        s[i] = (a << 24) | (a * 3 / 4) << 16 | (a / 2) << 8 | (a / 4);
+        d[i] = 0xFF000000u | (uint32_t)(i % 251) * 0x010101u;
+    }
+    double time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        for (int32_t y = 0; y < h; y++) {
+            raster.blend_span(d + y * w, s + y * w, w, 255);
+        }
+    }
+    const double gamma = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        for (int32_t y = 0; y < h; y++) {
+            linear.blend_span(d + y * w, s + y * w, w, 255);
+        }
+    }
+    const double light = (clock.seconds() - time) / count;
+    time = clock.seconds();
+    for (int32_t i = 0; i < count; i++) {
+        linear.downscale((uint8_t*)d, w / 4, h / 4, w / 4 * 4,
+            (const uint8_t*)s, w, h, w * 4);
+    }
+    const double downscale = (clock.seconds() - time) / count;
+    free(d);
+    free(s);
+    traceln("blend %dx%d gamma %.3fms linear %.3fms downscale /4 %.3fms",
+        w, h, gamma * 1e3, light * 1e3, downscale * 1e3);
+}
+
+// bench_primitives() primitives per second drawn by raster into an image
+// aliased vs anti-aliased (see raster.h)
+
+enum { bench_primitives_count = 2000 };
+
+static double bench_primitives_draw(int32_t kind, bool antialiased) {
+    enum { w = 1920, h = 1080 };
+    image_t image = {0};
+    gdi.image_acquire(&image, w, h, 4);
+    raster_context_t* rc = (raster_context_t*)malloc(sizeof(raster_context_t));
+    fatal_if_null(rc);
+    raster.begin(rc, &image);
+    rc->antialiased = antialiased;
+    ui_pen_t pen = gdi.create_pen(rgb(250, 250, 250), 3);
+    gdi.set_pen(pen);
+    gdi.set_brush(gdi.brush_color);
+    gdi.fill_with(0, 0, w, h, rgb(16, 16, 16));
+    gdi.set_brush_color(rgb(40, 80, 160));
+    const double time = clock.seconds();
+    for (int32_t i = 0; i < bench_primitives_count; i++) {
+        const int32_t x = (i * 37) % (w - 320);
+        const int32_t y = (i * 61) % (h - 240);
+        if (kind == 0) {
+            gdi.rounded(x, y, 200, 120, 24, 24);
+        } else if (kind == 1) {
+            gdi.move_to(x, y);
+            gdi.line(x + 300 - (i % 7) * 50, y + 40 + (i % 5) * 40);
+        } else {
+            raster_vertex_t star[10];
+            for (int32_t k = 0; k < countof(star); k++) {
+                const double a = k * 3.14159265358979 / 5 + i * 0.01;
+                const double r = k % 2 == 0 ? 100 : 40;
+                star[k] = (raster_vertex_t){ (float)(x + 120 + r * cos(a)),
+                                             (float)(y + 120 + r * sin(a)) };
+            }
+            raster.polygon(star, countof(star));
+        }
+    }
+    const double elapsed = clock.seconds() - time;
+    gdi.set_pen(gdi.pen_hollow);
+    gdi.delete_pen(pen);
+    raster.end();
+    free(rc);
+    gdi.image_dispose(&image);
+    return bench_primitives_count / elapsed;
+}
+
+static void bench_primitives(void) {
+    traceln("rounded rect 200x120 pen 3 %8.0f aliased %8.0f anti-aliased /s",
+        bench_primitives_draw(0, false), bench_primitives_draw(0, true));
+    traceln("line ~300 pixels pen 3 %8.0f aliased %8.0f anti-aliased /s",
+        bench_primitives_draw(1, false), bench_primitives_draw(1, true));
+    traceln("star polygon 200x200 %8.0f anti-aliased /s",
+        bench_primitives_draw(2, true));
+}
+
+// bench_polygon() gdi.polygon() with 100K vertices into an image: the
+// first frame builds and sorts the edges, next frames reuse them.
+// Area chart has a few active edges per scanline, spiky star thousands.
+
+static void bench_polygon_fill(const char* name, ui_point_t* points,
+        int32_t count, int32_t rule) {
+    enum { w = 1920, h = 1080, frames = 10 };
+    image_t image = {0};
+    gdi.image_acquire(&image, w, h, 4);
+    raster_context_t* rc = (raster_context_t*)malloc(sizeof(raster_context_t));
+    fatal_if_null(rc);
+    raster.begin(rc, &image);
+    gdi.set_brush(gdi.brush_color);
+    gdi.set_brush_color(rgb(40, 80, 160));
+    points[0].x++; // changed polygon: edges are built again
+    double time = clock.seconds();
+    gdi.polygon(points, count, rule);
+    const double first = clock.seconds() - time;
+    time = clock.seconds();
+    for (int32_t i = 0; i < frames; i++) { gdi.polygon(points, count, rule); }
+    const double next = (clock.seconds() - time) / frames;
+    raster.end();
+    free(rc);
+    gdi.image_dispose(&image);
+    traceln("%-12s %d vertices %-9s first %7.3fms next %7.3fms %6.1f Mvertices/s",
+        name, count, rule == polyfill_even_odd ? "even-odd" : "non-zero",
+        first * 1e3, next * 1e3, count / next / 1e6);
+}
+
+static void bench_polygon(void) {
+    enum { n = 100 * 1000 };
+    ui_point_t* points = (ui_point_t*)malloc((n + 2) * sizeof(ui_point_t));
+    fatal_if_null(points);
+    uint32_t seed = 1;
+    int32_t y = 540;
+    for (int32_t i = 0; i < n; i++) { // random walk sampled across 1920
+        seed = seed * 1103515245 + 12345;
+        y = max(100, min(980, y + (int32_t)(seed >> 29) - 4));
+        points[i] = (ui_point_t){ (int32_t)((int64_t)i * 1920 / n), y };
+    }
+    points[n + 0] = (ui_point_t){ 1919, 1079 };
+    points[n + 1] = (ui_point_t){ 0, 1079 };
+    for (int32_t rule = polyfill_even_odd; rule <= polyfill_non_zero; rule++) {
+        bench_polygon_fill("area chart", points, n + 2, rule);
+    }
+    for (int32_t i = 0; i < n; i++) {
+        const double a = i * 2 * 3.14159265358979 / n;
+        const double r = i % 2 == 0 ? 500 : 300;
+        points[i] = (ui_point_t){ (int32_t)(960 + r * cos(a)),
+                                  (int32_t)(540 + r * sin(a)) };
+    }
+    for (int32_t rule = polyfill_even_odd; rule <= polyfill_non_zero; rule++) {
+        bench_polygon_fill("spiky star", points, n, rule);
+    }
+    free(points);
+}
+
+// bench_tiles() independent tiles drawn with per thread gdi contexts
+// one after another on the calling thread vs concurrently (bands)
+
+enum { bench_tile = 256, bench_tiles = 16, bench_tile_draws = 2000 };
+
+typedef struct bench_tiles_s {
+    image_t images[bench_tiles];
+    HDC dcs[bench_tiles];
+} bench_tiles_t;
+
+static void bench_tiles_band(void* that, int32_t t0, int32_t t1) {
+    bench_tiles_t* b = (bench_tiles_t*)that;
+    for (int32_t t = t0; t < t1; t++) {
+        gdi_context_t* context = (gdi_context_t*)malloc(sizeof(gdi_context_t));
+        fatal_if_null(context);
+        gdi.begin(context, (ui_canvas_t)b->dcs[t]);
+        gdi.push(0, 0);
+        gdi.set_colored_pen(rgb(255, 255, 255));
+        for (int32_t i = 0; i < bench_tile_draws; i++) {
+            const int32_t x = (i * 37 + t) % bench_tile;
+            const int32_t y = (i * 61) % bench_tile;
+            gdi.fill_with(x, y, 16, 16, rgb(i & 0xFF, t * 16, 128));
+            gdi.move_to(x, y);
+            gdi.line(bench_tile - 1 - y, x);
+        }
+        gdi.pop();
+        gdi.end();
+        free(context);
+    }
+}
+
+static void bench_tiles_draw(void) {
+    bench_tiles_t b = {0};
+    for (int32_t t = 0; t < bench_tiles; t++) {
+        gdi.image_acquire(&b.images[t], bench_tile, bench_tile, 4);
+        b.dcs[t] = CreateCompatibleDC(null);
+        fatal_if_null(b.dcs[t]);
+        SelectBitmap(b.dcs[t], (HBITMAP)b.images[t].bitmap);
+    }
+    double time = clock.seconds();
+    bench_tiles_band(&b, 0, bench_tiles);
+    GdiFlush();
+    const double serial = clock.seconds() - time;
+    time = clock.seconds();
+    conversions.bands(&b, bench_tiles_band, bench_tile * bench_tile,
+        bench_tiles);
+    GdiFlush();
+    const double parallel = clock.seconds() - time;
+    for (int32_t t = 0; t < bench_tiles; t++) {
+        fatal_if_false(DeleteDC(b.dcs[t]));
+        gdi.image_dispose(&b.images[t]);
+    }
+    traceln("%d tiles %dx%d serial %.3fms parallel %.3fms (%.1fx)",
+        bench_tiles, bench_tile, bench_tile, serial * 1e3, parallel * 1e3,
+        serial / parallel);
+}
+
+static int bench(void) {
+    gif_test(); // correctness before speed
+    polyfill_test();
+    bench_conversions();
+    bench_rows();
+    bench_image_init();
+    bench_frames();
+    bench_text();
+    bench_tiles_draw();
+    bench_hdr();
+    bench_linear();
+    bench_primitives();
+    bench_polygon();
+    return 0;
+}
+
+end_c
@@ -1,6 +1,9 @@
 /* Copyright (c) Dmitry "Leo" Kuznetsov 2021 see LICENSE for details */
 #include "quick.h"
 #include "edit.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // TODO: undo/redo
 // TODO: back/forward navigation
@@ -34,10 +37,12 @@ typedef  struct ui_edit_glyph_s {
 } ui_edit_glyph_t;
 
 fn(void, layout)(ui_view_t* view);
+fn(void, invalidate)(ui_edit_t* e);
 
 // Glyphs in monospaced Windows fonts may have different width for non-ASCII
-// characters. Thus even if edit is monospaced glyph measurements are used
-// in text layout.
+// characters. Thus even if edit is monospaced only glyphs from known
+// uniform ranges are computed (see mono_class() below) and the rest are
+// measured in text layout.
 
 fn(uint64_t, uint64)(int32_t high, int32_t low) {
     assert(high >= 0 && low >= 0);
@@ -84,17 +89,12 @@ fn(void, reallocate)(void** pp, int32_t count, size_t element) {
     }
 }
 
-fn(void, invalidate)(ui_edit_t* e) {
-//  traceln("");
-    e->view.invalidate(&e->view);
-}
-
-fn(int32_t, text_width)(ui_edit_t* e, const char* s, int32_t n) {
+fn(int32_t, measure_width)(ui_edit_t* e, const char* s, int32_t n) {
 //  double time = clock.seconds();
     // average measure_text() performance per character:
     // "app.fonts.mono"    ~500us (microseconds)
     // "app.fonts.regular" ~250us (microseconds)
-    int32_t x = n == 0 ? 0 : gdi.measure_text(*e->view.font, "%.*s", n, s).x;
+    int32_t x = n == 0 ? 0 : gdi.measure_text_n(*e->view.font, s, n).x;
 //  time = (clock.seconds() - time) * 1000.0;
 //  static double time_sum;
 //  static double length_sum;
@@ -179,8 +179,125 @@ fn(void, paragraph_g2b)(ui_edit_t* e, int32_t pn) {
     }
 }
 
+// Monospaced layout: all glyphs of the common narrow ranges are exactly
+// em.x pixels wide, East Asian wide glyphs and emoji are measured once
+// per font (fallback fonts are uniform inside these ranges), TAB
+// advances to the next multiple of `mono.tab` cells counted from the
+// start of the run. Only glyphs outside of known ranges are measured.
+
+enum {
+    ui_edit_mono_other  = 0, // measured with gdi.measure_text()
+    ui_edit_mono_narrow = 1, // em.x
+    ui_edit_mono_wide   = 2, // mono.wide
+    ui_edit_mono_emoji  = 3, // mono.emoji
+    ui_edit_mono_tab    = 4  // up to next tab stop
+};
+
+fn(uint32_t, codepoint)(const char* utf8, int32_t bytes) {
+    const uint8_t* u = (const uint8_t*)utf8;
+    switch (bytes) {
+        case 1: return u[0];
+        case 2: return ((u[0] & 0x1Fu) <<  6) | (u[1] & 0x3Fu);
+        case 3: return ((u[0] & 0x0Fu) << 12) | ((u[1] & 0x3Fu) << 6) |
+                        (u[2] & 0x3Fu);
+        case 4: return ((u[0] & 0x07u) << 18) | ((u[1] & 0x3Fu) << 12) |
+                       ((u[2] & 0x3Fu) <<  6) |  (u[3] & 0x3Fu);
+        default: return 0xFFFD; // replacement character
+    }
+}
+
+fn(int32_t, mono_class)(uint32_t cp) {
+    if (cp == '\t') { return ui_edit_mono_tab; }
+    if (0x20 <= cp && cp <= 0x7E)         { return ui_edit_mono_narrow; }
+    if (0xA0 <= cp && cp <= 0x2FF)        { return ui_edit_mono_narrow; } // Latin
+    if (0x370 <= cp && cp <= 0x4FF)       { return ui_edit_mono_narrow; } // Greek Cyrillic
+    if (0x2500 <= cp && cp <= 0x259F)     { return ui_edit_mono_narrow; } // box drawing
+    if (0x1100 <= cp && cp <= 0x115F)     { return ui_edit_mono_wide; } // Hangul Jamo
+    if (0x2E80 <= cp && cp <= 0x303E)     { return ui_edit_mono_wide; } // CJK radicals
+    if (0x3041 <= cp && cp <= 0x4DBF)     { return ui_edit_mono_wide; } // Kana CJK Ext A
+    if (0x4E00 <= cp && cp <= 0xA4CF)     { return ui_edit_mono_wide; } // CJK Yi
+    if (0xAC00 <= cp && cp <= 0xD7A3)     { return ui_edit_mono_wide; } // Hangul
+    if (0xF900 <= cp && cp <= 0xFAFF)     { return ui_edit_mono_wide; } // CJK compatibility
+    if (0xFE30 <= cp && cp <= 0xFE4F)     { return ui_edit_mono_wide; }
+    if (0xFF00 <= cp && cp <= 0xFF60)     { return ui_edit_mono_wide; } // fullwidth forms
+    if (0xFFE0 <= cp && cp <= 0xFFE6)     { return ui_edit_mono_wide; }
+    if (0x1F300 <= cp && cp <= 0x1F64F)   { return ui_edit_mono_emoji; }
+    if (0x1F680 <= cp && cp <= 0x1F6FF)   { return ui_edit_mono_emoji; }
+    if (0x1F900 <= cp && cp <= 0x1FAFF)   { return ui_edit_mono_emoji; }
+    if (0x20000 <= cp && cp <= 0x3FFFD)   { return ui_edit_mono_wide; } // CJK Ext B+
+    return ui_edit_mono_other;
+}
+
+// mono_glyph_width() pixel width of a single glyph starting at `x`
+// pixels from the start of the run (x only matters for TAB)
+
+fn(int32_t, mono_glyph_width)(ui_edit_t* e, const char* s, int32_t bytes,
+        int32_t x) {
+    switch (ns(mono_class)(ns(codepoint)(s, bytes))) {
+        case ui_edit_mono_narrow: return e->view.em.x;
+        case ui_edit_mono_wide:   return e->mono.wide;
+        case ui_edit_mono_emoji:  return e->mono.emoji;
+        case ui_edit_mono_tab: {
+            const int32_t stop = max(1, e->mono.tab) * e->view.em.x;
+            return stop - x % stop;
+        }
+        default: return ns(measure_width)(e, s, bytes);
+    }
+}
+
+fn(int32_t, mono_width)(ui_edit_t* e, const char* s, int32_t n) {
+    int32_t x = 0;
+    int32_t i = 0;
+    while (i < n) {
+        const int32_t bytes = ns(glyph_bytes)(s[i]);
+        x += ns(mono_glyph_width)(e, s + i, bytes, x);
+        i += bytes;
+    }
+    return x;
+}
+
+// text_width() of `n` bytes of utf-8 starting at the beginning of a run
+
+fn(int32_t, text_width)(ui_edit_t* e, const char* s, int32_t n) {
+    return e->mono.on ? ns(mono_width)(e, s, n) : ns(measure_width)(e, s, n);
+}
+
+fn(void, mono_measure)(ui_edit_t* e) {
+    ui_font_t f = e->view.font != null ? *e->view.font : app.fonts.regular;
+    e->mono.on = gdi.is_mono(f);
+    if (e->mono.on) {
+        // U+58F9 CJK "one" and U+1F9F8 Teddy Bear as representatives:
+        e->mono.wide  = gdi.measure_text(f, "%s", "\xE5\xA3\xB9").x;
+        e->mono.emoji = gdi.measure_text(f, "%s", "\xF0\x9F\xA7\xB8").x;
+    }
+}
+
+// mono_break_at() is arithmetic equivalent of word_break_at() below
+
+fn(int32_t, mono_break_at)(ui_edit_t* e, int32_t pn, int32_t rn,
+        const int32_t width, bool allow_zero) {
+    const ui_edit_para_t* p = &e->para[pn];
+    const int32_t gp = p->run[rn].gp;
+    const int32_t bp = p->run[rn].bp;
+    const int32_t* g2b = &p->g2b[gp];
+    const char* text = p->text + bp;
+    int32_t k = 0;
+    int32_t x = 0;
+    while (k < p->glyphs - gp) {
+        x += ns(mono_glyph_width)(e, text + g2b[k] - bp,
+                                  g2b[k + 1] - g2b[k], x);
+        if (x >= width) { break; }
+        k++;
+    }
+    if (!allow_zero && k == 0) { k = 1; } // at least 1 glyph
+    return k;
+}
+
 fn(int32_t, word_break_at)(ui_edit_t* e, int32_t pn, int32_t rn,
         const int32_t width, bool allow_zero) {
+    if (e->mono.on) {
+        return ns(mono_break_at)(e, pn, rn, width, allow_zero);
+    }
     ui_edit_para_t* p = &e->para[pn];
     int32_t k = 1; // at least 1 glyph
     // offsets inside a run in glyphs and bytes from start of the paragraph:
@@ -224,15 +341,6 @@ fn(int32_t, word_break)(ui_edit_t* e, int32_t pn, int32_t rn) {
     return ns(word_break_at)(e, pn, rn, e->view.w, false);
 }
 
-fn(int32_t, glyph_at_x)(ui_edit_t* e, int32_t pn, int32_t rn,
-        int32_t x) {
-    if (x == 0 || e->para[pn].bytes == 0) {
-        return 0;
-    } else {
-        return ns(word_break_at)(e, pn, rn, x + 1, true);
-    }
-}
-
 fn(ui_edit_glyph_t, glyph_at)(ui_edit_t* e, ui_edit_pg_t p) {
     ui_edit_glyph_t g = { .s = "", .bytes = 0 };
     if (p.pn == e->paragraphs) {
@@ -276,6 +384,7 @@ fn(const ui_edit_run_t*, paragraph_runs)(ui_edit_t* e, int32_t pn,
             ui_edit_run_t* run = p->run;
             run[0].bp = 0;
             run[0].gp = 0;
+            run[0].gx = null;
             int32_t gc = p->bytes == 0 ? 0 : ns(word_break)(e, pn, 0);
             if (gc == p->glyphs) { // whole paragraph fits into width
                 p->runs = 1;
@@ -293,6 +402,7 @@ fn(const ui_edit_run_t*, paragraph_runs)(ui_edit_t* e, int32_t pn,
                     assert(rc < max_runs);
                     run[rc].bp = (int32_t)(text - p->text);
                     run[rc].gp = ix;
+                    run[rc].gx = null;
                     int32_t glyphs = ns(word_break)(e, pn, rc);
                     int32_t utf8bytes = p->g2b[ix + glyphs] - run[rc].bp;
                     int32_t pixels = ns(text_width)(e, text, utf8bytes);
@@ -340,6 +450,58 @@ fn(int32_t, glyphs_in_paragraph)(ui_edit_t* e, int32_t pn) {
     return e->para[pn].glyphs;
 }
 
+fn(void, dispose_runs_gx)(ui_edit_t* e, ui_edit_para_t* p) {
+    for (int32_t j = 0; p->run != null && j < p->runs; j++) {
+        if (p->run[j].gx != null) {
+            ns(free)(&p->run[j].gx);
+            e->gx.bytes -= (p->run[j].glyphs + 1) * (int32_t)sizeof(int32_t);
+        }
+    }
+}
+
+fn(void, dispose_gx)(ui_edit_t* e) {
+    for (int32_t i = 0; i < e->paragraphs; i++) {
+        ns(dispose_runs_gx)(e, &e->para[i]);
+    }
+    assert(e->gx.bytes == 0);
+}
+
+// glyph_x() [glyphs + 1] x offsets of the glyphs of the run `rn`
+// from the run start. Built lazily on the first request and kept
+// until the layout is disposed or e->gx.limit is exceeded.
+// Proportional runs are measured at once by gdi.measure_offsets()
+// exactly as the whole run is painted by gdi.text_n().
+
+fn(const int32_t*, glyph_x)(ui_edit_t* e, int32_t pn, int32_t rn) {
+    int32_t runs = 0;
+    (void)ns(paragraph_runs)(e, pn, &runs);
+    assert(0 <= rn && rn < runs);
+    ui_edit_para_t* p = &e->para[pn];
+    ui_edit_run_t* r = &p->run[rn];
+    if (r->gx == null) {
+        const int32_t bytes = (r->glyphs + 1) * (int32_t)sizeof(int32_t);
+        if (e->gx.bytes + bytes > e->gx.limit) { ns(dispose_gx)(e); }
+        ns(allocate)(&r->gx, r->glyphs + 1, sizeof(int32_t));
+        e->gx.bytes += bytes;
+        const char* text = p->text + r->bp;
+        const int32_t* g2b = &p->g2b[r->gp];
+        r->gx[0] = 0;
+        const bool measured = !e->mono.on && r->glyphs ==
+            gdi.measure_offsets(*e->view.font, text, r->bytes,
+                                r->gx, r->glyphs);
+        // monospaced (or invalid UTF-8 as code points differ) glyph by
+        // glyph: prefixes of the run would be O(glyphs^2) measurements
+        for (int32_t k = 1; k <= r->glyphs && !measured; k++) {
+            const char* g = text + g2b[k - 1] - r->bp;
+            const int32_t n = g2b[k] - g2b[k - 1];
+            r->gx[k] = r->gx[k - 1] + (e->mono.on ?
+                ns(mono_glyph_width)(e, g, n, r->gx[k - 1]) :
+                ns(measure_width)(e, g, n));
+        }
+    }
+    return r->gx;
+}
+
 fn(void, create_caret)(ui_edit_t* e) {
     fatal_if(e->focused);
     assert(app.is_active());
@@ -385,6 +547,7 @@ fn(void, dispose_paragraphs_layout)(ui_edit_t* e) {
     for (int32_t i = 0; i < e->paragraphs; i++) {
         ui_edit_para_t* p = &e->para[i];
         if (p->run != null) {
+            ns(dispose_runs_gx)(e, p);
             ns(free)(&p->run);
         }
         if (p->g2b != null) {
@@ -418,6 +581,7 @@ fn(void, set_font)(ui_edit_t* e, ui_font_t* f) {
     e->scroll.rn = 0;
     e->view.font = f;
     e->view.em = gdi.get_em(*f);
+    ns(mono_measure)(e);
     ns(layout_now)(e);
 }
 
@@ -485,6 +649,113 @@ fn(int32_t, first_visible_run)(ui_edit_t* e, int32_t pn) {
     return pn == e->scroll.pn ? e->scroll.rn : 0;
 }
 
+// pg_to_row() number of visible `run' (row) containing `pg' counted from
+// the top of the view: -1 above the view, visible_runs + 1 below it
+
+fn(int32_t, pg_to_row)(ui_edit_t* e, ui_edit_pg_t pg) {
+    const int32_t limit = e->visible_runs + 1; // partially visible
+    if (pg.pn >= e->paragraphs) {
+        pg = (ui_edit_pg_t){ .pn = e->paragraphs, .gp = 0 };
+    } else {
+        ns(paragraph_g2b)(e, pg.pn);
+        pg.gp = max(0, min(pg.gp, e->para[pg.pn].glyphs));
+    }
+    const ui_edit_pr_t pr = ns(pg_to_pr)(e, pg);
+    int32_t row = 0;
+    if (ns(uint64)(pr.pn, pr.rn) < ns(uint64)(e->scroll.pn, e->scroll.rn)) {
+        row = -1;
+    } else {
+        for (int32_t i = e->scroll.pn; i < pr.pn && row <= limit; i++) {
+            row += ns(paragraph_run_count)(e, i) - ns(first_visible_run)(e, i);
+        }
+        row += pr.rn - ns(first_visible_run)(e, pr.pn);
+    }
+    return min(row, limit);
+}
+
+// invalidate_rows() [r0..r1] inclusive horizontal band of the view
+
+fn(void, invalidate_rows)(ui_edit_t* e, int32_t r0, int32_t r1) {
+    const int32_t y0 = e->top + max(0, r0) * e->view.em.y;
+    const int32_t y1 = min(e->view.h, e->top + (r1 + 1) * e->view.em.y);
+    if (r1 >= 0 && y0 < y1) {
+        ui_rect_t rc = { e->view.x, e->view.y + y0, e->view.w, y1 - y0 };
+        app.invalidate(&rc);
+    }
+}
+
+fn(void, invalidate_range)(ui_edit_t* e, ui_edit_pg_t pg0,
+        ui_edit_pg_t pg1) {
+    int32_t r0 = ns(pg_to_row)(e, pg0);
+    int32_t r1 = ns(pg_to_row)(e, pg1);
+    ns(invalidate_rows)(e, min(r0, r1), max(r0, r1));
+}
+
+// damage_text() must be called before paragraph `pn` is modified
+
+fn(void, damage_text)(ui_edit_t* e, int32_t pn) {
+    if (e->painted.pn < 0) {
+        e->painted.pn = pn;
+        e->painted.runs = pn < e->paragraphs && e->view.w > 0 ?
+            ns(paragraph_run_count)(e, pn) : -1;
+    } else if (e->painted.pn != pn) {
+        e->painted.pn = min(e->painted.pn, pn);
+        e->painted.reflow = true;
+    }
+}
+
+// invalidate() only the bands of the view that differ from the last
+// paint(): modified runs of the edited paragraph (everything below it
+// when run or paragraph count changed) and the difference between
+// painted and current selection. Caret is not painted by the view.
+
+fn(void, invalidate)(ui_edit_t* e) {
+    const bool full = !e->painted.valid || e->view.w == 0 ||
+        e->painted.w != e->view.w || e->painted.h != e->view.h ||
+        e->painted.em_y != e->view.em.y ||
+        e->painted.scroll.pn != e->scroll.pn ||
+        e->painted.scroll.rn != e->scroll.rn;
+    if (full) {
+        e->view.invalidate(&e->view);
+    } else {
+        const int32_t pn = e->painted.pn;
+        if (pn >= 0) {
+            const bool reflow = e->painted.reflow || pn >= e->paragraphs ||
+                e->painted.paragraphs != e->paragraphs ||
+                e->painted.runs != ns(paragraph_run_count)(e, pn);
+            const int32_t r0 = ns(pg_to_row)(e, (ui_edit_pg_t){pn, 0});
+            const int32_t r1 = reflow ? e->visible_runs + 1 :
+                r0 + ns(paragraph_run_count)(e, pn) - 1;
+            ns(invalidate_rows)(e, r0, r1);
+        }
+        ui_edit_pg_t s[2] = { e->painted.selection[0],
+                              e->painted.selection[1] };
+        ui_edit_pg_t t[2] = { e->selection[0], e->selection[1] };
+        uint64_t s0 = ns(uint64)(s[0].pn, s[0].gp);
+        uint64_t s1 = ns(uint64)(s[1].pn, s[1].gp);
+        uint64_t t0 = ns(uint64)(t[0].pn, t[0].gp);
+        uint64_t t1 = ns(uint64)(t[1].pn, t[1].gp);
+        if (s0 > s1) {
+            uint64_t u = s0; s0 = s1; s1 = u;
+            ui_edit_pg_t pg = s[0]; s[0] = s[1]; s[1] = pg;
+        }
+        if (t0 > t1) {
+            uint64_t u = t0; t0 = t1; t1 = u;
+            ui_edit_pg_t pg = t[0]; t[0] = t[1]; t[1] = pg;
+        }
+        if (s0 == s1 && t0 == t1) {
+            // no selection painted and none to paint
+        } else if (s0 == t0) {
+            if (s1 != t1) { ns(invalidate_range)(e, s[1], t[1]); }
+        } else if (s1 == t1) {
+            ns(invalidate_range)(e, s[0], t[0]);
+        } else {
+            if (s0 != s1) { ns(invalidate_range)(e, s[0], s[1]); }
+            if (t0 != t1) { ns(invalidate_range)(e, t[0], t[1]); }
+        }
+    }
+}
+
 // ui_edit::pg_to_xy() paragraph # glyph # -> (x,y) in [0,0  width x height]
 
 fn(ui_point_t, pg_to_xy)(ui_edit_t* e, const ui_edit_pg_t pg) {
@@ -498,10 +769,7 @@ fn(ui_point_t, pg_to_xy)(ui_edit_t* e, const ui_edit_pg_t pg) {
             if (i == pg.pn) {
                 // in the last `run` of a paragraph x after last glyph is OK
                 if (run[j].gp <= pg.gp && pg.gp < run[j].gp + gc + last_run) {
-                    const char* s = e->para[i].text + run[j].bp;
-                    int32_t ofs = ns(gp_to_bytes)(s, run[j].bytes,
-                        pg.gp - run[j].gp);
-                    pt.x = ns(text_width)(e, s, ofs);
+                    pt.x = ns(glyph_x)(e, i, j)[pg.gp - run[j].gp];
                     break;
                 }
             }
@@ -518,15 +786,14 @@ fn(ui_point_t, pg_to_xy)(ui_edit_t* e, const ui_edit_pg_t pg) {
 }
 
 fn(int32_t, glyph_width_px)(ui_edit_t* e, const ui_edit_pg_t pg) {
-    char* text = e->para[pg.pn].text;
     int32_t gc = e->para[pg.pn].glyphs;
     if (pg.gp == 0 &&  gc == 0) {
         return 0; // empty paragraph
     } else if (pg.gp < gc) {
-        char* s = text + ns(gp_to_bytes)(text, e->para[pg.pn].bytes, pg.gp);
-        int32_t bytes_in_glyph = ns(glyph_bytes)(*s);
-        int32_t x = ns(text_width)(e, s, bytes_in_glyph);
-        return x;
+        const int32_t rn = ns(pg_to_pr)(e, pg).rn;
+        const int32_t* gx = ns(glyph_x)(e, pg.pn, rn);
+        const int32_t k = pg.gp - e->para[pg.pn].run[rn].gp;
+        return gx[k + 1] - gx[k];
     } else {
         assert(pg.gp == gc, "only next position past last glyph is allowed");
         return 0;
@@ -543,23 +810,24 @@ fn(ui_edit_pg_t, xy_to_pg)(ui_edit_t* e, int32_t x, int32_t y) {
         const ui_edit_run_t* run = ns(paragraph_runs)(e, i, &runs);
         for (int32_t j = ns(first_visible_run)(e, i); j < runs && pg.pn < 0; j++) {
             const ui_edit_run_t* r = &run[j];
-            char* s = e->para[i].text + run[j].bp;
             if (py <= y && y < py + e->view.em.y) {
-                int32_t w = ns(text_width)(e, s, r->bytes);
+                const int32_t* gx = ns(glyph_x)(e, i, j);
+                const int32_t last_run = j == runs - 1;
+                const int32_t last = max(0, r->glyphs - 1 + last_run);
                 pg.pn = i;
-                if (x >= w) {
-                    const int32_t last_run = j == runs - 1;
-                    pg.gp = r->gp + max(0, r->glyphs - 1 + last_run);
-                } else {
-                    pg.gp = r->gp + ns(glyph_at_x)(e, i, j, x);
-                    if (pg.gp < r->glyphs - 1) {
-                        ui_edit_pg_t right = {pg.pn, pg.gp + 1};
-                        int32_t x0 = ns(pg_to_xy)(e, pg).x;
-                        int32_t x1 = ns(pg_to_xy)(e, right).x;
-                        if (x1 - x < x - x0) {
-                            pg.gp++; // snap to closest glyph's 'x'
-                        }
+                if (r->glyphs == 0 || x >= gx[r->glyphs]) {
+                    pg.gp = r->gp + last;
+                } else { // binary search for gx[k] <= x < gx[k + 1]
+                    int32_t k = 0;
+                    int32_t n = r->glyphs;
+                    while (n - k > 1) {
+                        const int32_t m = (k + n) / 2;
+                        if (gx[m] <= x) { k = m; } else { n = m; }
+                    }
+                    if (x - gx[k] > gx[k + 1] - x) {
+                        k++; // snap to closest glyph's 'x'
                     }
+                    pg.gp = r->gp + min(k, last);
                 }
             } else {
                 py += e->view.em.y;
@@ -575,7 +843,7 @@ fn(ui_edit_pg_t, xy_to_pg)(ui_edit_t* e, int32_t x, int32_t y) {
 }
 
 fn(void, paint_selection)(ui_edit_t* e, const ui_edit_run_t* r,
-        const char* text, int32_t pn, int32_t c0, int32_t c1) {
+        int32_t pn, int32_t c0, int32_t c1) {
     uint64_t s0 = ns(uint64)(e->selection[0].pn, e->selection[0].gp);
     uint64_t e0 = ns(uint64)(e->selection[1].pn, e->selection[1].gp);
     if (s0 > e0) {
@@ -589,12 +857,10 @@ fn(void, paint_selection)(ui_edit_t* e, const ui_edit_run_t* r,
         uint64_t start = max(s0, s1) - c0;
         uint64_t end = min(e0, e1) - c0;
         if (start < end) {
-            int32_t fro = (int32_t)start;
-            int32_t to  = (int32_t)end;
-            int32_t ofs0 = ns(gp_to_bytes)(text, r->bytes, fro);
-            int32_t ofs1 = ns(gp_to_bytes)(text, r->bytes, to);
-            int32_t x0 = ns(text_width)(e, text, ofs0);
-            int32_t x1 = ns(text_width)(e, text, ofs1);
+            const int32_t rn = (int32_t)(r - e->para[pn].run);
+            const int32_t* gx = ns(glyph_x)(e, pn, rn);
+            int32_t x0 = gx[(int32_t)start];
+            int32_t x1 = gx[(int32_t)end];
             ui_brush_t b = gdi.set_brush(gdi.brush_color);
             ui_color_t c = gdi.set_brush_color(rgb(48, 64, 72));
             gdi.fill(gdi.x + x0, gdi.y, x1 - x0, e->view.em.y);
@@ -604,6 +870,37 @@ fn(void, paint_selection)(ui_edit_t* e, const ui_edit_run_t* r,
     }
 }
 
+// mono_paint_run() draws consecutive narrow glyphs with a single call
+// and everything else glyph by glyph at the arithmetic positions so
+// that painted text always agrees with caret and selection math
+
+fn(void, mono_paint_run)(ui_edit_t* e, const char* text, int32_t bytes) {
+    const int32_t x0 = gdi.x;
+    int32_t x = 0;
+    int32_t i = 0;
+    while (i < bytes) {
+        int32_t n = ns(glyph_bytes)(text[i]);
+        const int32_t c = ns(mono_class)(ns(codepoint)(text + i, n));
+        int32_t w = 0;
+        if (c == ui_edit_mono_narrow) {
+            while (i + n < bytes && ns(mono_class)(ns(codepoint)(text + i + n,
+                   ns(glyph_bytes)(text[i + n]))) == ui_edit_mono_narrow) {
+                n += ns(glyph_bytes)(text[i + n]);
+            }
+            w = ns(mono_width)(e, text + i, n);
+        } else {
+            w = ns(mono_glyph_width)(e, text + i, n, x);
+        }
+        if (c != ui_edit_mono_tab) {
+            gdi.x = x0 + x;
+            gdi.text_n(text + i, n);
+        }
+        x += w;
+        i += n;
+    }
+    gdi.x = x0 + x;
+}
+
 fn(void, paint_paragraph)(ui_edit_t* e, int32_t pn) {
     int32_t runs = 0;
     const ui_edit_run_t* run = ns(paragraph_runs)(e, pn, &runs);
@@ -611,8 +908,12 @@ fn(void, paint_paragraph)(ui_edit_t* e, int32_t pn) {
                  j < runs && gdi.y < e->view.y + e->bottom; j++) {
         char* text = e->para[pn].text + run[j].bp;
         gdi.x = e->view.x;
-        ns(paint_selection)(e, &run[j], text, pn, run[j].gp, run[j].gp + run[j].glyphs);
-        gdi.text("%.*s", run[j].bytes, text);
+        ns(paint_selection)(e, &run[j], pn, run[j].gp, run[j].gp + run[j].glyphs);
+        if (e->mono.on) {
+            ns(mono_paint_run)(e, text, run[j].bytes);
+        } else {
+            gdi.text_n(text, run[j].bytes);
+        }
         gdi.y += e->view.em.y;
     }
 }
@@ -748,6 +1049,179 @@ fn(void, move_caret)(ui_edit_t* e, const ui_edit_pg_t pg) {
     }
 }
 
+// stats_count() of bytes [b0..b1) of the text of single paragraph
+
+fn(ui_edit_stats_t, stats_count)(const char* s, int32_t b0, int32_t b1) {
+    ui_edit_stats_t st = { .bytes = b1 - b0, .lines = 1 };
+    for (int32_t i = b0; i < b1; i++) {
+        const bool space = s[i] == 0x20 || s[i] == '\t';
+        if ((s[i] & 0xC0) != 0x80) { st.glyphs++; }
+        if (!space && (i == b0 || s[i - 1] == 0x20 || s[i - 1] == '\t')) {
+            st.words++;
+        }
+    }
+    return st;
+}
+
+fn(void, stats_add)(ui_edit_stats_t* st, const ui_edit_stats_t* d,
+        int32_t sign) {
+    st->bytes  += sign * d->bytes;
+    st->glyphs += sign * d->glyphs;
+    st->words  += sign * d->words;
+    st->lines  += sign * d->lines;
+}
+
+// stats_rebuild() Fenwick tree in O(paragraphs) from para[].stats
+
+fn(void, stats_rebuild)(ui_edit_t* e) {
+    const int32_t n = e->paragraphs;
+    if (e->stats.capacity < n + 1) {
+        int32_t c = (n + 1) * 3 / 2; // 1.5 times
+        ns(reallocate)(&e->stats.tree, c, sizeof(ui_edit_stats_t));
+        e->stats.capacity = c;
+    }
+    ui_edit_stats_t* t = e->stats.tree;
+    memset(&t[0], 0, sizeof(t[0]));
+    for (int32_t i = 1; i <= n; i++) { t[i] = e->para[i - 1].stats; }
+    for (int32_t i = 1; i <= n; i++) {
+        const int32_t j = i + (i & -i);
+        if (j <= n) { ns(stats_add)(&t[j], &t[i], +1); }
+    }
+    e->stats.rebuild = false;
+}
+
+// stats_paragraph() recounts paragraph `pn` after it has been modified
+
+fn(void, stats_paragraph)(ui_edit_t* e, int32_t pn) {
+    assert(0 <= pn && pn < e->paragraphs);
+    ui_edit_para_t* p = &e->para[pn];
+    const ui_edit_stats_t st = ns(stats_count)(p->text, 0, p->bytes);
+    if (!e->stats.rebuild) {
+        ui_edit_stats_t d = st;
+        ns(stats_add)(&d, &p->stats, -1);
+        for (int32_t i = pn + 1; i <= e->paragraphs; i += i & -i) {
+            ns(stats_add)(&e->stats.tree[i], &d, +1);
+        }
+    }
+    p->stats = st;
+}
+
+// hash64() fast non-cryptographic hash of paragraph content. 16 bytes
+// blocks are accumulated into two 64-bit lanes with a block dependent
+// key (SSE2 when available, portable code computes identical values)
+// lanes are folded with fmix64 avalanche from MurmurHash3.
+
+fn(uint64_t, fmix64)(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+fn(uint64_t, hash64)(const char* s, int32_t bytes) {
+    const uint64_t k0 = 0x9E3779B185EBCA87ULL; // golden ratio primes
+    const uint64_t k1 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t i0 = 0x165667B19E3779F9ULL; // key increment per block
+    const uint64_t i1 = 0x27D4EB2F165667C5ULL;
+    const int32_t blocks = bytes / 16;
+    uint64_t lane[2];
+    #if defined(_M_X64) || defined(__SSE2__)
+        __m128i acc = _mm_setzero_si128();
+        __m128i key = _mm_set_epi64x((int64_t)k1, (int64_t)k0);
+        const __m128i inc = _mm_set_epi64x((int64_t)i1, (int64_t)i0);
+        for (int32_t i = 0; i < blocks; i++) {
+            const __m128i d  = _mm_loadu_si128((const __m128i*)(s + i * 16));
+            const __m128i dk = _mm_xor_si128(d, key);
+            const __m128i m  = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            acc = _mm_add_epi64(acc, _mm_add_epi64(m, d));
+            key = _mm_add_epi64(key, inc);
+        }
+        _mm_storeu_si128((__m128i*)lane, acc);
+        uint64_t key0 = k0 + i0 * (uint64_t)blocks;
+        uint64_t key1 = k1 + i1 * (uint64_t)blocks;
+    #else
+        lane[0] = 0;
+        lane[1] = 0;
+        uint64_t key0 = k0;
+        uint64_t key1 = k1;
+        for (int32_t i = 0; i < blocks; i++) {
+            uint64_t d[2];
+            memcpy(d, s + i * 16, sizeof(d)); // little endian
+            const uint64_t dk0 = d[0] ^ key0;
+            const uint64_t dk1 = d[1] ^ key1;
+            lane[0] += (dk0 & 0xFFFFFFFFu) * (dk0 >> 32) + d[0];
+            lane[1] += (dk1 & 0xFFFFFFFFu) * (dk1 >> 32) + d[1];
+            key0 += i0;
+            key1 += i1;
+        }
+    #endif
+    const int32_t rest = bytes - blocks * 16;
+    if (rest > 0) { // zero padded last block
+        uint64_t d[2] = {0, 0};
+        memcpy(d, s + blocks * 16, rest);
+        const uint64_t dk0 = d[0] ^ key0;
+        const uint64_t dk1 = d[1] ^ key1;
+        lane[0] += (dk0 & 0xFFFFFFFFu) * (dk0 >> 32) + d[0];
+        lane[1] += (dk1 & 0xFFFFFFFFu) * (dk1 >> 32) + d[1];
+    }
+    const uint64_t h1 = ns(fmix64)(lane[1] ^ (uint64_t)bytes);
+    return ns(fmix64)(lane[0] ^ (uint64_t)bytes) ^ ((h1 << 31) | (h1 >> 33));
+}
+
+// paragraph_changed() must be called after paragraph `pn` is modified
+
+fn(void, paragraph_changed)(ui_edit_t* e, int32_t pn) {
+    ns(stats_paragraph)(e, pn);
+    e->para[pn].hash = ns(hash64)(e->para[pn].text, e->para[pn].bytes);
+}
+
+// stats_prefix() totals of paragraphs [0..pn)
+
+fn(ui_edit_stats_t, stats_prefix)(ui_edit_t* e, int32_t pn) {
+    ui_edit_stats_t st = {0};
+    for (int32_t i = pn; i > 0; i -= i & -i) {
+        ns(stats_add)(&st, &e->stats.tree[i], +1);
+    }
+    return st;
+}
+
+fn(ui_edit_stats_t, statistics)(ui_edit_t* e, ui_edit_pg_t from,
+        ui_edit_pg_t to) {
+    if (e->stats.rebuild || e->stats.tree == null) { ns(stats_rebuild)(e); }
+    uint64_t f = ns(uint64)(from.pn, from.gp);
+    uint64_t t = ns(uint64)(to.pn, to.gp);
+    if (f > t) { uint64_t swap = t; t = f; f = swap; }
+    ui_edit_stats_t st = {0};
+    if (f != t) {
+        int32_t pn0 = (int32_t)(f >> 32);
+        int32_t gp0 = (int32_t)(f);
+        int32_t pn1 = (int32_t)(t >> 32);
+        int32_t gp1 = (int32_t)(t);
+        assert(0 <= pn0 && pn0 < e->paragraphs && pn1 <= e->paragraphs);
+        const ui_edit_para_t* p0 = &e->para[pn0];
+        const int32_t bp0 = ns(gp_to_bytes)(p0->text, p0->bytes, gp0);
+        if (pn0 == pn1) {
+            const int32_t bp1 = ns(gp_to_bytes)(p0->text, p0->bytes, gp1);
+            st = ns(stats_count)(p0->text, bp0, bp1);
+        } else {
+            st = ns(stats_count)(p0->text, bp0, p0->bytes);
+            ui_edit_stats_t middle = ns(stats_prefix)(e, pn1);
+            ui_edit_stats_t head = ns(stats_prefix)(e, pn0 + 1);
+            ns(stats_add)(&middle, &head, -1);
+            ns(stats_add)(&st, &middle, +1);
+            if (pn1 < e->paragraphs) {
+                const ui_edit_para_t* p1 = &e->para[pn1];
+                const int32_t bp1 = ns(gp_to_bytes)(p1->text, p1->bytes, gp1);
+                ui_edit_stats_t tail = ns(stats_count)(p1->text, 0, bp1);
+                ns(stats_add)(&st, &tail, +1);
+            }
+        }
+    }
+    return st;
+}
+
 fn(char*, ensure)(ui_edit_t* e, int32_t pn, int32_t bytes,
         int32_t preserve) {
     assert(bytes >= 0 && preserve <= bytes);
@@ -788,12 +1262,16 @@ fn(ui_edit_pg_t, op)(ui_edit_t* e, bool cut,
     uint64_t f = ns(uint64)(from.pn, from.gp);
     uint64_t t = ns(uint64)(to.pn, to.gp);
     if (f != t) {
-        ns(dispose_paragraphs_layout)(e);
         if (f > t) { uint64_t swap = t; t = f; f = swap; }
         int32_t pn0 = (int32_t)(f >> 32);
         int32_t gp0 = (int32_t)(f);
         int32_t pn1 = (int32_t)(t >> 32);
         int32_t gp1 = (int32_t)(t);
+        if (cut) {
+            ns(damage_text)(e, pn0);
+            if (pn1 != pn0) { e->painted.reflow = true; }
+        }
+        ns(dispose_paragraphs_layout)(e);
         if (pn1 == e->paragraphs) { // last empty paragraph
             assert(gp1 == 0);
             pn1 = e->paragraphs - 1;
@@ -819,6 +1297,7 @@ fn(ui_edit_pg_t, op)(ui_edit_t* e, bool cut,
                 memcpy(s0 + bp0, s1 + bp1, (size_t)bytes0 - bp1);
                 e->para[pn0].bytes -= (bp1 - bp0);
                 e->para[pn0].glyphs = -1; // will relayout
+                ns(paragraph_changed)(e, pn0);
             }
         } else {
             clip_append(a, ab, limit, s0 + bp0, bytes0 - bp0);
@@ -838,6 +1317,7 @@ fn(ui_edit_pg_t, op)(ui_edit_t* e, bool cut,
                 memcpy(s0 + bp0, s1 + bp1, (size_t)bytes1 - bp1);
                 e->para[pn0].bytes = bp0 + bytes1 - bp1;
                 e->para[pn0].glyphs = -1; // will relayout
+                ns(paragraph_changed)(e, pn0);
             }
         }
         int32_t deleted = cut ? pn1 - pn0 : 0;
@@ -860,6 +1340,7 @@ fn(ui_edit_pg_t, op)(ui_edit_t* e, bool cut,
         }
         if (a != null) { assert(a == text + limit); }
         e->paragraphs -= deleted;
+        if (deleted > 0) { e->stats.rebuild = true; }
         from.pn = pn0;
         from.gp = gp0;
     } else {
@@ -874,6 +1355,8 @@ fn(ui_edit_pg_t, op)(ui_edit_t* e, bool cut,
 }
 
 fn(void, insert_paragraph)(ui_edit_t* e, int32_t pn) {
+    ns(damage_text)(e, pn);
+    e->painted.reflow = true;
     ns(dispose_paragraphs_layout)(e);
     if (e->paragraphs + 1 > e->capacity / (int32_t)sizeof(ui_edit_para_t)) {
         int32_t n = (e->paragraphs + 1) * 3 / 2; // 1.5 times
@@ -893,6 +1376,10 @@ fn(void, insert_paragraph)(ui_edit_t* e, int32_t pn) {
     p->run = null;
     p->g2b = null;
     p->g2b_capacity = 0;
+    memset(&p->stats, 0, sizeof(p->stats));
+    p->stats.lines = 1;
+    p->hash = ns(hash64)("", 0);
+    e->stats.rebuild = true;
 }
 
 // insert_inline() inserts text (not containing \n paragraph
@@ -906,6 +1393,7 @@ fn(ui_edit_pg_t, insert_inline)(ui_edit_t* e, ui_edit_pg_t pg,
     if (pg.pn == e->paragraphs) {
         ns(insert_paragraph)(e, pg.pn);
     }
+    ns(damage_text)(e, pg.pn);
     const int32_t b = e->para[pg.pn].bytes;
     ns(paragraph_g2b)(e, pg.pn);
     char* s = e->para[pg.pn].text;
@@ -926,6 +1414,7 @@ fn(ui_edit_pg_t, insert_inline)(ui_edit_t* e, ui_edit_pg_t pg,
     memmove(s + bp + bytes, s + bp, (size_t)b - bp); // make space
     memcpy(s + bp, text, bytes);
     e->para[pg.pn].bytes += bytes;
+    ns(paragraph_changed)(e, pg.pn);
     ns(dispose_paragraphs_layout)(e);
     pg.gp = ns(glyphs)(s, bp + bytes);
     ns(if_sle_layout)(e);
@@ -934,6 +1423,7 @@ fn(ui_edit_pg_t, insert_inline)(ui_edit_t* e, ui_edit_pg_t pg,
 
 fn(ui_edit_pg_t, insert_paragraph_break)(ui_edit_t* e,
         ui_edit_pg_t pg) {
+    ns(damage_text)(e, pg.pn); // truncated, paragraphs below it shifted
     ns(insert_paragraph)(e, pg.pn + (pg.pn < e->paragraphs));
     const int32_t bytes = e->para[pg.pn].bytes;
     char* s = e->para[pg.pn].text;
@@ -946,6 +1436,7 @@ fn(ui_edit_pg_t, insert_paragraph_break)(ui_edit_t* e,
         ns(dispose_paragraphs_layout)(e);
     }
     e->para[pg.pn].bytes = bp;
+    ns(paragraph_changed)(e, pg.pn);
     return next;
 }
 
@@ -1614,10 +2105,177 @@ fn(void, clipboard_paste)(ui_edit_t* e) {
     }
 }
 
+// Autosave journal is a sequence of records each replacing `deleted`
+// paragraphs starting at `pn` with `inserted` paragraphs that follow
+// the record header as {int32_t bytes; char text[bytes]}.
+
+enum { ui_edit_journal_magic = 0x6E726A75 }; // "ujrn"
+
+typedef struct ui_edit_journal_record_s {
+    uint32_t magic;
+    int32_t  pn;
+    int32_t  deleted;
+    int32_t  inserted;
+    int32_t  paragraphs; // number of paragraphs after the record is applied
+} ui_edit_journal_record_t;
+
+fn(errno_t, autosave)(ui_edit_t* e, const char* filename) {
+    const int32_t n0 = e->journal.paragraphs;
+    const int32_t n1 = e->paragraphs;
+    const uint64_t* saved = e->journal.hash;
+    int32_t head = 0; // unchanged paragraphs at the beginning
+    while (head < n0 && head < n1 && saved[head] == e->para[head].hash) {
+        head++;
+    }
+    int32_t tail = 0; // unchanged paragraphs at the end
+    while (tail < n0 - head && tail < n1 - head &&
+           saved[n0 - 1 - tail] == e->para[n1 - 1 - tail].hash) {
+        tail++;
+    }
+    ui_edit_journal_record_t r = {
+        .magic = ui_edit_journal_magic,
+        .pn = head,
+        .deleted = n0 - head - tail,
+        .inserted = n1 - head - tail,
+        .paragraphs = n1
+    };
+    errno_t err = 0;
+    const bool first = e->journal.records == 0;
+    if (first || r.deleted > 0 || r.inserted > 0) {
+        // first record truncates the journal to a complete snapshot:
+        FILE* f = fopen(filename, first ? "wb" : "ab");
+        if (f == null) { err = errno; }
+        bool ok = f != null && fwrite(&r, sizeof(r), 1, f) == 1;
+        for (int32_t i = head; ok && i < head + r.inserted; i++) {
+            const ui_edit_para_t* p = &e->para[i];
+            ok = fwrite(&p->bytes, sizeof(p->bytes), 1, f) == 1 &&
+                 fwrite(p->text, 1, p->bytes, f) == (size_t)p->bytes;
+        }
+        if (f != null) {
+            ok = fflush(f) == 0 && ok;
+            if (!ok) { err = errno != 0 ? errno : EIO; }
+            fclose(f);
+        }
+        if (err == 0) {
+            if (e->journal.capacity < n1) {
+                int32_t c = max(16, n1 * 3 / 2);
+                ns(reallocate)(&e->journal.hash, c, sizeof(uint64_t));
+                e->journal.capacity = c;
+            }
+            for (int32_t i = 0; i < n1; i++) {
+                e->journal.hash[i] = e->para[i].hash;
+            }
+            e->journal.paragraphs = n1;
+            e->journal.records++;
+        }
+    }
+    return err;
+}
+
+// recover() replays all complete records of the journal and replaces
+// the content of the edit control with the result. Incomplete trailing
+// record (crash while writing) is ignored. Returns EINVAL and leaves the
+// text untouched when not even the first record (snapshot) is complete.
+
+fn(errno_t, recover)(ui_edit_t* e, const char* filename) {
+    errno_t err = 0;
+    FILE* f = fopen(filename, "rb");
+    int64_t size = -1;
+    if (f == null) {
+        err = errno;
+    } else if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 ||
+               fseek(f, 0, SEEK_SET) != 0) {
+        err = errno != 0 ? errno : EIO;
+    } else if (size > INT32_MAX) {
+        err = EFBIG;
+    }
+    char* data = null;
+    if (err == 0 && size > 0) {
+        data = ns(alloc)((int32_t)size);
+        if (fread(data, 1, (size_t)size, f) != (size_t)size) {
+            err = errno != 0 ? errno : EIO;
+        }
+    }
+    if (f != null) { fclose(f); }
+    typedef struct { const char* s; int32_t bytes; } span_t;
+    span_t* para = null;
+    int32_t paragraphs = 0;
+    int32_t capacity = 0;
+    int32_t replayed = 0; // complete records
+    int64_t pos = 0;
+    while (err == 0 && pos + (int64_t)sizeof(ui_edit_journal_record_t) <= size) {
+        ui_edit_journal_record_t r;
+        memcpy(&r, data + pos, sizeof(r));
+        pos += sizeof(r);
+        const bool valid = r.magic == ui_edit_journal_magic &&
+            0 <= r.pn && 0 <= r.deleted && 0 <= r.inserted &&
+            (int64_t)r.pn + r.deleted <= paragraphs &&
+            (int64_t)r.paragraphs ==
+                (int64_t)paragraphs - r.deleted + r.inserted;
+        if (!valid) { break; }
+        // check that all inserted paragraphs were completely written:
+        int64_t end = pos;
+        for (int32_t i = 0; i < r.inserted && end >= 0; i++) {
+            int32_t bytes = -1;
+            if (end + (int64_t)sizeof(bytes) <= size) {
+                memcpy(&bytes, data + end, sizeof(bytes));
+            }
+            end = bytes < 0 || end + (int64_t)sizeof(bytes) + bytes > size ?
+                -1 : end + (int64_t)sizeof(bytes) + bytes;
+        }
+        if (end < 0) { break; }
+        if (capacity < r.paragraphs) {
+            capacity = max(16, r.paragraphs * 3 / 2);
+            ns(reallocate)(&para, capacity, sizeof(span_t));
+        }
+        const int32_t moved = paragraphs - r.pn - r.deleted;
+        if (moved > 0) {
+            memmove(para + r.pn + r.inserted, para + r.pn + r.deleted,
+                    moved * sizeof(span_t));
+        }
+        for (int32_t i = 0; i < r.inserted; i++) {
+            span_t* sp = &para[r.pn + i];
+            memcpy(&sp->bytes, data + pos, sizeof(sp->bytes));
+            pos += sizeof(sp->bytes);
+            sp->s = data + pos;
+            pos += sp->bytes;
+        }
+        paragraphs = r.paragraphs;
+        replayed++;
+    }
+    if (err == 0 && replayed == 0) { err = EINVAL; }
+    if (err == 0) {
+        int64_t total = 0;
+        for (int32_t i = 0; i < paragraphs; i++) { total += para[i].bytes + 1; }
+        fatal_if(total > INT32_MAX, "total: %lld", total);
+        char* text = ns(alloc)((int32_t)total + 1);
+        char* t = text;
+        for (int32_t i = 0; i < paragraphs; i++) {
+            memcpy(t, para[i].s, para[i].bytes);
+            t += para[i].bytes;
+            if (i < paragraphs - 1) { *t++ = '\n'; }
+        }
+        *t = 0;
+        const bool ro = e->ro;
+        e->ro = false;
+        e->select_all(e);
+        e->paste(e, text, (int32_t)(t - text));
+        e->ro = ro;
+        ns(free)(&text);
+        // next autosave() starts the journal over with a snapshot:
+        e->journal.paragraphs = 0;
+        e->journal.records = 0;
+    }
+    if (para != null) { ns(free)(&para); }
+    if (data != null) { ns(free)(&data); }
+    return err;
+}
+
 fn(void, measure)(ui_view_t* view) { // bottom up
     assert(view->type == ui_view_edit);
     ui_edit_t* e = (ui_edit_t*)view;
     view->em = gdi.get_em(view->font == null ? app.fonts.regular : *view->font);
+    ns(mono_measure)(e);
     // enforce minimum size - it makes it checking corner cases much simpler
     // and it's hard to edit anything in a smaller area - will result in bad UX
     if (view->w < view->em.x * 4) { view->w = view->em.x * 4; }
@@ -1692,6 +2350,16 @@ fn(void, paint)(ui_view_t* view) {
     gdi.set_font(f);
     gdi.set_clip(0, 0, 0, 0);
     gdi.pop();
+    e->painted.selection[0] = e->selection[0];
+    e->painted.selection[1] = e->selection[1];
+    e->painted.scroll = e->scroll;
+    e->painted.paragraphs = e->paragraphs;
+    e->painted.w = view->w;
+    e->painted.h = view->h;
+    e->painted.em_y = view->em.y;
+    e->painted.pn = -1;
+    e->painted.reflow = false;
+    e->painted.valid = true;
 }
 
 fn(void, move)(ui_edit_t* e, ui_edit_pg_t pg) {
@@ -1736,6 +2404,10 @@ void ns(init)(ui_edit_t* e) {
     e->ro        = false;
     e->view.color  = rgb(168, 168, 150); // colors.text;
     e->caret     = (ui_point_t){-1, -1};
+    e->painted.pn = -1; // no paragraph damaged since last paint()
+    e->mono.tab  = 4; // cells per TAB stop for monospaced fonts
+    e->stats.rebuild = true;
+    e->gx.limit  = 1024 * 1024; // bytes of glyph x offsets cache
     e->view.message = ns(message);
     e->view.paint   = ns(paint);
     e->view.measure = ns(measure);
@@ -1760,6 +2432,9 @@ void ns(init)(ui_edit_t* e) {
     e->copy_to_clipboard = ns(clipboard_copy);
     e->paste_from_clipboard = ns(clipboard_paste);
     e->select_all    = ns(select_all);
+    e->statistics    = ns(statistics);
+    e->autosave      = ns(autosave);
+    e->recover       = ns(recover);
     e->key_down      = ns(key_down);
     e->key_up        = ns(key_up);
     e->key_left      = ns(key_left);
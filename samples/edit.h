@@ -13,8 +13,16 @@ typedef struct ui_edit_run_s {
     int32_t bytes;  // number of bytes in this `run`
     int32_t glyphs; // number of glyphs in this `run`
     int32_t pixels; // width in pixels
+    int32_t* gx;    // null or [glyphs + 1] glyph x offsets (heap) see notes
 } ui_edit_run_t;
 
+typedef struct ui_edit_stats_s { // text statistics, see notes below (***)
+    int64_t bytes;  // utf-8 bytes not counting paragraph breaks
+    int64_t glyphs; // number of glyphs
+    int64_t words;  // sequences of glyphs separated by space or tab
+    int64_t lines;  // number of paragraphs
+} ui_edit_stats_t;
+
 // ui_edit_para_t.initially text will point to readonly memory
 // with .allocated == 0; as text is modified it is copied to
 // heap and reallocated there.
@@ -28,6 +36,8 @@ typedef struct ui_edit_para_s { // "paragraph"
     ui_edit_run_t* run; // [runs] array of pointers (heap)
     int32_t* g2b;        // [bytes + 1] glyph to uint8_t positions g2b[0] = 0
     int32_t  g2b_capacity; // number of bytes on heap allocated for g2b[]
+    ui_edit_stats_t stats; // as accounted in ui_edit_t.stats.tree
+    uint64_t hash;         // of text[bytes] updated on each modification
 } ui_edit_para_t;
 
 typedef struct ui_edit_pg_s { // page/glyph coordinates
@@ -70,6 +80,12 @@ typedef struct ui_edit_s {
     void (*key_enter)(ui_edit_t* e);
     // called when ENTER keyboard key is pressed in single line mode
     void (*enter)(ui_edit_t* e);
+    // statistics of text between two positions (in any order):
+    ui_edit_stats_t (*statistics)(ui_edit_t* e, ui_edit_pg_t from,
+                                  ui_edit_pg_t to);
+    // delta autosave journal (see notes below) returns error or 0:
+    errno_t (*autosave)(ui_edit_t* e, const char* filename);
+    errno_t (*recover)(ui_edit_t* e, const char* filename);
     // fuzzer test:
     void (*fuzz)(ui_edit_t* e);      // start/stop fuzzing test
     void (*next_fuzz)(ui_edit_t* e); // next fuzz input event(s)
@@ -86,6 +102,12 @@ typedef struct ui_edit_s {
     bool ro;       // Read Only
     bool sle;      // Single Line Edit
     int32_t shown; // debug: caret show/hide counter 0|1
+    struct { // see notes below (**)
+        bool    on;    // font is monospaced, widths are computed not measured
+        int32_t tab;   // TAB stop in em.x cells (default 4)
+        int32_t wide;  // pixel width of East Asian wide glyphs
+        int32_t emoji; // pixel width of emoji glyphs
+    } mono;
     // https://en.wikipedia.org/wiki/Fuzzing
     volatile thread_t fuzzer;     // fuzzer thread != null when fuzzing
     volatile int32_t  fuzz_count; // fuzzer event count
@@ -93,6 +115,33 @@ typedef struct ui_edit_s {
     volatile bool     fuzz_quit;  // last processed fuzz
     // random32 starts with 1 but client can seed it with (clock.nanoseconds() | 1)
     uint32_t fuzz_seed;    // fuzzer random32 seed (must start with odd number)
+    struct { // state as of the last paint() see notes below (****)
+        ui_edit_pg_t selection[2];
+        ui_edit_pr_t scroll;
+        int32_t paragraphs;
+        int32_t w;
+        int32_t h;
+        int32_t em_y;
+        int32_t pn;   // first paragraph modified since paint() or -1
+        int32_t runs; // number of runs in `pn` before modification
+        bool reflow;  // paragraphs or runs below `pn` may have moved
+        bool valid;   // false before the first paint()
+    } painted;
+    struct { // glyph x offsets cache ui_edit_run_t.gx
+        int32_t bytes; // allocated for all runs
+        int32_t limit; // all offsets are disposed when exceeded
+    } gx;
+    struct { // autosave journal state
+        uint64_t* hash;     // [paragraphs] para[].hash as of last autosave()
+        int32_t paragraphs; // number of paragraphs at last autosave()
+        int32_t capacity;   // number of allocated hash[] entries
+        int32_t records;    // written to the journal file
+    } journal;
+    struct { // document statistics
+        ui_edit_stats_t* tree; // Fenwick tree of para[].stats [paragraphs + 1]
+        int32_t capacity;      // number of allocated tree entries
+        bool rebuild;          // paragraphs were inserted or deleted
+    } stats;
     // paragraphs memory:
     int32_t capacity;      // number of bytes allocated for `para` array below
     int32_t paragraphs;    // number of lines in the text
@@ -131,6 +180,47 @@ typedef struct ui_edit_s {
                  IMPORTANT: SLE resizes itself vertically to accommodate for
                  input that is too wide. If caller wants to limit vertical space it
                  will need to hook .measure() function of SLE and do the math there.
+
+    .mono (**) - set by measure() and set_font() when gdi.is_mono(font).
+                 Layout, word breaking, caret and selection positions are then
+                 computed arithmetically: em.x per narrow glyph, .wide/.emoji
+                 measured once per font, TAB advancing to the next multiple of
+                 .tab cells from the start of the run. Glyphs outside of known
+                 ranges are still measured individually. Painting positions
+                 glyphs by the same math so caret and text always agree.
+
+    statistics() (***) - each edit recounts only the modified paragraph
+                 and updates binary indexed (Fenwick) tree of per paragraph
+                 counts in O(log(paragraphs)). Inserting or deleting
+                 paragraphs (already O(paragraphs) memmove) rebuilds the tree
+                 in linear time on the next query. Query for a range costs
+                 O(log(paragraphs)) plus scanning two partial end paragraphs:
+                     e->statistics(e, e->selection[0], e->selection[1]);
+                     e->statistics(e, (ui_edit_pg_t){0, 0},
+                                      (ui_edit_pg_t){e->paragraphs, 0});
+                 A word cut by the range boundary counts as a word.
+
+    .painted (****) - keystrokes, caret moves and selection changes do not
+                 invalidate the whole view. Only the runs of the modified
+                 paragraph are invalidated, everything below it if the number
+                 of its runs or of paragraphs changed, plus the rows where
+                 painted and current selection differ. Scrolling, resizing and
+                 font changes still invalidate the whole view.
+
+    .gx        - x offsets of glyphs inside each run are measured once on
+                 the first paint of selection, caret position or mouse hit
+                 test and cached with the run. Hit testing is a binary search.
+                 The cache is disposed with the paragraphs layout and
+                 completely when it grows over .gx.limit bytes (1MB default).
+
+    autosave() - appends to the journal file a single record replacing
+                 the range of paragraphs that changed since the previous
+                 autosave(). The range is found by comparing 64-bit content
+                 hashes of paragraphs from both ends, so the amount of data
+                 written is proportional to the edit not to the document.
+                 The first autosave() after init() or recover() truncates
+                 the journal and writes complete text.
+    recover()  - replays the journal after a crash and replaces the text.
 */
 
 void ui_edit_init(ui_edit_t* e);
@@ -254,4 +254,114 @@ void ui_edit_fuzz(ui_edit_t* e) {
     traceln("fuzzing %s",e->fuzzer != null ? "started" : "stopped");
 }
 
+// ui_edit_test_recover() autosaves a sequence of edits, truncates the
+// journal at every offset and checks that recover() restores the text
+// as of the last complete record or fails leaving the text untouched.
+
+static char* ui_edit_test_text(ui_edit_t* e, int32_t* bytes) {
+    *bytes = 0;
+    e->copy(e, null, bytes);
+    char* text = (char*)calloc((size_t)*bytes + 1, 1);
+    fatal_if_null(text);
+    int32_t n = *bytes;
+    e->copy(e, text, &n);
+    return text;
+}
+
+static int64_t ui_edit_test_file_size(const char* filename) {
+    FILE* f = fopen(filename, "rb");
+    fatal_if_null(f);
+    fatal_if(fseek(f, 0, SEEK_END) != 0);
+    const int64_t size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void ui_edit_test_autosave(ui_edit_t* e, const char* filename,
+        int64_t* end, char** text, int32_t* bytes, int32_t* records) {
+    fatal_if_not_zero(e->autosave(e, filename));
+    const int64_t size = ui_edit_test_file_size(filename);
+    if (*records == 0 || size > end[*records - 1]) {
+        end[*records] = size;
+        text[*records] = ui_edit_test_text(e, &bytes[*records]);
+        (*records)++;
+    }
+}
+
+void ui_edit_test_recover(void) {
+    enum { steps = 8 };
+    static ui_edit_t e;
+    static ui_edit_t r;
+    ui_edit_init(&e);
+    ui_edit_init(&r);
+    char filename[1024];
+    const char* temp = getenv("TEMP");
+    strprintf(filename, "%s\\ui_edit_test.journal", temp != null ? temp : ".");
+    int64_t end[steps] = {0};  // journal size after complete record
+    char* text[steps] = {0};   // expected text after the record
+    int32_t bytes[steps] = {0};
+    int32_t records = 0;
+    e.paste(&e, "alpha\nbeta\ngamma", -1);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    e.move(&e, (ui_edit_pg_t){ .pn = 1, .gp = 0 });
+    e.paste(&e, "inserted\n", -1);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    e.move(&e, (ui_edit_pg_t){ .pn = 0, .gp = 5 });
+    e.paste(&e, " tail", -1);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    e.selection[0] = (ui_edit_pg_t){ .pn = 1, .gp = 3 };
+    e.selection[1] = (ui_edit_pg_t){ .pn = 3, .gp = 1 };
+    e.erase(&e);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    e.move(&e, (ui_edit_pg_t){ .pn = 0, .gp = 2 });
+    e.paste(&e, "\n\n", -1);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    e.select_all(&e);
+    e.erase(&e);
+    ui_edit_test_autosave(&e, filename, end, text, bytes, &records);
+    fatal_if(records != steps - 1, "records: %d", records);
+    const int64_t size = end[records - 1];
+    char* data = (char*)malloc((size_t)size);
+    fatal_if_null(data);
+    FILE* f = fopen(filename, "rb");
+    fatal_if_null(f);
+    fatal_if(fread(data, 1, (size_t)size, f) != (size_t)size);
+    fclose(f);
+    const char* sentinel = "sentinel\ntext";
+    for (int64_t n = 0; n <= size; n++) {
+        f = fopen(filename, "wb");
+        fatal_if_null(f);
+        fatal_if(n > 0 && fwrite(data, 1, (size_t)n, f) != (size_t)n);
+        fclose(f);
+        r.select_all(&r);
+        r.paste(&r, sentinel, -1);
+        int32_t before_bytes = 0;
+        char* before = ui_edit_test_text(&r, &before_bytes);
+        int32_t k = 0; // complete records
+        while (k < records && end[k] <= n) { k++; }
+        const errno_t err = r.recover(&r, filename);
+        int32_t count = 0;
+        char* recovered = ui_edit_test_text(&r, &count);
+        if (k == 0) {
+            fatal_if(err == 0, "truncated at %lld", (long long)n);
+            fatal_if(count != before_bytes ||
+                memcmp(recovered, before, count) != 0,
+                "truncated at %lld: \"%s\"", (long long)n, recovered);
+        } else {
+            fatal_if(err != 0, "truncated at %lld: %d", (long long)n, err);
+            fatal_if(count != bytes[k - 1] ||
+                memcmp(recovered, text[k - 1], count) != 0,
+                "truncated at %lld: \"%s\" expected \"%s\"",
+                (long long)n, recovered, text[k - 1]);
+        }
+        free(recovered);
+        free(before);
+    }
+    fatal_if_not_zero(remove(filename));
+    free(data);
+    for (int32_t i = 0; i < records; i++) { free(text[i]); }
+    traceln("journal truncated at %lld offsets recovered", (long long)size + 1);
+}
+
 end_c
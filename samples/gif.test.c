@@ -0,0 +1,294 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2024 see LICENSE for details */
+#include "quick.h"
+
+begin_c
+
+// gif_test() encodes random animated GIFs (global and local palettes,
+// partial and interlaced frames, transparency, all disposal methods and
+// LZW table resets), composes expected frames with a straightforward
+// reference compositor and compares them with gif.next() output over
+// several animation loops. Truncated copies of the same files must
+// decode all complete frames exactly and must not crash on the rest.
+
+enum { gif_test_files = 200, gif_test_loops = 3 };
+
+typedef struct gif_test_s {
+    uint8_t* data; // encoded file
+    int64_t bytes;
+    int64_t capacity;
+    uint32_t seed;
+    // LZW encoder:
+    uint8_t* lzw; // packed codes
+    int64_t lzw_bytes;
+    uint32_t bits;
+    int32_t count; // bits
+    int32_t size;  // code size
+    int32_t resets; // table full clear codes emitted (coverage)
+    int16_t child[4096][16]; // code of string code + index or 0
+} gif_test_t;
+
+static int32_t gif_test_random(gif_test_t* t, int32_t n) { // [0..n)
+    return (int32_t)(num.random32(&t->seed) % (uint32_t)n);
+}
+
+static void gif_test_byte(gif_test_t* t, int32_t b) {
+    fatal_if(t->bytes >= t->capacity);
+    t->data[t->bytes++] = (uint8_t)b;
+}
+
+static void gif_test_u16(gif_test_t* t, int32_t v) {
+    gif_test_byte(t, v & 0xFF);
+    gif_test_byte(t, (v >> 8) & 0xFF);
+}
+
+static void gif_test_palette(gif_test_t* t, uint32_t* palette, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        const int32_t r = gif_test_random(t, 256);
+        const int32_t g = gif_test_random(t, 256);
+        const int32_t b = gif_test_random(t, 256);
+        gif_test_byte(t, r);
+        gif_test_byte(t, g);
+        gif_test_byte(t, b);
+        palette[i] = 0xFF000000u | (uint32_t)(r << 16 | g << 8 | b);
+    }
+}
+
+static void gif_test_emit(gif_test_t* t, int32_t code) {
+    t->bits |= (uint32_t)code << t->count;
+    t->count += t->size;
+    while (t->count >= 8) {
+        t->lzw[t->lzw_bytes++] = (uint8_t)t->bits;
+        t->bits >>= 8;
+        t->count -= 8;
+    }
+}
+
+// gif_test_lzw() writes image data: minimum code size and sub-blocks
+
+static void gif_test_lzw(gif_test_t* t, const uint8_t* ix, int32_t n,
+        int32_t min_size) {
+    const int32_t clear = 1 << min_size;
+    t->lzw_bytes = 0;
+    t->bits = 0;
+    t->count = 0;
+    t->size = min_size + 1;
+    memset(t->child, 0, sizeof(t->child));
+    int32_t next = clear + 2;
+    gif_test_emit(t, clear);
+    int32_t w = -1; // code of the current string
+    for (int32_t i = 0; i < n; i++) {
+        const int32_t k = ix[i];
+        if (w < 0) {
+            w = k;
+        } else if (t->child[w][k] != 0) {
+            w = t->child[w][k];
+        } else {
+            gif_test_emit(t, w);
+            if (next < 4096) {
+                t->child[w][k] = (int16_t)next++;
+                if (next > (1 << t->size) && t->size < 12) { t->size++; }
+            } else {
+                gif_test_emit(t, clear);
+                memset(t->child, 0, sizeof(t->child));
+                next = clear + 2;
+                t->size = min_size + 1;
+                t->resets++;
+            }
+            w = k;
+        }
+    }
+    if (w >= 0) { gif_test_emit(t, w); }
+    gif_test_emit(t, clear + 1);
+    if (t->count > 0) { t->lzw[t->lzw_bytes++] = (uint8_t)t->bits; }
+    gif_test_byte(t, min_size);
+    for (int64_t i = 0; i < t->lzw_bytes; i += 255) {
+        const int32_t chunk = (int32_t)min(255, t->lzw_bytes - i);
+        gif_test_byte(t, chunk);
+        for (int32_t j = 0; j < chunk; j++) { gif_test_byte(t, t->lzw[i + j]); }
+    }
+    gif_test_byte(t, 0);
+}
+
+typedef struct gif_test_file_s {
+    int32_t w;
+    int32_t h;
+    int32_t frames;
+    uint32_t* expected; // [frames][h][w] composed
+    int32_t delay[8];   // milliseconds
+    int64_t end[8];     // offset after each frame data
+} gif_test_file_t;
+
+// gif_test_generate() random GIF into t->data and its expected frames
+
+static void gif_test_generate(gif_test_t* t, gif_test_file_t* f, bool big) {
+    const int32_t w = big ? 100 + gif_test_random(t, 101) : 5 + gif_test_random(t, 56);
+    const int32_t h = big ? 100 + gif_test_random(t, 101) : 5 + gif_test_random(t, 56);
+    f->w = w;
+    f->h = h;
+    f->frames = 1 + gif_test_random(t, countof(f->delay));
+    const int64_t pixels = (int64_t)w * h;
+    f->expected = (uint32_t*)malloc(f->frames * pixels * sizeof(uint32_t));
+    uint32_t* canvas = (uint32_t*)calloc(pixels * 2, sizeof(uint32_t));
+    uint8_t* ix = (uint8_t*)malloc(pixels);
+    uint8_t* stream = (uint8_t*)malloc(pixels);
+    fatal_if(f->expected == null || canvas == null || ix == null || stream == null);
+    uint32_t* saved = canvas + pixels;
+    t->bytes = 0;
+    static const char* signature = "GIF89a";
+    for (int32_t i = 0; i < 6; i++) { gif_test_byte(t, signature[i]); }
+    gif_test_u16(t, w);
+    gif_test_u16(t, h);
+    gif_test_byte(t, 0x80 | 3); // 16 colors global color table
+    gif_test_byte(t, 0);
+    gif_test_byte(t, 0);
+    uint32_t global[16];
+    gif_test_palette(t, global, countof(global));
+    static const uint8_t loop[] = { // NETSCAPE2.0 loop forever
+        0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.',
+        '0', 0x03, 0x01, 0x00, 0x00, 0x00
+    };
+    for (int32_t i = 0; i < countof(loop); i++) { gif_test_byte(t, loop[i]); }
+    int32_t previous = 0; // disposal of the previous frame
+    ui_rect_t rect = {0}; // of the previous frame
+    for (int32_t fn = 0; fn < f->frames; fn++) {
+        const int32_t fw = 1 + gif_test_random(t, w);
+        const int32_t fh = 1 + gif_test_random(t, h);
+        const int32_t fx = gif_test_random(t, w - fw + 1);
+        const int32_t fy = gif_test_random(t, h - fh + 1);
+        const int32_t dispose = gif_test_random(t, 4);
+        const bool interlaced = gif_test_random(t, 10) < 4;
+        const bool local = gif_test_random(t, 10) < 3;
+        const int32_t colors = local ? 8 : 16;
+        const int32_t transparent = gif_test_random(t, 2) == 0 ?
+            -1 : gif_test_random(t, colors);
+        f->delay[fn] = gif_test_random(t, 21) * 10;
+        gif_test_byte(t, 0x21); // graphic control extension
+        gif_test_byte(t, 0xF9);
+        gif_test_byte(t, 4);
+        gif_test_byte(t, (dispose << 2) | (transparent >= 0));
+        gif_test_u16(t, f->delay[fn] / 10);
+        gif_test_byte(t, max(transparent, 0));
+        gif_test_byte(t, 0);
+        gif_test_byte(t, 0x2C); // image descriptor
+        gif_test_u16(t, fx);
+        gif_test_u16(t, fy);
+        gif_test_u16(t, fw);
+        gif_test_u16(t, fh);
+        gif_test_byte(t, (local ? 0x80 | 2 : 0) | (interlaced ? 0x40 : 0));
+        uint32_t palette[16];
+        if (local) {
+            gif_test_palette(t, palette, colors);
+        } else {
+            memcpy(palette, global, sizeof(palette));
+        }
+        for (int32_t i = 0; i < fw * fh; i++) { // runs of index 0
+            ix[i] = gif_test_random(t, 10) < 7 ?
+                (uint8_t)gif_test_random(t, colors) : 0;
+        }
+        int32_t n = 0;
+        if (interlaced) {
+            static const int32_t start[4] = { 0, 4, 2, 1 };
+            static const int32_t step[4]  = { 8, 8, 4, 2 };
+            for (int32_t pass = 0; pass < 4; pass++) {
+                for (int32_t y = start[pass]; y < fh; y += step[pass]) {
+                    memcpy(stream + n, ix + y * fw, fw);
+                    n += fw;
+                }
+            }
+        } else {
+            memcpy(stream, ix, fw * fh);
+            n = fw * fh;
+        }
+        gif_test_lzw(t, stream, n, local ? 3 : 4);
+        f->end[fn] = t->bytes;
+        // reference compositor:
+        if (previous == 2) {
+            for (int32_t y = rect.y; y < rect.y + rect.h; y++) {
+                for (int32_t x = rect.x; x < rect.x + rect.w; x++) {
+                    canvas[y * w + x] = 0;
+                }
+            }
+        } else if (previous == 3) {
+            memcpy(canvas, saved, pixels * sizeof(uint32_t));
+        }
+        if (dispose == 3) { memcpy(saved, canvas, pixels * sizeof(uint32_t)); }
+        for (int32_t y = 0; y < fh; y++) {
+            for (int32_t x = 0; x < fw; x++) {
+                const int32_t i = ix[y * fw + x];
+                if (i != transparent) {
+                    canvas[(fy + y) * w + fx + x] = palette[i];
+                }
+            }
+        }
+        previous = dispose;
+        rect = (ui_rect_t){ fx, fy, fw, fh };
+        memcpy(f->expected + fn * pixels, canvas, pixels * sizeof(uint32_t));
+    }
+    gif_test_byte(t, 0x3B); // trailer
+    free(stream);
+    free(ix);
+    free(canvas);
+}
+
+// gif_test_decode() compares first `frames` decoded frames with expected,
+// `complete` < f->frames for truncated data
+
+static void gif_test_decode(gif_test_t* t, gif_test_file_t* f,
+        int64_t bytes, int32_t complete) {
+    gif_t g = {0};
+    const errno_t r = gif.open(&g, t->data, bytes);
+    if (r != 0) {
+        fatal_if(complete > 0, "gif.open() failed: %d", r);
+    } else {
+        fatal_if(g.w != f->w || g.h != f->h || g.frames < complete,
+            "%dx%d frames: %d expected %dx%d frames: %d", g.w, g.h,
+            g.frames, f->w, f->h, complete);
+        const int64_t pixels = (int64_t)f->w * f->h;
+        const bool whole = complete == f->frames;
+        const int32_t n = whole ? f->frames * gif_test_loops : g.frames * 2;
+        for (int32_t i = 0; i < n; i++) {
+            const gif_frame_t* fr = gif.next(&g);
+            const int32_t k = i % g.frames;
+            fatal_if(fr->index != k, "index: %d expected: %d", fr->index, k);
+            if (whole || i < complete) {
+                fatal_if(fr->delay != f->delay[k] ||
+                    memcmp(fr->pixels, f->expected + k * pixels,
+                        pixels * sizeof(uint32_t)) != 0,
+                    "frame %d of %dx%d differs from reference", k,
+                    f->w, f->h);
+            }
+        }
+        gif.close(&g);
+    }
+}
+
+void gif_test(void) {
+    gif_test_t* t = (gif_test_t*)calloc(1, sizeof(gif_test_t));
+    fatal_if_null(t);
+    t->capacity = 4 * 1024 * 1024;
+    t->data = (uint8_t*)malloc(t->capacity);
+    t->lzw = (uint8_t*)malloc(t->capacity);
+    fatal_if(t->data == null || t->lzw == null);
+    t->seed = 1;
+    for (int32_t i = 0; i < gif_test_files; i++) {
+        gif_test_file_t f = {0};
+        gif_test_generate(t, &f, i % 10 == 9);
+        gif_test_decode(t, &f, t->bytes, f.frames);
+        // truncated anywhere after the header and global color table:
+        const int64_t header = 13 + 16 * 3;
+        const int64_t cut = header + gif_test_random(t,
+            (int32_t)(t->bytes - header));
+        int32_t complete = 0;
+        while (complete < f.frames && f.end[complete] <= cut) { complete++; }
+        gif_test_decode(t, &f, cut, complete);
+        free(f.expected);
+    }
+    fatal_if(t->resets == 0, "LZW table resets were not tested");
+    traceln("%d random GIFs decoded as reference (%d LZW table resets)",
+        gif_test_files, t->resets);
+    free(t->lzw);
+    free(t->data);
+    free(t);
+}
+
+end_c
@@ -0,0 +1,119 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2024 see LICENSE for details */
+#include "quick.h"
+
+begin_c
+
+// polyfill_test() fills random polygons (self intersecting, partially
+// outside of the clip) with both rules and compares every pixel with
+// the winding number of its center computed directly from the vertices
+// in exact integer arithmetic: pixels with centers exactly on an edge
+// are inside for left edges only and rows on horizontal edges for top
+// edges only (Win32 Polygon() convention). Each span must be reported
+// exactly once. Moved polygons must reuse their edges, polygons with
+// the same x coordinates and different y coordinates must not.
+
+enum { polyfill_test_w = 300, polyfill_test_h = 200,
+       polyfill_test_polygons = 300, polyfill_test_vertices = 16 };
+
+typedef struct polyfill_test_s {
+    uint8_t pixels[polyfill_test_h][polyfill_test_w]; // span coverage
+    ui_rect_t clip;
+} polyfill_test_t;
+
+static void polyfill_test_span(void* that, int32_t x, int32_t y,
+        int32_t w, int32_t h) {
+    polyfill_test_t* t = (polyfill_test_t*)that;
+    fatal_if(w <= 0 || h <= 0 || x < t->clip.x || y < t->clip.y ||
+        x + w > t->clip.x + t->clip.w || y + h > t->clip.y + t->clip.h,
+        "span %d,%d %dx%d outside of clip", x, y, w, h);
+    for (int32_t j = y; j < y + h; j++) {
+        for (int32_t i = x; i < x + w; i++) { t->pixels[j][i]++; }
+    }
+}
+
+// polyfill_test_inside() crossings of the ray from pixel center
+// (x + 0.5, y + 0.5) to the left. Edge at exactly the center counts.
+
+static bool polyfill_test_inside(const ui_point_t* p, int32_t n,
+        int32_t x, int32_t y, int32_t rule) {
+    const int64_t cx = 2 * (int64_t)x + 1; // doubled center
+    const int64_t cy = 2 * (int64_t)y + 1;
+    int32_t crossings = 0;
+    int32_t winding = 0;
+    for (int32_t i = 0; i < n; i++) {
+        const ui_point_t* a = &p[i];
+        const ui_point_t* b = &p[(i + 1) % n];
+        if ((2 * a->y < cy) != (2 * b->y < cy)) {
+            // edge x at cy: 2 * a.x + (cy - 2 * a.y) * dx / dy <= cx
+            const int64_t dx = b->x - a->x;
+            const int64_t dy = b->y - a->y;
+            const int64_t d = (2 * (int64_t)a->x - cx) * dy +
+                              (cy - 2 * (int64_t)a->y) * dx;
+            if (dy > 0 ? d <= 0 : d >= 0) {
+                crossings++;
+                winding += dy > 0 ? 1 : -1;
+            }
+        }
+    }
+    return rule == polyfill_even_odd ? (crossings & 1) != 0 : winding != 0;
+}
+
+static void polyfill_test_compare(polyfill_test_t* t, const ui_point_t* p,
+        int32_t n, int32_t rule) {
+    for (int32_t y = 0; y < polyfill_test_h; y++) {
+        for (int32_t x = 0; x < polyfill_test_w; x++) {
+            const bool clipped = x >= t->clip.x && y >= t->clip.y &&
+                x < t->clip.x + t->clip.w && y < t->clip.y + t->clip.h;
+            const int32_t expected = clipped &&
+                polyfill_test_inside(p, n, x, y, rule);
+            fatal_if(t->pixels[y][x] != expected,
+                "pixel %d,%d: %d expected %d %s", x, y, t->pixels[y][x],
+                expected, rule == polyfill_even_odd ? "even-odd" : "non-zero");
+        }
+    }
+}
+
+void polyfill_test(void) {
+    polyfill_test_t* t = (polyfill_test_t*)calloc(1, sizeof(polyfill_test_t));
+    fatal_if_null(t);
+    polyfill_t p = {0};
+    uint32_t seed = 1;
+    ui_point_t points[polyfill_test_vertices];
+    ui_point_t moved[polyfill_test_vertices];
+    for (int32_t k = 0; k < polyfill_test_polygons; k++) {
+        const int32_t n = 3 + (int32_t)(num.random32(&seed) %
+            (polyfill_test_vertices - 2));
+        for (int32_t i = 0; i < n; i++) {
+            points[i] = (ui_point_t){
+                (int32_t)(num.random32(&seed) % (polyfill_test_w + 60)) - 30,
+                (int32_t)(num.random32(&seed) % (polyfill_test_h + 60)) - 30
+            };
+        }
+        const int32_t cx = (int32_t)(num.random32(&seed) % 50);
+        const int32_t cy = (int32_t)(num.random32(&seed) % 50);
+        t->clip = (ui_rect_t){ cx, cy,
+            polyfill_test_w - cx - (int32_t)(num.random32(&seed) % 50),
+            polyfill_test_h - cy - (int32_t)(num.random32(&seed) % 50) };
+        // moved polygon must reuse the edges, changed y must not:
+        for (int32_t i = 0; i < n; i++) {
+            moved[i] = (ui_point_t){ points[i].x + 7, points[i].y - 3 };
+        }
+        (void)polyfill.edges(&p, moved, n);
+        fatal_if(!polyfill.edges(&p, points, n), "moved polygon not reused");
+        moved[n - 1].y = points[n - 1].y + 1;
+        for (int32_t i = 0; i < n - 1; i++) { moved[i] = points[i]; }
+        fatal_if(polyfill.edges(&p, moved, n), "changed polygon reused");
+        (void)polyfill.edges(&p, points, n);
+        for (int32_t rule = polyfill_even_odd; rule <= polyfill_non_zero;
+                rule++) {
+            memset(t->pixels, 0, sizeof(t->pixels));
+            polyfill.fill(&p, rule, &t->clip, t, polyfill_test_span);
+            polyfill_test_compare(t, points, n, rule);
+        }
+    }
+    polyfill.dispose(&p);
+    free(t);
+    traceln("%d random polygons filled as reference", polyfill_test_polygons);
+}
+
+end_c
@@ -25,7 +25,7 @@ typedef struct {
 
 static volatile time_stats_t ts[2];
 
-static ui_point_t points[N]; // graph polyline coordinates
+static ui_point_t points[N + 2]; // graph polyline and area coordinates
 
 static void stats(volatile time_stats_t* t) {
     int n = min(N - 1, t->samples);
@@ -66,6 +66,14 @@ static void graph(ui_view_t* view, volatile time_stats_t* t, ui_color_t c, int y
             points[j].y = y + (int32_t)(v * h8);
             j++;
         }
+        // area between the graph and the axis closed along the axis:
+        points[j + 0] = (ui_point_t){ points[j - 1].x, y };
+        points[j + 1] = (ui_point_t){ points[0].x, y };
+        ui_brush_t b = gdi.set_brush(gdi.brush_color);
+        ui_color_t bc = gdi.set_brush_color(colors.dkgray4);
+        gdi.polygon(points, j + 2, polyfill_non_zero);
+        gdi.set_brush_color(bc);
+        gdi.set_brush(b);
         gdi.poly(points, n - 1);
 
         gdi.x = view->em.x;
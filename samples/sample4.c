@@ -10,6 +10,7 @@ static image_t image[2];
 static char filename[260]; // c:\Users\user\Pictures\mandrill-4.2.03.png
 
 static void init(void);
+static void fini(void);
 
 static int  console(void) {
     fatal_if(true, "%s only SUBSYSTEM:WINDOWS", args.basename());
@@ -19,44 +20,51 @@ static int  console(void) {
 app_t app = {
     .class_name = "sample4",
     .init = init,
+    .fini = fini,
     .main = console, // optional
     .wmin = 6.0f, // 6x4 inches
     .hmin = 4.0f
 };
 
-static void* load_image(const uint8_t* data, int64_t bytes, int32_t* w, int32_t* h,
-    int32_t* bpp, int32_t preferred_bytes_per_pixel);
+// Images are decoded asynchronously (see loader.h): window opens at once,
+// low resolution previews are shown first and replaced by full images.
+// Decoded images are cached on disk (see imagecache.h): next runs map
+// them from the cache without decoding.
 
-static void load_images(void) {
-    int r = 0;
-    void* data = null;
-    int64_t bytes = 0;
-    for (int i = 0; i < countof(image); i++) {
-        if (i == 0) {
-            r = mem.map_ro(filename, &data, &bytes);
-        } else {
-            r = mem.map_resource("sample_png", &data, &bytes);
-        }
-        fatal_if_not_zero(r);
-        int w = 0;
-        int h = 0;
-        int bpp = 0; // bytes (!) per pixel
-        void* pixels = load_image(data, bytes, &w, &h, &bpp, 0);
-        fatal_if_null(pixels);
-        gdi.image_init(&image[i], w, h, bpp, pixels);
-        free(pixels);
-        // do not unmap resources:
-        if (i == 0) { mem.unmap(data, bytes); }
+static loader_request_t request[countof(image)];
+static thread_t downloader;
+
+static uint8_t* decode(const uint8_t* data, int64_t bytes, int32_t* w,
+        int32_t* h) {
+    int bpp = 0; // bytes (!) per pixel of the file
+    return stbi_load_from_memory(data, (int)bytes, w, h, &bpp, 4);
+}
+
+static void loaded(loader_request_t* r, image_t* i, bool final) {
+    image_t* im = (image_t*)r->that;
+    if (i != null) { // preview or final image
+        if (im->bitmap != null) { imagecache.dispose(im); }
+        *im = *i;
     }
+    // do not unmap resources, mapped file is not needed after decoding:
+    if (final && r == &request[0]) { mem.unmap((void*)r->data, r->bytes); }
+    app.redraw();
+}
+
+static void load_image(int32_t i, void* data, int64_t bytes) {
+    request[i] = (loader_request_t){ .data = data, .bytes = bytes,
+        .decode = decode, .preview = 64, .cache = true, .loaded = loaded, .that = &image[i] };
+    loader.load(&request[i]);
 }
 
 static void paint(ui_view_t* view) {
     gdi.set_brush(gdi.brush_color);
     gdi.set_brush_color(colors.black);
     gdi.fill(0, 0, view->w, view->h);
+    // previews are stretched to the size of final images:
     if (image[1].w > 0 && image[1].h > 0) {
-        int w = min(view->w, image[1].w);
-        int h = min(view->h, image[1].h);
+        int w = min(view->w, request[1].size.x);
+        int h = min(view->h, request[1].size.y);
         int x = (view->w - w) / 2;
         int y = (view->h - h) / 2;
         gdi.set_clip(0, 0, view->w, view->h);
@@ -64,13 +72,14 @@ static void paint(ui_view_t* view) {
         gdi.set_clip(0, 0, 0, 0);
     }
     if (image[0].w > 0 && image[0].h > 0) {
-        int x = (view->w - image[0].w) / 2;
-        int y = (view->h - image[0].h) / 2;
-        gdi.draw_image(x, y, image[0].w, image[0].h, &image[0]);
+        const ui_point_t size = request[0].size;
+        int x = (view->w - size.x) / 2;
+        int y = (view->h - size.y) / 2;
+        gdi.draw_image(x, y, size.x, size.y, &image[0]);
     }
 }
 
-static void download(void) {
+static void download(void* unused(p)) { // and load
     static const char* url =
         "https://upload.wikimedia.org/wikipedia/commons/c/c1/"
         "Wikipedia-sipi-image-db-mandrill-4.2.03.png";
@@ -83,6 +92,14 @@ static void download(void) {
             traceln("download %s failed %d %s", filename, r, str.error(r));
         }
     }
+    void* data = null;
+    int64_t bytes = 0;
+    int r = mem.map_ro(filename, &data, &bytes);
+    if (r == 0) {
+        load_image(0, data, bytes);
+    } else {
+        traceln("map %s failed %d %s", filename, r, str.error(r));
+    }
 }
 
 static void init(void) {
@@ -90,13 +107,15 @@ static void init(void) {
     app.view->paint = paint;
     strprintf(filename, "%s\\mandrill-4.2.03.png",
         app.known_folder(ui.folder.pictures));
-    download();
-    load_images();
+    void* data = null;
+    int64_t bytes = 0;
+    fatal_if_not_zero(mem.map_resource("sample_png", &data, &bytes));
+    load_image(1, data, bytes);
+    downloader = threads.start(download, null);
 }
 
-static void* load_image(const uint8_t* data, int64_t bytes, int32_t* w, int32_t* h,
-    int32_t* bpp, int32_t preferred_bytes_per_pixel) {
-    void* pixels = stbi_load_from_memory((uint8_t const*)data, (int)bytes, w, h,
-        bpp, preferred_bytes_per_pixel);
-    return pixels;
+static void fini(void) {
+    threads.join(downloader, -1);
+    // undelivered requests: results are no longer needed
+    for (int i = 0; i < countof(request); i++) { loader.cancel(&request[i]); }
 }
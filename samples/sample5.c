@@ -371,6 +371,7 @@ static void edit_enter(ui_edit_t* e) {
 void ui_edit_init_with_lorem_ipsum(ui_edit_t* e);
 void ui_edit_fuzz(ui_edit_t* e);
 void ui_edit_next_fuzz(ui_edit_t* e);
+void ui_edit_test_recover(void);
 
 static void init(void) {
     app.title = title;
@@ -379,6 +380,7 @@ static void init(void) {
     app.view->paint       = paint;
     app.view->key_pressed = key_pressed;
     scaled_fonts();
+    ui_edit_test_recover();
     static ui_view_t* children[] = { &left, &right, &bottom, null };
     app.view->children = children;
     text.view.font = &app.fonts.mono;
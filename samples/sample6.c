@@ -10,19 +10,13 @@ begin_c
 
 const char* title = "Sample6: I am groot";
 
-static struct {
-    int32_t bpp; // bytes per pixel
-    int32_t w;
-    int32_t h;
-    int32_t frames;
-    int32_t* delays; // delays[frames];
-    uint8_t* pixels;
-} gif; // animated
+static gif_t groot; // animated, frames are decoded on demand (see gif.h)
 
 enum { max_speed = 3 };
 
 static struct {
-    int32_t  index; // animation index 0..gif.frames - 1
+    volatile int32_t index; // incremented by animation thread
+    volatile int32_t delay; // of the frame on screen in milliseconds
     event_t  quit;
     thread_t thread;
     uint32_t seed; // for num.random32()
@@ -43,6 +37,8 @@ static struct {
 #define speaker "\xF0\x9F\x94\x88"
 
 static image_t  background;
+static image_t  frame; // current animation frame
+static int32_t  frame_index = -1; // animation.index converted into frame
 
 static void init(void);
 static void fini(void);
@@ -69,14 +65,10 @@ app_t app = {
 static void* load_image(const uint8_t* data, int64_t bytes, int32_t* w, int32_t* h,
     int32_t* bpp, int32_t preferred_bytes_per_pixel);
 
-static void* load_animated_gif(const uint8_t* data, int64_t bytes,
-    int32_t** delays, int32_t* w, int32_t* h, int32_t* frames, int32_t* bpp,
-    int32_t preferred_bytes_per_pixel);
-
 static void paint(ui_view_t* view) {
     if (animation.x < 0 && animation.y < 0) {
-        animation.x = (view->w - gif.w) / 2;
-        animation.y = (view->h - gif.h) / 2;
+        animation.x = (view->w - groot.w) / 2;
+        animation.y = (view->h - groot.h) / 2;
     }
     gdi.set_brush(gdi.brush_color);
     gdi.set_brush_color(colors.black);
@@ -88,14 +80,23 @@ static void paint(ui_view_t* view) {
     gdi.set_clip(0, 0, view->w, view->h);
     gdi.draw_image(x, y, w, h, &background);
     gdi.set_clip(0, 0, 0, 0);
-    if (gif.pixels != null) {
-        uint8_t* p = gif.pixels + gif.w * gif.h * gif.bpp * animation.index;
-        image_t frame = { 0 };
-        gdi.image_init(&frame, gif.w, gif.h, gif.bpp, p);
-        x = animation.x - gif.w / 2;
-        y = animation.y - gif.h / 2;
-        gdi.alpha_blend(x, y, gif.w, gif.h, &frame, 1.0);
-        gdi.image_dispose(&frame);
+    if (groot.stream != null) {
+        const int32_t index = animation.index;
+        if (frame_index != index) { // frames are deltas: none is skipped
+            const gif_frame_t* f = gif.next(&groot);
+            // pixels are BGRA premultiplied: -4 does not swap RGB
+            const uint8_t* p = (const uint8_t*)f->pixels;
+            if (frame.bitmap == null) {
+                gdi.image_init(&frame, groot.w, groot.h, -4, p);
+            } else {
+                gdi.image_update(&frame, -4, p);
+            }
+            animation.delay = f->delay;
+            frame_index = index;
+        }
+        x = animation.x - groot.w / 2;
+        y = animation.y - groot.h / 2;
+        gdi.alpha_blend(x, y, groot.w, groot.h, &frame, 1.0);
     }
     ui_font_t f = gdi.set_font(app.fonts.H1);
     gdi.x = 0;
@@ -234,22 +235,22 @@ static void load_gif(void) {
     int64_t bytes = 0;
     int r = mem.map_resource("groot_gif", &data, &bytes);
     fatal_if_not_zero(r);
-    gif.pixels = load_animated_gif(data, bytes, &gif.delays,
-        &gif.w, &gif.h, &gif.frames, &gif.bpp, 4);
-    fatal_if(gif.pixels == null || gif.bpp != 4 || gif.frames < 1);
+    gif_t g = {0};
+    fatal_if_not_zero(gif.open(&g, data, bytes));
+    groot = g; // publish after it is opened
     // resources cannot be unmapped do not call mem.unmap()
 }
 
 static void animate(void) {
     for (;;) {
         app.redraw();
-        double delay_in_seconds = gif.delays[animation.index] * 0.001;
+        double delay_in_seconds = animation.delay * 0.001;
         if (events.wait_or_timeout(animation.quit, delay_in_seconds) == 0) {
             break;
         }
         if (animation.x >= 0 && animation.y >= 0) {
 //          traceln("%d %d speed: %d %d", animation.x, animation.y, animation.speed_x, animation.speed_y);
-            animation.index = (animation.index + 1) % gif.frames;
+            animation.index++;
             while (animation.speed_x == 0) {
                 animation.speed_x = num.random32(&animation.seed) % (max_speed * 2 + 1) - max_speed;
             }
@@ -258,18 +259,18 @@ static void animate(void) {
             }
             animation.x += animation.speed_x;
             animation.y += animation.speed_y;
-            if (animation.x - gif.w / 2 < 0) {
-                animation.x = gif.w / 2;
+            if (animation.x - groot.w / 2 < 0) {
+                animation.x = groot.w / 2;
                 animation.speed_x = -animation.speed_x;
-            } else if (animation.x + gif.w / 2 >= app.crc.w) {
-                animation.x = app.crc.w - gif.w / 2 - 1;
+            } else if (animation.x + groot.w / 2 >= app.crc.w) {
+                animation.x = app.crc.w - groot.w / 2 - 1;
                 animation.speed_x = -animation.speed_x;
             }
-            if (animation.y - gif.h / 2 < 0) {
-                animation.y = gif.h / 2;
+            if (animation.y - groot.h / 2 < 0) {
+                animation.y = groot.h / 2;
                 animation.speed_y = -animation.speed_y;
-            } else if (animation.y + gif.h / 2 >= app.crc.h) {
-                animation.y = app.crc.h - gif.h / 2 - 1;
+            } else if (animation.y + groot.h / 2 >= app.crc.h) {
+                animation.y = app.crc.h - groot.h / 2 - 1;
                 animation.speed_y = -animation.speed_y;
             }
             int inc = num.random32(&animation.seed) % 2 == 0 ? -1 : +1;
@@ -304,6 +305,7 @@ static void init(void) {
     animation.seed = (uint32_t)clock.nanoseconds();
     animation.x = -1;
     animation.y = -1;
+    animation.delay = 100; // until the first frame is on screen
     animation.quit = events.create();
     animation.thread = threads.start(startup, null);
     void* data = null;
@@ -320,10 +322,10 @@ static void init(void) {
 
 static void fini(void) {
     gdi.image_dispose(&background);
-    free(gif.pixels);
-    free(gif.delays);
+    if (frame.bitmap != null) { gdi.image_dispose(&frame); }
     events.set(animation.quit);
     threads.join(animation.thread, -1);
+    gif.close(&groot);
     events.dispose(animation.quit);
     midi_stop();
     midi_close();
@@ -337,14 +339,5 @@ static void* load_image(const uint8_t* data, int64_t bytes, int32_t* w, int32_t*
     return pixels;
 }
 
-static void* load_animated_gif(const uint8_t* data, int64_t bytes,
-    int32_t** delays, int32_t* w, int32_t* h, int32_t* frames, int32_t* bpp,
-    int32_t preferred_bytes_per_pixel) {
-    stbi_uc* pixels = stbi_load_gif_from_memory(data, (int32_t)bytes,
-        delays, w, h, frames,
-        bpp, preferred_bytes_per_pixel);
-    return pixels;
-}
-
 end_c
 
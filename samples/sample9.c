@@ -213,7 +213,7 @@ static void right_paint(ui_view_t* view) {
     gdi.println("%s %dx%d", app.nls("Monitor"), app.mrc.w, app.mrc.h);
     gdi.println("%s %d %d", app.nls("Left Top"), app.wrc.x, app.wrc.y);
     gdi.println("%s %d %d", app.nls("Mouse"), app.mouse.x, app.mouse.y);
-    gdi.println("%d x paint()", app.paint_count);
+    gdi.println("%d x paint() %d culled", app.paint_count, app.paint_culled);
     gdi.println("%.1fms (max %.1f avg %.1f)", app.paint_time * 1000.0,
         app.paint_max * 1000.0, app.paint_avg * 1000.0);
     text_after(&zoomer.view, "%.16f", zoom);
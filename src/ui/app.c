@@ -158,6 +158,7 @@ static void app_dispose_fonts(void) {
 static void app_init_fonts(int32_t dpi) {
     app_update_ncm(dpi);
     if (app.fonts.regular != null) { app_dispose_fonts(); }
+    gdi.measure_invalidate(); // new fonts may reuse old handles
     LOGFONTW lf = app_ncm.lfMessageFont;
     // lf.lfQuality is CLEARTYPE_QUALITY which looks bad on 4K monitors
     // Windows UI uses PROOF_QUALITY which is aliased w/o ClearType rainbows
@@ -517,6 +518,7 @@ static void app_window_opening(void) {
     app_wm_timer(app_timer_1s_id);
     fatal_if(ReleaseDC(window(), canvas()) == 0);
     app.canvas = null;
+    loader_drain(); // images decoded before window was created
     app.layout(); // request layout
     if (app.last_visibility == ui.visibility.maximize) {
         ShowWindow(window(), ui.visibility.maximize);
@@ -592,11 +594,47 @@ static void app_character(ui_view_t* view, const char* utf8) {
     }
 }
 
+// app_paint() skips views that are entirely outside of the damaged area
+// and clip (see gdi.visible()). Children of a skipped view are skipped
+// with it only when they are inside of its bounds (layout usually keeps
+// them there) otherwise (scrolled content, negative offsets) they are
+// tested separately. Views of zero size (e.g. not measured groups) are
+// not culled but their children are.
+
+static int32_t app_paint_count(ui_view_t* view) { // not hidden views
+    int32_t n = 0;
+    if (!view->hidden) {
+        n++;
+        ui_view_t** c = view->children;
+        while (c != null && *c != null) { n += app_paint_count(*c); c++; }
+    }
+    return n;
+}
+
+static bool app_paint_inside(const ui_view_t* v, const ui_view_t* parent) {
+    return v->w > 0 && v->h > 0 &&
+        parent->x <= v->x && (int64_t)v->x + v->w <= (int64_t)parent->x + parent->w &&
+        parent->y <= v->y && (int64_t)v->y + v->h <= (int64_t)parent->y + parent->h;
+}
+
 static void app_paint(ui_view_t* view) {
     if (!view->hidden && app.crc.w > 0 && app.crc.h > 0) {
-        if (view->paint != null) { view->paint(view); }
+        const bool culled = view->w > 0 && view->h > 0 &&
+           !gdi.visible(view->x, view->y, view->w, view->h);
+        if (culled) {
+            app.paint_culled++;
+        } else if (view->paint != null) {
+            view->paint(view);
+        }
         ui_view_t** c = view->children;
-        while (c != null && *c != null) { app_paint(*c); c++; }
+        while (c != null && *c != null) {
+            if (culled && app_paint_inside(*c, view)) {
+                app.paint_culled += app_paint_count(*c);
+            } else {
+                app_paint(*c);
+            }
+            c++;
+        }
     }
 }
 
@@ -982,6 +1020,7 @@ static void app_paint_on_canvas(HDC hdc) {
     ui_point_t pt = {0};
     fatal_if_false(SetBrushOrgEx(canvas(), 0, 0, (POINT*)&pt));
     ui_brush_t br = gdi.set_brush(gdi.brush_hollow);
+    app.paint_culled = 0;
     app_paint(app.view);
     if (app.toasting.view != null) { app_toast_paint(); }
     fatal_if_false(SetBrushOrgEx(canvas(), pt.x, pt.y, null));
@@ -1171,6 +1210,7 @@ static LRESULT CALLBACK window_proc(HWND window, UINT msg, WPARAM wp, LPARAM lp)
             app_tap_press((int32_t)msg, wp, lp);
             return 0;
     }
+    if ((int32_t)msg == ui.message.loaded) { loader_drain(); return 0; }
     if ((int32_t)msg == ui.message.animate) {
         app_animate_step((app_animate_function_t)lp, (int)wp, -1);
         return 0;
@@ -1465,7 +1505,7 @@ static int32_t app_message_loop(void) {
 
 static void app_dispose(void) {
     app_dispose_fonts();
-    if (gdi.clip != null) { DeleteRgn(gdi.clip); }
+    __gdi_fini__();
     fatal_if_false(CloseHandle(app_event_quit));
     fatal_if_false(CloseHandle(app_event_invalidate));
 }
@@ -2125,10 +2165,22 @@ static void __app_windows_init__(void) {
     app_init_fonts(app.dpi.window); // for default monitor
 }
 
+// app_install_gdi() overrides gdi.* for display lists and software
+// rasterizer once before any thread draws: the gdi table is never
+// written while other threads call through it. Rasterizer is installed
+// last and forwards to display only outside raster.begin()/end() thus
+// drawing into images is not recorded.
+
+static void app_install_gdi(void) {
+    __gdi_init__();
+    display_install();
+    raster_install();
+}
+
 static int app_win_main(void) {
     not_null(app.init);
     __app_windows_init__();
-    __gdi_init__();
+    app_install_gdi();
     app.last_visibility = ui.visibility.defau1t;
     app_init();
     int r = 0;
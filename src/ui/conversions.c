@@ -0,0 +1,315 @@
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define conversions_sse2
+#elif defined(_M_ARM64) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define conversions_neon
+#endif
+
+static inline uint8_t conversions_mul255(uint32_t c, uint32_t alpha) {
+    const uint32_t t = c * alpha + 128; // round(c * alpha / 255)
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+static void conversions_swap_rb3(uint8_t* d, const uint8_t* s, int32_t n) {
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        // 5 pixels in 16 bytes; byte 15 (red of the 6th pixel) is kept
+        // so the conversion can be done in place:
+        const __m128i m0 = _mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0,
+                                         0, -1, 0, 0, -1, 0, 0, 0);
+        const __m128i m1 = _mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1,
+                                         0, 0, -1, 0, 0, -1, 0, -1);
+        const __m128i m2 = _mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0,
+                                         -1, 0, 0, -1, 0, 0, -1, 0);
+        for (; i + 6 <= n; i += 5) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(s + i * 3));
+            const __m128i r = _mm_or_si128(_mm_and_si128(v, m1),
+                _mm_or_si128(_mm_and_si128(_mm_srli_si128(v, 2), m0),
+                             _mm_and_si128(_mm_slli_si128(v, 2), m2)));
+            _mm_storeu_si128((__m128i*)(d + i * 3), r);
+        }
+    #elif defined(conversions_neon)
+        for (; i + 16 <= n; i += 16) {
+            uint8x16x3_t v = vld3q_u8(s + i * 3);
+            const uint8x16_t t = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = t;
+            vst3q_u8(d + i * 3, v);
+        }
+    #endif
+    for (; i < n; i++) {
+        const uint8_t r = s[i * 3 + 0];
+        d[i * 3 + 1] = s[i * 3 + 1];
+        d[i * 3 + 0] = s[i * 3 + 2];
+        d[i * 3 + 2] = r;
+    }
+}
+
+static void conversions_rgbx_to_bgra(uint8_t* d, const uint8_t* s, int32_t n) {
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        const __m128i rb = _mm_set1_epi32(0x00FF00FF);
+        const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+        const __m128i a  = _mm_set1_epi32((int32_t)0xFF000000);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(s + i * 4));
+            const __m128i x = _mm_and_si128(v, rb);
+            const __m128i r = _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(x, 16), _mm_srli_epi32(x, 16)),
+                _mm_or_si128(_mm_and_si128(v, ga), a));
+            _mm_storeu_si128((__m128i*)(d + i * 4), r);
+        }
+    #elif defined(conversions_neon)
+        for (; i + 16 <= n; i += 16) {
+            uint8x16x4_t v = vld4q_u8(s + i * 4);
+            const uint8x16_t t = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = t;
+            v.val[3] = vdupq_n_u8(0xFF);
+            vst4q_u8(d + i * 4, v);
+        }
+    #endif
+    for (; i < n; i++) {
+        const uint8_t r = s[i * 4 + 0];
+        d[i * 4 + 1] = s[i * 4 + 1];
+        d[i * 4 + 0] = s[i * 4 + 2];
+        d[i * 4 + 2] = r;
+        d[i * 4 + 3] = 0xFF;
+    }
+}
+
+static void conversions_bgrx_to_bgra(uint8_t* d, const uint8_t* s, int32_t n) {
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        const __m128i a = _mm_set1_epi32((int32_t)0xFF000000);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(s + i * 4));
+            _mm_storeu_si128((__m128i*)(d + i * 4), _mm_or_si128(v, a));
+        }
+    #elif defined(conversions_neon)
+        const uint32x4_t a = vdupq_n_u32(0xFF000000);
+        for (; i + 4 <= n; i += 4) {
+            const uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(s + i * 4));
+            vst1q_u8(d + i * 4, vreinterpretq_u8_u32(vorrq_u32(v, a)));
+        }
+    #endif
+    for (; i < n; i++) {
+        d[i * 4 + 0] = s[i * 4 + 0];
+        d[i * 4 + 1] = s[i * 4 + 1];
+        d[i * 4 + 2] = s[i * 4 + 2];
+        d[i * 4 + 3] = 0xFF;
+    }
+}
+
+#if defined(conversions_sse2)
+
+// premultiplies two pixels unpacked to 16 bit lanes:
+
+static inline __m128i conversions_premultiply_epi16(__m128i v, bool swap) {
+    const __m128i rgb = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i one = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    // alpha is multiplied by 255 / 255 to keep it intact:
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+    a = _mm_or_si128(_mm_and_si128(a, rgb), one);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, a), _mm_set1_epi16(128));
+    t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    if (swap) { // 0xC6: lanes 2, 1, 0, 3
+        t = _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, 0xC6), 0xC6);
+    }
+    return t;
+}
+
+static inline void conversions_premultiply_sse2(uint8_t* d, const uint8_t* s,
+        int32_t n, int32_t* i, bool swap) {
+    const __m128i z = _mm_setzero_si128();
+    for (; *i + 4 <= n; *i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(s + *i * 4));
+        const __m128i lo = conversions_premultiply_epi16(
+            _mm_unpacklo_epi8(v, z), swap);
+        const __m128i hi = conversions_premultiply_epi16(
+            _mm_unpackhi_epi8(v, z), swap);
+        _mm_storeu_si128((__m128i*)(d + *i * 4), _mm_packus_epi16(lo, hi));
+    }
+}
+
+#elif defined(conversions_neon)
+
+static inline uint8x16_t conversions_mul255_neon(uint8x16_t c, uint8x16_t a) {
+    const uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    return vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)),
+                       vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+}
+
+static inline void conversions_premultiply_neon(uint8_t* d, const uint8_t* s,
+        int32_t n, int32_t* i, bool swap) {
+    for (; *i + 16 <= n; *i += 16) {
+        uint8x16x4_t v = vld4q_u8(s + *i * 4);
+        const uint8x16_t c0 = conversions_mul255_neon(v.val[0], v.val[3]);
+        const uint8x16_t c2 = conversions_mul255_neon(v.val[2], v.val[3]);
+        v.val[1] = conversions_mul255_neon(v.val[1], v.val[3]);
+        v.val[0] = swap ? c2 : c0;
+        v.val[2] = swap ? c0 : c2;
+        vst4q_u8(d + *i * 4, v);
+    }
+}
+
+#endif
+
+static void conversions_rgba_premultiply(uint8_t* d, const uint8_t* s,
+        int32_t n) {
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        conversions_premultiply_sse2(d, s, n, &i, true);
+    #elif defined(conversions_neon)
+        conversions_premultiply_neon(d, s, n, &i, true);
+    #endif
+    for (; i < n; i++) {
+        const uint32_t alpha = s[i * 4 + 3];
+        const uint8_t r = s[i * 4 + 0];
+        d[i * 4 + 1] = conversions_mul255(s[i * 4 + 1], alpha);
+        d[i * 4 + 0] = conversions_mul255(s[i * 4 + 2], alpha);
+        d[i * 4 + 2] = conversions_mul255(r, alpha);
+        d[i * 4 + 3] = (uint8_t)alpha;
+    }
+}
+
+static void conversions_bgra_premultiply(uint8_t* d, const uint8_t* s,
+        int32_t n) {
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        conversions_premultiply_sse2(d, s, n, &i, false);
+    #elif defined(conversions_neon)
+        conversions_premultiply_neon(d, s, n, &i, false);
+    #endif
+    for (; i < n; i++) {
+        const uint32_t alpha = s[i * 4 + 3];
+        d[i * 4 + 0] = conversions_mul255(s[i * 4 + 0], alpha);
+        d[i * 4 + 1] = conversions_mul255(s[i * 4 + 1], alpha);
+        d[i * 4 + 2] = conversions_mul255(s[i * 4 + 2], alpha);
+        d[i * 4 + 3] = (uint8_t)alpha;
+    }
+}
+
+static void conversions_grey_to_bgra(uint8_t* d, const uint8_t* s, int32_t n) {
+    assert(d + n * 4 <= s || s + n <= d, "cannot be done in place");
+    int32_t i = 0;
+    #if defined(conversions_sse2)
+        const __m128i ff = _mm_set1_epi8(-1);
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+            const __m128i gg0 = _mm_unpacklo_epi8(v, v);
+            const __m128i ga0 = _mm_unpacklo_epi8(v, ff);
+            const __m128i gg1 = _mm_unpackhi_epi8(v, v);
+            const __m128i ga1 = _mm_unpackhi_epi8(v, ff);
+            __m128i* p = (__m128i*)(d + i * 4);
+            _mm_storeu_si128(p + 0, _mm_unpacklo_epi16(gg0, ga0));
+            _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(gg0, ga0));
+            _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(gg1, ga1));
+            _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(gg1, ga1));
+        }
+    #elif defined(conversions_neon)
+        for (; i + 16 <= n; i += 16) {
+            const uint8x16_t g = vld1q_u8(s + i);
+            const uint8x16x4_t v = {{ g, g, g, vdupq_n_u8(0xFF) }};
+            vst4q_u8(d + i * 4, v);
+        }
+    #endif
+    for (; i < n; i++) {
+        d[i * 4 + 0] = s[i];
+        d[i * 4 + 1] = s[i];
+        d[i * 4 + 2] = s[i];
+        d[i * 4 + 3] = 0xFF;
+    }
+}
+
+enum { conversions_parallel_min = 512 * 1024 }; // pixels
+
+typedef struct conversions_bands_s {
+    void* that;
+    void (*band)(void* that, int32_t y0, int32_t y1);
+    int32_t h;
+    int32_t rows; // in each band
+    volatile LONG next; // band index
+} conversions_bands_t;
+
+static void CALLBACK conversions_worker(PTP_CALLBACK_INSTANCE unused(instance),
+        void* context, PTP_WORK unused(work)) {
+    conversions_bands_t* b = (conversions_bands_t*)context;
+    for (;;) {
+        const int64_t y0 = (int64_t)(InterlockedIncrement(&b->next) - 1) * b->rows;
+        if (y0 >= b->h) { break; }
+        b->band(b->that, (int32_t)y0, (int32_t)min(y0 + b->rows, b->h));
+    }
+}
+
+static int32_t conversions_cpus(void) {
+    static int32_t cpus;
+    if (cpus == 0) {
+        SYSTEM_INFO si = {0};
+        GetSystemInfo(&si);
+        cpus = max(1, (int32_t)si.dwNumberOfProcessors);
+    }
+    return cpus;
+}
+
+// Bands are disjoint sets of rows and band() results do not depend on
+// which thread or in what order they are processed, thus the output
+// is identical to single threaded processing.
+
+static void conversions_bands(void* that,
+        void (*band)(void* that, int32_t y0, int32_t y1),
+        int32_t w, int32_t h) {
+    const int32_t cpus = conversions_cpus();
+    if ((int64_t)w * h < conversions_parallel_min || cpus == 1 || h < 2) {
+        band(that, 0, h);
+    } else {
+        const int32_t n = min(h, cpus * 4); // more bands than cpus to balance
+        conversions_bands_t b = { that, band, h, (h + n - 1) / n, 0 };
+        PTP_WORK work = CreateThreadpoolWork(conversions_worker, &b, null);
+        fatal_if_null(work);
+        for (int32_t i = 0; i < cpus - 1; i++) { SubmitThreadpoolWork(work); }
+        conversions_worker(null, &b, work); // calling thread helps
+        WaitForThreadpoolWorkCallbacks(work, false);
+        CloseThreadpoolWork(work);
+    }
+}
+
+typedef struct conversions_rows_s {
+    conversions_span_t span;
+    uint8_t* d;
+    const uint8_t* s;
+    int32_t d_stride;
+    int32_t s_stride;
+    int32_t w;
+} conversions_rows_t;
+
+static void conversions_rows_band(void* that, int32_t y0, int32_t y1) {
+    conversions_rows_t* r = (conversions_rows_t*)that;
+    uint8_t* d = r->d + (int64_t)y0 * r->d_stride;
+    const uint8_t* s = r->s + (int64_t)y0 * r->s_stride;
+    for (int32_t y = y0; y < y1; y++) {
+        r->span(d, s, r->w);
+        d += r->d_stride;
+        s += r->s_stride;
+    }
+}
+
+static void conversions_rows(conversions_span_t span,
+        uint8_t* d, int32_t d_stride, const uint8_t* s, int32_t s_stride,
+        int32_t w, int32_t h) {
+    conversions_rows_t r = { span, d, s, d_stride, s_stride, w };
+    conversions_bands(&r, conversions_rows_band, w, h);
+}
+
+conversions_if conversions = {
+    .swap_rb3         = conversions_swap_rb3,
+    .rgbx_to_bgra     = conversions_rgbx_to_bgra,
+    .bgrx_to_bgra     = conversions_bgrx_to_bgra,
+    .rgba_premultiply = conversions_rgba_premultiply,
+    .bgra_premultiply = conversions_bgra_premultiply,
+    .grey_to_bgra     = conversions_grey_to_bgra,
+    .rows             = conversions_rows,
+    .bands            = conversions_bands
+};
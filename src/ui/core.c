@@ -7,6 +7,7 @@
 #define UI_WM_TAP      (WM_APP + 0x7FFC)
 #define UI_WM_DTAP     (WM_APP + 0x7FFB) // double tap (aka click)
 #define UI_WM_PRESS    (WM_APP + 0x7FFA)
+#define UI_WM_LOADED   (WM_APP + 0x7FF9)
 
 extern ui_if ui = {
     .visibility = { // window visibility see ShowWindow link below
@@ -39,7 +40,8 @@ extern ui_if ui = {
         .closing               = UI_WM_CLOSING,
         .tap                   = UI_WM_TAP,
         .dtap                  = UI_WM_DTAP,
-        .press                 = UI_WM_PRESS
+        .press                 = UI_WM_PRESS,
+        .loaded                = UI_WM_LOADED
     },
     .mouse = {
         .button = {
@@ -0,0 +1,591 @@
+// Display list is a flat array of commands. Each command is a header
+// followed by `count` int64_t arguments and optional zero terminated
+// text padded to 8 bytes. Handles and pointers are stored as integers.
+
+typedef struct display_command_s {
+    int32_t op;
+    int32_t count; // int64_t arguments
+    int64_t bytes; // whole command including text, multiple of 8
+} display_command_t;
+
+enum {
+    display_op_text_color = 1,
+    display_op_brush_color,
+    display_op_brush,
+    display_op_colored_pen,
+    display_op_pen,
+    display_op_font,
+    display_op_clip,
+    display_op_push,
+    display_op_pop,
+    display_op_pixel,
+    display_op_move_to,
+    display_op_line,
+    display_op_rect,
+    display_op_fill,
+    display_op_poly,
+    display_op_rounded,
+    display_op_gradient,
+    display_op_greyscale,
+    display_op_bgr,
+    display_op_bgrx,
+    display_op_alpha_blend,
+    display_op_image,
+    display_op_text,
+    display_op_textln,
+    display_op_multiline,
+    display_op_intersect_clip,
+    display_op_polygon,
+    display_op_count
+};
+
+// gdi_t captured by display_install() used to execute calls:
+
+static gdi_t display_gdi;
+
+static thread_local display_list_t* display_dl;
+
+static uint8_t* display_reserve(display_list_t* list, int64_t bytes) {
+    if (list->bytes + bytes > list->capacity) {
+        int64_t capacity = max(list->capacity * 2, 4 * 1024);
+        while (capacity < list->bytes + bytes) { capacity *= 2; }
+        list->data = (uint8_t*)realloc(list->data, (size_t)capacity);
+        fatal_if_null(list->data);
+        list->capacity = capacity;
+    }
+    return list->data + list->bytes;
+}
+
+// display_append() text may be null, bytes < 0 for zero terminated text
+
+static void display_append(int32_t op, const int64_t* args, int32_t count,
+        const char* text, int32_t bytes) {
+    display_list_t* list = display_dl;
+    if (list != null) {
+        const int64_t k = text == null ? 0 :
+            (bytes < 0 ? (int64_t)strlen(text) : bytes);
+        const int64_t n = text == null ? 0 : k + 1;
+        const int64_t padded = (n + 7) & ~7LL;
+        const int64_t args_bytes = (int64_t)count * sizeof(int64_t);
+        const int64_t size = sizeof(display_command_t) + args_bytes + padded;
+        uint8_t* p = display_reserve(list, size);
+        display_command_t* c = (display_command_t*)p;
+        c->op = op;
+        c->count = count;
+        c->bytes = size;
+        p += sizeof(display_command_t);
+        if (count > 0) { memcpy(p, args, (size_t)args_bytes); }
+        p += args_bytes;
+        if (padded > 0) {
+            memcpy(p, text, (size_t)k);
+            memset(p + k, 0, (size_t)(padded - k)); // equal() uses memcmp()
+        }
+        list->bytes += size;
+        list->commands++;
+    }
+}
+
+static ui_color_t display_set_text_color(ui_color_t c) {
+    const int64_t a[] = { (int64_t)c };
+    display_append(display_op_text_color, a, countof(a), null, 0);
+    return display_gdi.set_text_color(c);
+}
+
+static ui_color_t display_set_brush_color(ui_color_t c) {
+    const int64_t a[] = { (int64_t)c };
+    display_append(display_op_brush_color, a, countof(a), null, 0);
+    return display_gdi.set_brush_color(c);
+}
+
+static ui_brush_t display_set_brush(ui_brush_t b) {
+    const int64_t a[] = { (int64_t)(uintptr_t)b };
+    display_append(display_op_brush, a, countof(a), null, 0);
+    return display_gdi.set_brush(b);
+}
+
+static ui_pen_t display_set_colored_pen(ui_color_t c) {
+    const int64_t a[] = { (int64_t)c };
+    display_append(display_op_colored_pen, a, countof(a), null, 0);
+    return display_gdi.set_colored_pen(c);
+}
+
+static ui_pen_t display_set_pen(ui_pen_t p) {
+    const int64_t a[] = { (int64_t)(uintptr_t)p };
+    display_append(display_op_pen, a, countof(a), null, 0);
+    return display_gdi.set_pen(p);
+}
+
+static ui_font_t display_set_font(ui_font_t f) {
+    const int64_t a[] = { (int64_t)(uintptr_t)f };
+    display_append(display_op_font, a, countof(a), null, 0);
+    return display_gdi.set_font(f);
+}
+
+static void display_set_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
+    const int64_t a[] = { x, y, w, h };
+    display_append(display_op_clip, a, countof(a), null, 0);
+    display_gdi.set_clip(x, y, w, h);
+}
+
+static void display_intersect_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
+    const int64_t a[] = { x, y, w, h };
+    display_append(display_op_intersect_clip, a, countof(a), null, 0);
+    display_gdi.intersect_clip(x, y, w, h);
+}
+
+static void display_push(int32_t x, int32_t y) {
+    const int64_t a[] = { x, y };
+    display_append(display_op_push, a, countof(a), null, 0);
+    display_gdi.push(x, y);
+}
+
+static void display_pop(void) {
+    display_append(display_op_pop, null, 0, null, 0);
+    display_gdi.pop();
+}
+
+static void display_pixel(int32_t x, int32_t y, ui_color_t c) {
+    const int64_t a[] = { x, y, (int64_t)c };
+    display_append(display_op_pixel, a, countof(a), null, 0);
+    display_gdi.pixel(x, y, c);
+}
+
+static ui_point_t display_move_to(int32_t x, int32_t y) {
+    const int64_t a[] = { x, y };
+    display_append(display_op_move_to, a, countof(a), null, 0);
+    return display_gdi.move_to(x, y);
+}
+
+static void display_line(int32_t x, int32_t y) {
+    const int64_t a[] = { x, y };
+    display_append(display_op_line, a, countof(a), null, 0);
+    display_gdi.line(x, y);
+}
+
+static void display_rect(int32_t x, int32_t y, int32_t w, int32_t h) {
+    const int64_t a[] = { x, y, w, h };
+    display_append(display_op_rect, a, countof(a), null, 0);
+    display_gdi.rect(x, y, w, h);
+}
+
+static void display_fill(int32_t x, int32_t y, int32_t w, int32_t h) {
+    const int64_t a[] = { x, y, w, h };
+    display_append(display_op_fill, a, countof(a), null, 0);
+    display_gdi.fill(x, y, w, h);
+}
+
+static void display_poly(ui_point_t* points, int32_t count) {
+    static_assertion(sizeof(ui_point_t) == sizeof(int64_t));
+    display_append(display_op_poly, (const int64_t*)points, count, null, 0);
+    display_gdi.poly(points, count);
+}
+
+static void display_polygon(ui_point_t* points, int32_t count, int32_t rule) {
+    display_list_t* list = display_dl;
+    if (list != null) { // rule followed by points
+        int64_t* a = (int64_t*)malloc((count + 1) * sizeof(int64_t));
+        fatal_if_null(a);
+        a[0] = rule;
+        memcpy(a + 1, points, count * sizeof(ui_point_t));
+        display_append(display_op_polygon, a, count + 1, null, 0);
+        free(a);
+    }
+    display_gdi.polygon(points, count, rule);
+}
+
+static void display_rounded(int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t rx, int32_t ry) {
+    const int64_t a[] = { x, y, w, h, rx, ry };
+    display_append(display_op_rounded, a, countof(a), null, 0);
+    display_gdi.rounded(x, y, w, h, rx, ry);
+}
+
+static void display_gradient(int32_t x, int32_t y, int32_t w, int32_t h,
+        ui_color_t rgba_from, ui_color_t rgba_to, bool vertical) {
+    const int64_t a[] = { x, y, w, h, (int64_t)rgba_from, (int64_t)rgba_to,
+                          vertical };
+    display_append(display_op_gradient, a, countof(a), null, 0);
+    display_gdi.gradient(x, y, w, h, rgba_from, rgba_to, vertical);
+}
+
+static void display_pixels(int32_t op, int32_t sx, int32_t sy, int32_t sw,
+        int32_t sh, int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    const int64_t a[] = { sx, sy, sw, sh, x, y, w, h, iw, ih, stride,
+                          (int64_t)(uintptr_t)pixels };
+    display_append(op, a, countof(a), null, 0);
+}
+
+static void display_draw_greyscale(int32_t sx, int32_t sy, int32_t sw,
+        int32_t sh, int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    display_pixels(display_op_greyscale, sx, sy, sw, sh, x, y, w, h,
+        iw, ih, stride, pixels);
+    display_gdi.draw_greyscale(sx, sy, sw, sh, x, y, w, h,
+        iw, ih, stride, pixels);
+}
+
+static void display_draw_bgr(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+        int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    display_pixels(display_op_bgr, sx, sy, sw, sh, x, y, w, h,
+        iw, ih, stride, pixels);
+    display_gdi.draw_bgr(sx, sy, sw, sh, x, y, w, h, iw, ih, stride, pixels);
+}
+
+static void display_draw_bgrx(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+        int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    display_pixels(display_op_bgrx, sx, sy, sw, sh, x, y, w, h,
+        iw, ih, stride, pixels);
+    display_gdi.draw_bgrx(sx, sy, sw, sh, x, y, w, h, iw, ih, stride, pixels);
+}
+
+static void display_alpha_blend(int32_t x, int32_t y, int32_t w, int32_t h,
+        image_t* image, double alpha) {
+    int64_t a[] = { x, y, w, h, (int64_t)(uintptr_t)image, 0 };
+    memcpy(&a[5], &alpha, sizeof(alpha));
+    display_append(display_op_alpha_blend, a, countof(a), null, 0);
+    display_gdi.alpha_blend(x, y, w, h, image, alpha);
+}
+
+static void display_draw_image(int32_t x, int32_t y, int32_t w, int32_t h,
+        image_t* image) {
+    const int64_t a[] = { x, y, w, h, (int64_t)(uintptr_t)image };
+    display_append(display_op_image, a, countof(a), null, 0);
+    display_gdi.draw_image(x, y, w, h, image);
+}
+
+// display_vformat() returns malloc()-ed formatted text. Each attempt
+// formats from a fresh copy of vl: a va_list consumed by the previous
+// attempt must not be used again.
+
+static char* display_vformat(const char* format, va_list vl, int32_t* k) {
+    int32_t n = 1024;
+    char* text = null;
+    for (;;) {
+        text = (char*)realloc(text, n);
+        fatal_if_null(text);
+        va_list va;
+        va_copy(va, vl);
+        str.vformat(text, n - 1, format, va);
+        va_end(va);
+        *k = (int32_t)strlen(text);
+        if (0 <= *k && *k < n - 1) { break; }
+        n = n * 2;
+    }
+    return text;
+}
+
+// text is recorded formatted with the pen position it was drawn at
+// (see gdi.position())
+
+static void display_vtext_append(int32_t op, const char* format, va_list vl) {
+    int32_t k = 0;
+    char* text = display_vformat(format, vl, &k);
+    const gdi_xy_t xy = gdi.position();
+    const int64_t a[] = { *xy.x, *xy.y };
+    display_append(op, a, countof(a), text, k);
+    free(text);
+}
+
+static void display_vtext(const char* format, va_list vl) {
+    if (display_dl != null) {
+        va_list va;
+        va_copy(va, vl);
+        display_vtext_append(display_op_text, format, va);
+        va_end(va);
+    }
+    display_gdi.vtext(format, vl);
+}
+
+static void display_vtextln(const char* format, va_list vl) {
+    if (display_dl != null) {
+        va_list va;
+        va_copy(va, vl);
+        display_vtext_append(display_op_textln, format, va);
+        va_end(va);
+    }
+    display_gdi.vtextln(format, vl);
+}
+
+static void display_text_n(const char* s, int32_t n) {
+    const gdi_xy_t xy = gdi.position();
+    const int64_t a[] = { *xy.x, *xy.y };
+    display_append(display_op_text, a, countof(a), s, n);
+    display_gdi.text_n(s, n);
+}
+
+static void display_textln_n(const char* s, int32_t n) {
+    const gdi_xy_t xy = gdi.position();
+    const int64_t a[] = { *xy.x, *xy.y };
+    display_append(display_op_textln, a, countof(a), s, n);
+    display_gdi.textln_n(s, n);
+}
+
+static ui_point_t display_multiline(int32_t w, const char* f, ...) {
+    va_list vl;
+    va_start(vl, f);
+    int32_t k = 0;
+    char* text = display_vformat(f, vl, &k);
+    va_end(vl);
+    const gdi_xy_t xy = gdi.position();
+    const int64_t a[] = { *xy.x, *xy.y, w };
+    display_append(display_op_multiline, a, countof(a), text, k);
+    const ui_point_t size = display_gdi.multiline(w, "%s", text);
+    free(text);
+    return size;
+}
+
+// display_install() is called once by app on the main thread before any
+// other thread exists (see app_install_gdi()).
+
+static void display_install(void) {
+    fatal_if(display_gdi.fill != null, "installed twice");
+    display_gdi = gdi;
+    gdi.set_text_color  = display_set_text_color;
+    gdi.set_brush_color = display_set_brush_color;
+    gdi.set_brush       = display_set_brush;
+    gdi.set_colored_pen = display_set_colored_pen;
+    gdi.set_pen         = display_set_pen;
+    gdi.set_font        = display_set_font;
+    gdi.set_clip        = display_set_clip;
+    gdi.intersect_clip  = display_intersect_clip;
+    gdi.push            = display_push;
+    gdi.pop             = display_pop;
+    gdi.pixel           = display_pixel;
+    gdi.move_to         = display_move_to;
+    gdi.line            = display_line;
+    gdi.rect            = display_rect;
+    gdi.fill            = display_fill;
+    gdi.poly            = display_poly;
+    gdi.polygon         = display_polygon;
+    gdi.rounded         = display_rounded;
+    gdi.gradient        = display_gradient;
+    gdi.draw_greyscale  = display_draw_greyscale;
+    gdi.draw_bgr        = display_draw_bgr;
+    gdi.draw_bgrx       = display_draw_bgrx;
+    gdi.alpha_blend     = display_alpha_blend;
+    gdi.draw_image      = display_draw_image;
+    gdi.vtext           = display_vtext;
+    gdi.vtextln         = display_vtextln;
+    gdi.text_n          = display_text_n;
+    gdi.textln_n        = display_textln_n;
+    gdi.multiline       = display_multiline;
+}
+
+static void display_record(display_list_t* list) {
+    fatal_if(display_gdi.fill == null, "display_install() not called");
+    list->bytes = 0;
+    list->commands = 0;
+    list->previous = display_dl;
+    display_dl = list;
+}
+
+static void display_stop(void) {
+    display_list_t* list = display_dl;
+    not_null(list);
+    display_dl = list->previous;
+    list->previous = null;
+}
+
+// display_replay_poly() polyline (rule == 0) or polygon translated
+
+static void display_replay_poly(const int64_t* a, int32_t count,
+        int32_t dx, int32_t dy, int32_t rule) {
+    ui_point_t* points = (ui_point_t*)malloc(count * sizeof(ui_point_t));
+    fatal_if_null(points);
+    memcpy(points, a, count * sizeof(ui_point_t));
+    for (int32_t i = 0; i < count; i++) {
+        points[i].x += dx;
+        points[i].y += dy;
+    }
+    if (rule == 0) {
+        gdi.poly(points, count);
+    } else {
+        gdi.polygon(points, count, rule);
+    }
+    free(points);
+}
+
+static void display_replay(const display_list_t* list, int32_t dx, int32_t dy) {
+    const uint8_t* p = list->data;
+    const uint8_t* end = p + list->bytes;
+    const gdi_xy_t xy = gdi.position();
+    while (p < end) {
+        const display_command_t* c = (const display_command_t*)p;
+        const int64_t* a = (const int64_t*)(c + 1);
+        const char* s = (const char*)(a + c->count);
+        // translated x, y for commands that start with them:
+        const int32_t x = c->count >= 2 ? (int32_t)a[0] + dx : 0;
+        const int32_t y = c->count >= 2 ? (int32_t)a[1] + dy : 0;
+        switch (c->op) {
+            case display_op_text_color : gdi.set_text_color((ui_color_t)a[0]); break;
+            case display_op_brush_color: gdi.set_brush_color((ui_color_t)a[0]); break;
+            case display_op_brush      : gdi.set_brush((ui_brush_t)(uintptr_t)a[0]); break;
+            case display_op_colored_pen: gdi.set_colored_pen((ui_color_t)a[0]); break;
+            case display_op_pen        : gdi.set_pen((ui_pen_t)(uintptr_t)a[0]); break;
+            case display_op_font       : gdi.set_font((ui_font_t)(uintptr_t)a[0]); break;
+            case display_op_clip:
+                if (a[2] <= 0 || a[3] <= 0) {
+                    gdi.set_clip(0, 0, 0, 0);
+                } else {
+                    gdi.set_clip(x, y, (int32_t)a[2], (int32_t)a[3]);
+                }
+                break;
+            case display_op_intersect_clip:
+                gdi.intersect_clip(x, y, (int32_t)a[2], (int32_t)a[3]);
+                break;
+            case display_op_push   : gdi.push(x, y); break;
+            case display_op_pop    : gdi.pop(); break;
+            case display_op_pixel  : gdi.pixel(x, y, (ui_color_t)a[2]); break;
+            case display_op_move_to: gdi.move_to(x, y); break;
+            case display_op_line   : gdi.line(x, y); break;
+            case display_op_rect   : gdi.rect(x, y, (int32_t)a[2], (int32_t)a[3]); break;
+            case display_op_fill   : gdi.fill(x, y, (int32_t)a[2], (int32_t)a[3]); break;
+            case display_op_poly:
+                if (dx == 0 && dy == 0) {
+                    gdi.poly((ui_point_t*)a, c->count);
+                } else {
+                    display_replay_poly(a, c->count, dx, dy, 0);
+                }
+                break;
+            case display_op_polygon:
+                if (dx == 0 && dy == 0) {
+                    gdi.polygon((ui_point_t*)(a + 1), c->count - 1, (int32_t)a[0]);
+                } else {
+                    display_replay_poly(a + 1, c->count - 1, dx, dy, (int32_t)a[0]);
+                }
+                break;
+            case display_op_rounded:
+                gdi.rounded(x, y, (int32_t)a[2], (int32_t)a[3],
+                    (int32_t)a[4], (int32_t)a[5]);
+                break;
+            case display_op_gradient:
+                gdi.gradient(x, y, (int32_t)a[2], (int32_t)a[3],
+                    (ui_color_t)a[4], (ui_color_t)a[5], a[6] != 0);
+                break;
+            case display_op_greyscale:
+            case display_op_bgr:
+            case display_op_bgrx: {
+                void (*draw)(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+                    int32_t x, int32_t y, int32_t w, int32_t h,
+                    int32_t iw, int32_t ih, int32_t stride,
+                    const uint8_t* pixels) =
+                    c->op == display_op_greyscale ? gdi.draw_greyscale :
+                    c->op == display_op_bgr ? gdi.draw_bgr : gdi.draw_bgrx;
+                draw(x, y, (int32_t)a[2], (int32_t)a[3], (int32_t)a[4],
+                    (int32_t)a[5], (int32_t)a[6], (int32_t)a[7], (int32_t)a[8],
+                    (int32_t)a[9], (int32_t)a[10], (const uint8_t*)(uintptr_t)a[11]);
+                break;
+            }
+            case display_op_alpha_blend: {
+                double alpha;
+                memcpy(&alpha, &a[5], sizeof(alpha));
+                gdi.alpha_blend(x, y, (int32_t)a[2], (int32_t)a[3],
+                    (image_t*)(uintptr_t)a[4], alpha);
+                break;
+            }
+            case display_op_image:
+                gdi.draw_image(x, y, (int32_t)a[2], (int32_t)a[3],
+                    (image_t*)(uintptr_t)a[4]);
+                break;
+            case display_op_text:
+                *xy.x = x; *xy.y = y; gdi.text_n(s, (int32_t)strlen(s));
+                break;
+            case display_op_textln:
+                *xy.x = x; *xy.y = y; gdi.textln_n(s, (int32_t)strlen(s));
+                break;
+            case display_op_multiline:
+                *xy.x = x; *xy.y = y; gdi.multiline((int32_t)a[2], "%s", s);
+                break;
+            default: fatal_if(true, "op: %d", c->op); break;
+        }
+        p += c->bytes;
+    }
+}
+
+static void display_paint(display_list_t* list, ui_view_t* view, uint64_t key) {
+    not_null(view->paint);
+    const bool same = list->data != null && list->key == key &&
+        list->w == view->w && list->h == view->h;
+    if (same) {
+        display_replay(list, view->x - list->x, view->y - list->y);
+    } else {
+        list->x = view->x;
+        list->y = view->y;
+        list->w = view->w;
+        list->h = view->h;
+        list->key = key;
+        display.record(list);
+        view->paint(view);
+        display.stop();
+    }
+}
+
+static bool display_equal(const display_list_t* a, const display_list_t* b) {
+    return a->bytes == b->bytes &&
+        (a->bytes == 0 || memcmp(a->data, b->data, (size_t)a->bytes) == 0);
+}
+
+// minimum number of int64_t arguments that replay() accesses for op:
+
+static const int32_t display_args[display_op_count] = {
+    [display_op_text_color]  = 1, [display_op_brush_color] = 1,
+    [display_op_brush]       = 1, [display_op_colored_pen] = 1,
+    [display_op_pen]         = 1, [display_op_font]        = 1,
+    [display_op_clip]        = 4, [display_op_push]        = 2,
+    [display_op_pop]         = 0, [display_op_pixel]       = 3,
+    [display_op_move_to]     = 2, [display_op_line]        = 2,
+    [display_op_rect]        = 4, [display_op_fill]        = 4,
+    [display_op_poly]        = 0, [display_op_rounded]     = 6,
+    [display_op_gradient]    = 7, [display_op_greyscale]   = 12,
+    [display_op_bgr]         = 12, [display_op_bgrx]       = 12,
+    [display_op_alpha_blend] = 6, [display_op_image]       = 5,
+    [display_op_text]        = 2, [display_op_textln]      = 2,
+    [display_op_multiline]   = 3, [display_op_intersect_clip] = 4,
+    [display_op_polygon]     = 4 // rule and 3 points
+};
+
+static errno_t display_load(display_list_t* list, const uint8_t* data,
+        int64_t bytes) {
+    int32_t commands = 0;
+    int64_t i = 0;
+    while (i < bytes) {
+        if (bytes - i < (int64_t)sizeof(display_command_t)) { return EINVAL; }
+        display_command_t c;
+        memcpy(&c, data + i, sizeof(c));
+        const int64_t args = (int64_t)c.count * sizeof(int64_t);
+        const int64_t text = c.bytes - sizeof(display_command_t) - args;
+        const bool has_text = c.op == display_op_text ||
+            c.op == display_op_textln || c.op == display_op_multiline;
+        const bool valid = c.op > 0 && c.op < display_op_count &&
+            c.count >= display_args[c.op] && text >= 0 &&
+            c.bytes % 8 == 0 && c.bytes <= bytes - i &&
+            (has_text ? text > 0 && data[i + c.bytes - 1] == 0 : text == 0);
+        if (!valid) { return EINVAL; }
+        i += c.bytes;
+        commands++;
+    }
+    list->bytes = 0;
+    memcpy(display_reserve(list, bytes), data, (size_t)bytes);
+    list->bytes = bytes;
+    list->commands = commands;
+    return 0;
+}
+
+static void display_dispose(display_list_t* list) {
+    assert(display_dl != list, "dispose while recording");
+    free(list->data);
+    memset(list, 0, sizeof(*list));
+}
+
+display_if display = {
+    .record  = display_record,
+    .stop    = display_stop,
+    .replay  = display_replay,
+    .paint   = display_paint,
+    .equal   = display_equal,
+    .load    = display_load,
+    .dispose = display_dispose
+};
@@ -1,11 +1,111 @@
-typedef struct gdi_xyc_s {
-    int32_t x;
-    int32_t y;
-    ui_color_t c;
-} gdi_xyc_t;
+// gdi_app is the render context of threads without gdi.begin() drawing
+// on app.canvas with gdi.x, gdi.y and gdi.counters.
 
-static int32_t gdi_top;
-static gdi_xyc_t gdi_stack[256];
+static gdi_context_t gdi_app;
+static thread_local gdi_context_t* gdi_rc; // current context or null
+
+static gdi_context_t* gdi_context(void) {
+    return gdi_rc != null ? gdi_rc : &gdi_app;
+}
+
+static HDC gdi_canvas(void) {
+    return gdi_rc != null ? (HDC)gdi_rc->canvas : canvas();
+}
+
+static gdi_xy_t gdi_xy(void) { // pen position of the calling thread
+    gdi_context_t* c = gdi_rc;
+    return c != null ? (gdi_xy_t){ &c->x, &c->y } :
+                       (gdi_xy_t){ &gdi.x, &gdi.y };
+}
+
+static gdi_counters_t* gdi_counters(void) {
+    return gdi_rc != null ? &gdi_rc->counters : &gdi.counters;
+}
+
+// known state of canvas valid between outermost push() and pop():
+
+static void gdi_state_reset(void) {
+    gdi_context_t* c = gdi_context();
+    RECT r = {0};
+    switch (GetClipBox(gdi_canvas(), &r)) {
+        case NULLREGION: c->bounds = (ui_rect_t){0}; break;
+        case ERROR: c->bounds = (ui_rect_t){0, 0, INT32_MAX, INT32_MAX}; break;
+        default: c->bounds = (ui_rect_t){r.left, r.top,
+            r.right - r.left, r.bottom - r.top};
+    }
+    c->state = (gdi_state_t){ .dc = (ui_canvas_t)gdi_canvas(),
+        .pen_color = -1, .brush_color = -1, .text_color = -1,
+        .visible = c->bounds };
+}
+
+static bool gdi_state_known(void) {
+    const gdi_context_t* c = gdi_context();
+    return c->top > 0 && c->state.dc == (ui_canvas_t)gdi_canvas();
+}
+
+// gdi_state_changed() returns true if state change cannot be skipped
+
+static bool gdi_state_changed(bool same) {
+    if (same && gdi_state_known()) {
+        gdi_counters()->state_elided++;
+        return false;
+    } else {
+        gdi_counters()->state_changes++;
+        return true;
+    }
+}
+
+// created pens and brushes cached by (color, width), brushes width is 0
+// shared by all render contexts:
+
+typedef struct gdi_object_s {
+    ui_color_t color;
+    int32_t width;
+    void* handle;
+} gdi_object_t;
+
+static gdi_object_t gdi_objects[64];
+static int32_t gdi_objects_count;
+static SRWLOCK gdi_objects_lock = SRWLOCK_INIT;
+
+// gdi_object() returns cached or newly created object, create(c, width)
+// is called with gdi_objects_lock held:
+
+static void* gdi_object(ui_color_t c, int32_t width,
+        void* (*create)(ui_color_t c, int32_t width)) {
+    void* handle = null;
+    AcquireSRWLockExclusive(&gdi_objects_lock);
+    for (int32_t i = 0; i < gdi_objects_count && handle == null; i++) {
+        if (gdi_objects[i].color == c && gdi_objects[i].width == width) {
+            handle = gdi_objects[i].handle;
+        }
+    }
+    if (handle != null) {
+        gdi_counters()->objects_reused++;
+    } else {
+        gdi_counters()->objects_created++;
+        handle = create(c, width);
+        not_null(handle);
+        if (gdi_objects_count < countof(gdi_objects)) {
+            gdi_objects[gdi_objects_count].color = c;
+            gdi_objects[gdi_objects_count].width = width;
+            gdi_objects[gdi_objects_count].handle = handle;
+            gdi_objects_count++;
+        }
+    }
+    ReleaseSRWLockExclusive(&gdi_objects_lock);
+    return handle;
+}
+
+static bool gdi_object_cached(void* handle) {
+    bool cached = false;
+    AcquireSRWLockShared(&gdi_objects_lock);
+    for (int32_t i = 0; i < gdi_objects_count && !cached; i++) {
+        cached = gdi_objects[i].handle == handle;
+    }
+    ReleaseSRWLockShared(&gdi_objects_lock);
+    return cached;
+}
 
 static void __gdi_init__(void) {
     gdi.brush_hollow = (ui_brush_t)GetStockBrush(HOLLOW_BRUSH);
@@ -14,102 +114,217 @@ static void __gdi_init__(void) {
 }
 
 static inline COLORREF gdi_color_ref(ui_color_t c) {
+    if (color_is_hdr(c)) { c = color_hdr_to_rgb(c); } // nearest 8 bit
     assert(color_is_8bit(c));
     return (COLORREF)(c & 0xFFFFFFFF);
 }
 
 static ui_color_t gdi_set_text_color(ui_color_t c) {
-    return SetTextColor(canvas(), gdi_color_ref(c));
+    gdi_state_t* st = &gdi_context()->state;
+    if (!gdi_state_changed(st->text_color == (int64_t)c)) { return c; }
+    st->text_color = (int64_t)c;
+    return SetTextColor(gdi_canvas(), gdi_color_ref(c));
 }
 
 static ui_pen_t gdi_set_pen(ui_pen_t p) {
     not_null(p);
-    return (ui_pen_t)SelectPen(canvas(), (HPEN)p);
+    gdi_state_t* st = &gdi_context()->state;
+    if (!gdi_state_changed(st->pen == p)) { return p; }
+    st->pen = p;
+    return (ui_pen_t)SelectPen(gdi_canvas(), (HPEN)p);
 }
 
 static ui_pen_t gdi_set_colored_pen(ui_color_t c) {
-    ui_pen_t p = (ui_pen_t)SelectPen(canvas(), GetStockPen(DC_PEN));
-    SetDCPenColor(canvas(), gdi_color_ref(c));
+    ui_pen_t p = gdi_set_pen((ui_pen_t)GetStockPen(DC_PEN));
+    gdi_state_t* st = &gdi_context()->state;
+    if (gdi_state_changed(st->pen_color == (int64_t)c)) {
+        st->pen_color = (int64_t)c;
+        SetDCPenColor(gdi_canvas(), gdi_color_ref(c));
+    }
     return p;
 }
 
+static void* gdi_object_pen(ui_color_t c, int32_t width) {
+    return CreatePen(PS_SOLID, width, gdi_color_ref(c));
+}
+
 static ui_pen_t gdi_create_pen(ui_color_t c, int32_t width) {
     assert(width >= 1);
-    ui_pen_t pen = (ui_pen_t)CreatePen(PS_SOLID, width, gdi_color_ref(c));
-    not_null(pen);
-    return pen;
+    return (ui_pen_t)gdi_object(c, width, gdi_object_pen);
 }
 
 static void gdi_delete_pen(ui_pen_t p) {
-    fatal_if_false(DeletePen(p));
+    if (!gdi_object_cached(p)) { fatal_if_false(DeletePen(p)); }
+}
+
+static void* gdi_object_brush(ui_color_t c, int32_t unused(width)) {
+    return CreateSolidBrush(gdi_color_ref(c));
 }
 
 static ui_brush_t gdi_create_brush(ui_color_t c) {
-    return (ui_brush_t)CreateSolidBrush(gdi_color_ref(c));
+    return (ui_brush_t)gdi_object(c, 0, gdi_object_brush);
 }
 
 static void gdi_delete_brush(ui_brush_t b) {
-    DeleteBrush((HBRUSH)b);
+    if (!gdi_object_cached(b)) { DeleteBrush((HBRUSH)b); }
 }
 
 static ui_brush_t gdi_set_brush(ui_brush_t b) {
     not_null(b);
-    return (ui_brush_t)SelectBrush(canvas(), b);
+    gdi_state_t* st = &gdi_context()->state;
+    if (!gdi_state_changed(st->brush == b)) { return b; }
+    st->brush = b;
+    return (ui_brush_t)SelectBrush(gdi_canvas(), b);
 }
 
 static ui_color_t gdi_set_brush_color(ui_color_t c) {
-    return SetDCBrushColor(canvas(), gdi_color_ref(c));
+    gdi_state_t* st = &gdi_context()->state;
+    if (!gdi_state_changed(st->brush_color == (int64_t)c)) { return c; }
+    st->brush_color = (int64_t)c;
+    return SetDCBrushColor(gdi_canvas(), gdi_color_ref(c));
+}
+
+// gdi_intersect() of two rectangles, {x, y, 0, 0} if they do not overlap
+
+static ui_rect_t gdi_intersect(const ui_rect_t* a, const ui_rect_t* b) {
+    const int32_t x0 = max(a->x, b->x);
+    const int32_t y0 = max(a->y, b->y);
+    const int32_t x1 = (int32_t)min((int64_t)a->x + a->w, (int64_t)b->x + b->w);
+    const int32_t y1 = (int32_t)min((int64_t)a->y + a->h, (int64_t)b->y + b->h);
+    return (ui_rect_t){ x0, y0, max(x1 - x0, 0), max(y1 - y0, 0) };
 }
 
 static void gdi_set_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
-    if (gdi.clip != null) { DeleteRgn(gdi.clip); gdi.clip = null; }
-    if (w > 0 && h > 0) {
-        gdi.clip = (ui_region_t)CreateRectRgn(x, y, x + w, y + h);
-        not_null(gdi.clip);
+    if (w <= 0 || h <= 0) { x = 0; y = 0; w = 0; h = 0; }
+    gdi_context_t* ctx = gdi_context();
+    gdi_state_t* st = &ctx->state;
+    const ui_rect_t* c = &st->clip;
+    const bool same = st->clip_known &&
+        c->x == x && c->y == y && c->w == w && c->h == h;
+    if (gdi_state_changed(same)) {
+        st->clip = (ui_rect_t){x, y, w, h};
+        st->clip_known = true;
+        st->visible = w > 0 ? gdi_intersect(&ctx->bounds, &st->clip) :
+                              ctx->bounds;
+        HDC dc = gdi_canvas();
+        fatal_if(SelectClipRgn(dc, null) == ERROR);
+        if (w > 0) {
+            fatal_if(IntersectClipRect(dc, x, y, x + w, y + h) == ERROR);
+        }
+    }
+}
+
+static void gdi_intersect_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
+    gdi_state_t* st = &gdi_context()->state;
+    const ui_rect_t r = { x, y, max(w, 0), max(h, 0) };
+    gdi_counters()->state_changes++;
+    fatal_if(IntersectClipRect(gdi_canvas(), r.x, r.y, r.x + r.w,
+        r.y + r.h) == ERROR);
+    st->visible = gdi_intersect(&st->visible, &r);
+    if (st->clip_known) {
+        st->clip = st->clip.w > 0 ? gdi_intersect(&st->clip, &r) : r;
+        // empty clip cannot be told apart from {0, 0, 0, 0} "no clipping"
+        st->clip_known = st->clip.w > 0 && st->clip.h > 0;
     }
-    fatal_if(SelectClipRgn(canvas(), (HRGN)gdi.clip) == ERROR);
+}
+
+static bool gdi_visible(int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (!gdi_state_known()) { return true; }
+    const ui_rect_t* v = &gdi_context()->state.visible;
+    return w > 0 && h > 0 &&
+        (int64_t)x + w > v->x && x < (int64_t)v->x + v->w &&
+        (int64_t)y + h > v->y && y < (int64_t)v->y + v->h;
 }
 
 static void gdi_push(int32_t x, int32_t y) {
-    assert(gdi_top < countof(gdi_stack));
-    fatal_if(gdi_top >= countof(gdi_stack));
-    gdi_stack[gdi_top].x = gdi.x;
-    gdi_stack[gdi_top].y = gdi.y;
-    fatal_if(SaveDC(canvas()) == 0);
-    gdi_top++;
-    gdi.x = x;
-    gdi.y = y;
+    gdi_context_t* c = gdi_context();
+    assert(c->top < countof(c->stack));
+    fatal_if(c->top >= countof(c->stack));
+    if (c->top == 0) { // start of the frame
+        gdi_state_reset();
+        memset(gdi_counters(), 0, sizeof(gdi_counters_t));
+    }
+    gdi_xy_t xy = gdi_xy();
+    c->state.x = *xy.x;
+    c->state.y = *xy.y;
+    c->stack[c->top] = c->state;
+    fatal_if(SaveDC(gdi_canvas()) == 0);
+    c->top++;
+    *xy.x = x;
+    *xy.y = y;
 }
 
 static void gdi_pop(void) {
-    assert(0 < gdi_top && gdi_top <= countof(gdi_stack));
-    fatal_if(gdi_top <= 0);
-    gdi_top--;
-    gdi.x = gdi_stack[gdi_top].x;
-    gdi.y = gdi_stack[gdi_top].y;
-    fatal_if_false(RestoreDC(canvas(), -1));
+    gdi_context_t* c = gdi_context();
+    assert(0 < c->top && c->top <= countof(c->stack));
+    fatal_if(c->top <= 0);
+    c->top--;
+    fatal_if_false(RestoreDC(gdi_canvas(), -1));
+    c->state = c->stack[c->top]; // RestoreDC() restored selected objects
+    gdi_xy_t xy = gdi_xy();
+    *xy.x = c->state.x;
+    *xy.y = c->state.y;
+    if (c->top == 0) {
+        if (gdi_rc != null) {
+            gdi_rc->last_frame = gdi_rc->counters;
+        } else {
+            gdi.last_frame = gdi.counters;
+        }
+    }
+}
+
+static void gdi_scaled_invalidate_bitmap(ui_bitmap_t bitmap);
+
+static void gdi_begin(gdi_context_t* c, ui_canvas_t canvas) {
+    not_null(canvas);
+    memset(c, 0, sizeof(*c));
+    c->canvas = canvas;
+    // scaled copies of the image selected into canvas become stale:
+    c->bitmap = (ui_bitmap_t)GetCurrentObject((HDC)canvas, OBJ_BITMAP);
+    gdi_scaled_invalidate_bitmap(c->bitmap);
+    c->previous = gdi_rc;
+    gdi_rc = c;
 }
 
+static void gdi_end(void) {
+    gdi_context_t* c = gdi_rc;
+    not_null(c);
+    assert(c->top == 0, "unbalanced push/pop: %d", c->top);
+    gdi_scaled_invalidate_bitmap(c->bitmap); // drawn while inside begin()
+    if (c->state.clip_known && c->state.clip.w > 0) { // set_clip() outside push()
+        fatal_if(SelectClipRgn((HDC)c->canvas, null) == ERROR);
+    }
+    if (c->memory != null) {
+        fatal_if_false(DeleteDC((HDC)c->memory));
+        c->memory = null;
+    }
+    gdi_rc = c->previous;
+}
+
+static gdi_context_t* gdi_current(void) { return gdi_rc; }
+
 static void gdi_pixel(int32_t x, int32_t y, ui_color_t c) {
-    not_null(app.canvas);
-    fatal_if_false(SetPixel(canvas(), x, y, gdi_color_ref(c)));
+    not_null(gdi_canvas());
+    fatal_if_false(SetPixel(gdi_canvas(), x, y, gdi_color_ref(c)));
 }
 
 static ui_point_t gdi_move_to(int32_t x, int32_t y) {
+    gdi_xy_t xy = gdi_xy();
     POINT pt;
-    pt.x = gdi.x;
-    pt.y = gdi.y;
-    fatal_if_false(MoveToEx(canvas(), x, y, &pt));
-    gdi.x = x;
-    gdi.y = y;
+    pt.x = *xy.x;
+    pt.y = *xy.y;
+    fatal_if_false(MoveToEx(gdi_canvas(), x, y, &pt));
+    *xy.x = x;
+    *xy.y = y;
     ui_point_t p = { pt.x, pt.y };
     return p;
 }
 
 static void gdi_line(int32_t x, int32_t y) {
-    fatal_if_false(LineTo(canvas(), x, y));
-    gdi.x = x;
-    gdi.y = y;
+    fatal_if_false(LineTo(gdi_canvas(), x, y));
+    gdi_xy_t xy = gdi_xy();
+    *xy.x = x;
+    *xy.y = y;
 }
 
 static void gdi_frame(int32_t x, int32_t y, int32_t w, int32_t h) {
@@ -119,13 +334,13 @@ static void gdi_frame(int32_t x, int32_t y, int32_t w, int32_t h) {
 }
 
 static void gdi_rect(int32_t x, int32_t y, int32_t w, int32_t h) {
-    fatal_if_false(Rectangle(canvas(), x, y, x + w, y + h));
+    fatal_if_false(Rectangle(gdi_canvas(), x, y, x + w, y + h));
 }
 
 static void gdi_fill(int32_t x, int32_t y, int32_t w, int32_t h) {
     RECT rc = { x, y, x + w, y + h };
-    ui_brush_t b = (ui_brush_t)GetCurrentObject(canvas(), OBJ_BRUSH);
-    fatal_if_false(FillRect(canvas(), &rc, (HBRUSH)b));
+    ui_brush_t b = (ui_brush_t)GetCurrentObject(gdi_canvas(), OBJ_BRUSH);
+    fatal_if_false(FillRect(gdi_canvas(), &rc, (HBRUSH)b));
 }
 
 static void gdi_frame_with(int32_t x, int32_t y, int32_t w, int32_t h,
@@ -162,13 +377,62 @@ static void gdi_poly(ui_point_t* points, int32_t count) {
     static_assert(sizeof(points->x) == sizeof(((POINT*)0)->x), "ui_point_t");
     static_assert(sizeof(points->y) == sizeof(((POINT*)0)->y), "ui_point_t");
     static_assert(sizeof(points[0]) == sizeof(*((POINT*)0)), "ui_point_t");
-    assert(canvas() != null && count > 1);
-    fatal_if_false(Polyline(canvas(), (POINT*)points, count));
+    assert(gdi_canvas() != null && count > 1);
+    fatal_if_false(Polyline(gdi_canvas(), (POINT*)points, count));
+}
+
+// Sorted edges of recently filled polygons are kept for the next frames
+// in a small LRU keyed by vertices relative to the first one (see
+// polyfill.h), thus moved polygons are not sorted again either:
+
+enum { gdi_polyfill_max = 8 };
+
+static struct {
+    polyfill_t entries[gdi_polyfill_max];
+    uint64_t used[gdi_polyfill_max]; // LRU tick
+    uint64_t tick;
+    SRWLOCK lock;
+} gdi_polyfill = { .lock = SRWLOCK_INIT };
+
+// gdi_polygon_spans() calls span() for runs of polygon pixels inside clip
+
+static void gdi_polygon_spans(const ui_point_t* points, int32_t count,
+        int32_t rule, const ui_rect_t* clip, void* that,
+        void (*span)(void* that, int32_t x, int32_t y, int32_t w, int32_t h)) {
+    assert(count > 2);
+    const uint64_t hash = polyfill_hash(points, count);
+    AcquireSRWLockExclusive(&gdi_polyfill.lock);
+    int32_t lru = 0;
+    int32_t k = -1;
+    for (int32_t i = 0; i < gdi_polyfill_max && k < 0; i++) {
+        const polyfill_t* p = &gdi_polyfill.entries[i];
+        // hash collision only evicts the entry: edges() compares vertices
+        if (p->points == count && p->hash == hash) { k = i; }
+        if (gdi_polyfill.used[i] < gdi_polyfill.used[lru]) { lru = i; }
+    }
+    if (k < 0) { k = lru; } // buffers of evicted entry are reused
+    polyfill_t* p = &gdi_polyfill.entries[k];
+    gdi_polyfill.used[k] = ++gdi_polyfill.tick;
+    polyfill.edges(p, points, count);
+    polyfill.fill(p, rule, clip, that, span);
+    ReleaseSRWLockExclusive(&gdi_polyfill.lock);
+}
+
+static void gdi_polygon_span(void* unused(that), int32_t x, int32_t y,
+        int32_t w, int32_t h) {
+    gdi_fill(x, y, w, h);
+}
+
+static void gdi_polygon(ui_point_t* points, int32_t count, int32_t rule) {
+    assert(gdi_canvas() != null);
+    const ui_rect_t* clip = gdi_state_known() ?
+        &gdi_context()->state.visible : null;
+    gdi_polygon_spans(points, count, rule, clip, null, gdi_polygon_span);
 }
 
 static void gdi_rounded(int32_t x, int32_t y, int32_t w, int32_t h,
         int32_t rx, int32_t ry) {
-    fatal_if_false(RoundRect(canvas(), x, y, x + w, y + h, rx, ry));
+    fatal_if_false(RoundRect(gdi_canvas(), x, y, x + w, y + h, rx, ry));
 }
 
 static void gdi_gradient(int32_t x, int32_t y, int32_t w, int32_t h,
@@ -189,7 +453,7 @@ static void gdi_gradient(int32_t x, int32_t y, int32_t w, int32_t h,
     vertex[1].Alpha = ((rgba_to >> 24) & 0xFF) << 8;
     GRADIENT_RECT gRect = {0, 1};
     const int32_t mode = vertical ? GRADIENT_FILL_RECT_V : GRADIENT_FILL_RECT_H;
-    GradientFill(canvas(), vertex, 2, &gRect, 1, mode);
+    GradientFill(gdi_canvas(), vertex, 2, &gRect, 1, mode);
 }
 
 static BITMAPINFO* gdi_greyscale_bitmap_info(void) {
@@ -197,8 +461,8 @@ static BITMAPINFO* gdi_greyscale_bitmap_info(void) {
         BITMAPINFO bi;
         RGBQUAD rgb[256];
     } bitmap_rgb_t;
-    static bitmap_rgb_t storage; // for grayscale palette
-    static BITMAPINFO* bi = &storage.bi;
+    static thread_local bitmap_rgb_t storage; // for grayscale palette
+    BITMAPINFO* bi = &storage.bi;
     BITMAPINFOHEADER* bih = &bi->bmiHeader;
     if (bih->biSize == 0) { // once
         bih->biSize = sizeof(BITMAPINFOHEADER);
@@ -228,10 +492,10 @@ static void gdi_draw_greyscale(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
         bih->biHeight = -ih; // top down image
         bih->biSizeImage = w * h;
         POINT pt = { 0 };
-        fatal_if_false(SetBrushOrgEx(canvas(), 0, 0, &pt));
-        fatal_if(StretchDIBits(canvas(), sx, sy, sw, sh, x, y, w, h,
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), 0, 0, &pt));
+        fatal_if(StretchDIBits(gdi_canvas(), sx, sy, sw, sh, x, y, w, h,
             pixels, bi, DIB_RGB_COLORS, SRCCOPY) == 0);
-        fatal_if_false(SetBrushOrgEx(canvas(), pt.x, pt.y, &pt));
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), pt.x, pt.y, &pt));
     }
 }
 
@@ -263,10 +527,10 @@ static void gdi_draw_bgr(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
     if (w > 0 && h != 0) {
         BITMAPINFOHEADER bi = gdi_bgrx_init_bi(iw, ih, 3);
         POINT pt = { 0 };
-        fatal_if_false(SetBrushOrgEx(canvas(), 0, 0, &pt));
-        fatal_if(StretchDIBits(canvas(), sx, sy, sw, sh, x, y, w, h,
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), 0, 0, &pt));
+        fatal_if(StretchDIBits(gdi_canvas(), sx, sy, sw, sh, x, y, w, h,
             pixels, (BITMAPINFO*)&bi, DIB_RGB_COLORS, SRCCOPY) == 0);
-        fatal_if_false(SetBrushOrgEx(canvas(), pt.x, pt.y, &pt));
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), pt.x, pt.y, &pt));
     }
 }
 
@@ -279,10 +543,10 @@ static void gdi_draw_bgrx(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
     if (w > 0 && h != 0) {
         BITMAPINFOHEADER bi = gdi_bgrx_init_bi(iw, ih, 4);
         POINT pt = { 0 };
-        fatal_if_false(SetBrushOrgEx(canvas(), 0, 0, &pt));
-        fatal_if(StretchDIBits(canvas(), sx, sy, sw, sh, x, y, w, h,
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), 0, 0, &pt));
+        fatal_if(StretchDIBits(gdi_canvas(), sx, sy, sw, sh, x, y, w, h,
             pixels, (BITMAPINFO*)&bi, DIB_RGB_COLORS, SRCCOPY) == 0);
-        fatal_if_false(SetBrushOrgEx(canvas(), pt.x, pt.y, &pt));
+        fatal_if_false(SetBrushOrgEx(gdi_canvas(), pt.x, pt.y, &pt));
     }
 }
 
@@ -320,136 +584,274 @@ static void gdi_image_init_rgbx(image_t* image, int32_t w, int32_t h,
     fatal_if(bpp != 4, "bpp: %d", bpp);
     gdi_create_dib_section(image, w, h, bpp);
     const int32_t stride = (w * bpp + 3) & ~0x3;
-    uint8_t* scanline = image->pixels;
-    const uint8_t* rgbx = pixels;
-    if (!swapped) {
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgra[0] = rgbx[2];
-                bgra[1] = rgbx[1];
-                bgra[2] = rgbx[0];
-                bgra[3] = 0xFF;
-                bgra += 4;
-                rgbx += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
-        }
-    } else {
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgra[0] = rgbx[0];
-                bgra[1] = rgbx[1];
-                bgra[2] = rgbx[2];
-                bgra[3] = 0xFF;
-                bgra += 4;
-                rgbx += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
-        }
-    }
+    conversions.rows(swapped ? conversions.bgrx_to_bgra :
+                               conversions.rgbx_to_bgra,
+                     image->pixels, stride, pixels, w * 4, w, h);
     image->w = w;
     image->h = h;
     image->bpp = bpp;
     image->stride = stride;
 }
 
+static void gdi_image_convert(image_t* image, bool swapped,
+        const uint8_t* pixels) {
+    const int32_t w = image->w;
+    const int32_t h = image->h;
+    const int32_t bpp = image->bpp;
+    uint8_t* scanline = image->pixels;
+    if (bpp == 1 || bpp == 3 && swapped) {
+        for (int32_t y = 0; y < h; y++) {
+            memcpy(scanline, pixels, w * bpp);
+            pixels += w * bpp;
+            scanline += image->stride;
+        }
+    } else if (bpp == 3) {
+        conversions.rows(conversions.swap_rb3, scanline, image->stride,
+                         pixels, w * bpp, w, h);
+    } else if (bpp == 4) {
+        // premultiply alpha, see:
+        // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
+        conversions.rows(swapped ? conversions.bgra_premultiply :
+                                   conversions.rgba_premultiply,
+                         scanline, image->stride, pixels, w * 4, w, h);
+    }
+}
+
 static void gdi_image_init(image_t* image, int32_t w, int32_t h, int32_t bpp,
         const uint8_t* pixels) {
     bool swapped = bpp < 0;
     bpp = abs(bpp);
     fatal_if(bpp < 0 || bpp == 2 || bpp > 4, "bpp=%d not {1, 3, 4}", bpp);
     gdi_create_dib_section(image, w, h, bpp);
+    image->w = w;
+    image->h = h;
+    image->bpp = bpp;
     // Win32 bitmaps stride is rounded up to 4 bytes
-    const int32_t stride = (w * bpp + 3) & ~0x3;
-    uint8_t* scanline = image->pixels;
-    if (bpp == 1) {
-        for (int32_t y = 0; y < h; y++) {
-            memcpy(scanline, pixels, w);
-            pixels += w;
-            scanline += stride;
-        }
-    } else if (bpp == 3 && !swapped) {
-        const uint8_t* rgb = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgr = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgr[0] = rgb[2];
-                bgr[1] = rgb[1];
-                bgr[2] = rgb[0];
-                bgr += 3;
-                rgb += 3;
-            }
-            pixels += w * bpp;
-            scanline += stride;
+    image->stride = (w * bpp + 3) & ~0x3;
+    gdi_image_convert(image, swapped, pixels);
+}
+
+// Images drawn by draw_image() at other than natural size are resampled
+// once and the scaled copies are kept in a small LRU keyed by
+// (image, bitmap, w, h, filter) until the image is updated, disposed or
+// becomes render target of gdi.begin() or raster.begin():
+
+enum {
+    gdi_scaled_max = 16,
+    gdi_scaled_bytes_max = 256 * 1024 * 1024
+};
+
+typedef struct gdi_scaled_s {
+    const image_t* source; // only compared: image_t may be moved or copied
+    ui_bitmap_t bitmap; // source->bitmap at the time of scaling
+    int32_t filter;
+    image_t image; // scaled to w x h, bpp == 4
+    uint64_t used; // LRU tick
+} gdi_scaled_t;
+
+static struct {
+    gdi_scaled_t entries[gdi_scaled_max];
+    int32_t count;
+    int64_t bytes;
+    uint64_t tick;
+    image_t** mipped; // image.mip chain heads (see gdi_scaled_mipped())
+    int32_t mipped_count;
+    int32_t mipped_capacity;
+    SRWLOCK lock;
+} gdi_scaled = { .lock = SRWLOCK_INIT };
+
+static void gdi_scaled_remove(int32_t i) { // gdi_scaled.lock is held
+    gdi_scaled_t* e = &gdi_scaled.entries[i];
+    gdi_scaled.bytes -= (int64_t)e->image.stride * e->image.h;
+    fatal_if_false(DeleteBitmap(e->image.bitmap));
+    gdi_scaled.entries[i] = gdi_scaled.entries[--gdi_scaled.count];
+}
+
+// The first level of image.mip chain (heap, unlike image_t itself that
+// is copied by value) keeps image.bitmap it was built from in its own
+// .bitmap. gdi_scaled_mipped() registers the chain thus when the bitmap
+// is drawn into the chain is marked stale (head.bitmap = null) and
+// gdi_mip() rebuilds it on the next use. gdi_scaled.lock is held.
+
+static void gdi_scaled_mipped(image_t* head, ui_bitmap_t bitmap) {
+    head->bitmap = bitmap;
+    if (bitmap != null) {
+        if (gdi_scaled.mipped_count == gdi_scaled.mipped_capacity) {
+            const int32_t n = gdi_scaled.mipped_capacity * 2 + 16;
+            image_t** mipped = (image_t**)realloc(gdi_scaled.mipped,
+                n * sizeof(image_t*));
+            fatal_if_null(mipped);
+            gdi_scaled.mipped = mipped;
+            gdi_scaled.mipped_capacity = n;
         }
-    } else if (bpp == 3 && swapped) {
-        const uint8_t* rgb = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgr = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgr[0] = rgb[0];
-                bgr[1] = rgb[1];
-                bgr[2] = rgb[2];
-                bgr += 3;
-                rgb += 3;
+        gdi_scaled.mipped[gdi_scaled.mipped_count++] = head;
+    }
+}
+
+static void gdi_scaled_free_mip(image_t* image) { // gdi_scaled.lock is held
+    image_t* m = image->mip;
+    if (m != null && m->bitmap != null) { // registered and not stale
+        for (int32_t i = 0; i < gdi_scaled.mipped_count; i++) {
+            if (gdi_scaled.mipped[i] == m) {
+                gdi_scaled.mipped[i] =
+                    gdi_scaled.mipped[--gdi_scaled.mipped_count];
+                break;
             }
-            pixels += w * bpp;
-            scanline += stride;
         }
-    } else if (bpp == 4 && !swapped) {
-        // premultiply alpha, see:
-        // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
-        const uint8_t* rgba = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                int32_t alpha = rgba[3];
-                bgra[0] = (uint8_t)(rgba[2] * alpha / 255);
-                bgra[1] = (uint8_t)(rgba[1] * alpha / 255);
-                bgra[2] = (uint8_t)(rgba[0] * alpha / 255);
-                bgra[3] = rgba[3];
-                bgra += 4;
-                rgba += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
+    }
+    while (m != null) { image_t* next = m->mip; free(m); m = next; }
+    image->mip = null;
+}
+
+static void gdi_scaled_drop_bitmap(ui_bitmap_t bitmap) { // lock is held
+    for (int32_t i = gdi_scaled.count - 1; i >= 0; i--) {
+        if (gdi_scaled.entries[i].bitmap == bitmap) { gdi_scaled_remove(i); }
+    }
+    for (int32_t i = gdi_scaled.mipped_count - 1; i >= 0; i--) {
+        if (gdi_scaled.mipped[i]->bitmap == bitmap) {
+            gdi_scaled.mipped[i]->bitmap = null; // stale
+            gdi_scaled.mipped[i] = gdi_scaled.mipped[--gdi_scaled.mipped_count];
         }
-    } else if (bpp == 4 && swapped) {
-        // premultiply alpha, see:
-        // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
-        const uint8_t* rgba = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                int32_t alpha = rgba[3];
-                bgra[0] = (uint8_t)(rgba[0] * alpha / 255);
-                bgra[1] = (uint8_t)(rgba[1] * alpha / 255);
-                bgra[2] = (uint8_t)(rgba[2] * alpha / 255);
-                bgra[3] = rgba[3];
-                bgra += 4;
-                rgba += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
+    }
+}
+
+// gdi_scaled_drop() also drops entries created by drawing copies of the
+// image (image_t is copied by value): they share image.bitmap which may
+// be handed out again by image_acquire() with new pixels.
+
+static void gdi_scaled_drop(image_t* image) { // gdi_scaled.lock is held
+    for (int32_t i = gdi_scaled.count - 1; i >= 0; i--) {
+        if (gdi_scaled.entries[i].source == image) { gdi_scaled_remove(i); }
+    }
+    if (image->bitmap != null) { gdi_scaled_drop_bitmap(image->bitmap); }
+    gdi_scaled_free_mip(image);
+}
+
+static void gdi_scaled_invalidate(image_t* image) {
+    AcquireSRWLockExclusive(&gdi_scaled.lock);
+    gdi_scaled_drop(image);
+    ReleaseSRWLockExclusive(&gdi_scaled.lock);
+}
+
+// gdi_scaled_invalidate_bitmap() of images which bitmap was drawn into
+
+static void gdi_scaled_invalidate_bitmap(ui_bitmap_t bitmap) {
+    if (bitmap == null) { return; }
+    AcquireSRWLockExclusive(&gdi_scaled.lock);
+    gdi_scaled_drop_bitmap(bitmap);
+    ReleaseSRWLockExclusive(&gdi_scaled.lock);
+}
+
+static void gdi_image_update(image_t* image, int32_t bpp,
+        const uint8_t* pixels) {
+    fatal_if(image->bitmap == null, "image_init() not called?");
+    fatal_if(abs(bpp) != image->bpp, "bpp=%d image.bpp=%d", bpp, image->bpp);
+    GdiFlush(); // GDI may still be reading the bitmap
+    gdi_image_convert(image, bpp < 0, pixels);
+    gdi_scaled_invalidate(image);
+}
+
+// Released DIB sections are kept in a small pool bucketed by exact
+// (w, h, bpp) so animation and video frames reuse GDI allocations:
+
+enum { gdi_image_pool_max = 16 };
+
+static struct {
+    image_t images[gdi_image_pool_max]; // oldest first
+    int32_t count;
+    SRWLOCK lock;
+} gdi_image_pool = { .lock = SRWLOCK_INIT };
+
+static void gdi_image_acquire(image_t* image, int32_t w, int32_t h,
+        int32_t bpp) {
+    fatal_if(image->bitmap != null, "image_release() not called?");
+    fatal_if(bpp != 1 && bpp != 3 && bpp != 4, "bpp=%d not {1, 3, 4}", bpp);
+    AcquireSRWLockExclusive(&gdi_image_pool.lock);
+    for (int32_t i = gdi_image_pool.count - 1; i >= 0; i--) {
+        const image_t* pi = &gdi_image_pool.images[i];
+        if (pi->w == w && pi->h == h && pi->bpp == bpp) {
+            *image = *pi;
+            gdi_image_pool.count--;
+            memmove(&gdi_image_pool.images[i], &gdi_image_pool.images[i + 1],
+                (gdi_image_pool.count - i) * sizeof(image_t));
+            break;
         }
     }
-    image->w = w;
-    image->h = h;
-    image->bpp = bpp;
-    image->stride = stride;
+    ReleaseSRWLockExclusive(&gdi_image_pool.lock);
+    if (image->bitmap == null) {
+        gdi_create_dib_section(image, w, h, bpp);
+        image->w = w;
+        image->h = h;
+        image->bpp = bpp;
+        image->stride = (w * bpp + 3) & ~0x3;
+    }
+}
+
+static void gdi_image_release(image_t* image) {
+    not_null(image->bitmap);
+    gdi_scaled_invalidate(image);
+    image_t evicted = {0};
+    AcquireSRWLockExclusive(&gdi_image_pool.lock);
+    if (gdi_image_pool.count == gdi_image_pool_max) {
+        evicted = gdi_image_pool.images[0];
+        gdi_image_pool.count--;
+        memmove(&gdi_image_pool.images[0], &gdi_image_pool.images[1],
+            gdi_image_pool.count * sizeof(image_t));
+    }
+    gdi_image_pool.images[gdi_image_pool.count++] = *image;
+    ReleaseSRWLockExclusive(&gdi_image_pool.lock);
+    memset(image, 0, sizeof(image_t));
+    if (evicted.bitmap != null) { fatal_if_false(DeleteBitmap(evicted.bitmap)); }
+}
+
+// memory DC for blitting images of the render context (created once
+// instead of CreateCompatibleDC() / DeleteDC() on each draw_image() or
+// alpha_blend(), deleted by gdi.end() or at exit for UI thread)
+
+static HDC gdi_image_dc(void) {
+    gdi_context_t* c = gdi_context();
+    if (c->memory == null) {
+        c->memory = (ui_canvas_t)CreateCompatibleDC(null);
+        not_null(c->memory);
+    }
+    return (HDC)c->memory;
+}
+
+static void __gdi_fini__(void) {
+    if (gdi_app.memory != null) {
+        fatal_if_false(DeleteDC((HDC)gdi_app.memory));
+        gdi_app.memory = null;
+    }
+    AcquireSRWLockExclusive(&gdi_image_pool.lock);
+    for (int32_t i = 0; i < gdi_image_pool.count; i++) {
+        fatal_if_false(DeleteBitmap(gdi_image_pool.images[i].bitmap));
+    }
+    gdi_image_pool.count = 0;
+    ReleaseSRWLockExclusive(&gdi_image_pool.lock);
+    AcquireSRWLockExclusive(&gdi_scaled.lock);
+    while (gdi_scaled.count > 0) { gdi_scaled_remove(gdi_scaled.count - 1); }
+    free(gdi_scaled.mipped); // chains are freed with their images
+    gdi_scaled.mipped = null;
+    gdi_scaled.mipped_count = 0;
+    gdi_scaled.mipped_capacity = 0;
+    ReleaseSRWLockExclusive(&gdi_scaled.lock);
+    AcquireSRWLockExclusive(&gdi_polyfill.lock);
+    for (int32_t i = 0; i < gdi_polyfill_max; i++) {
+        polyfill.dispose(&gdi_polyfill.entries[i]);
+    }
+    ReleaseSRWLockExclusive(&gdi_polyfill.lock);
+    for (int32_t i = 0; i < gdi_objects_count; i++) {
+        fatal_if_false(DeleteObject((HGDIOBJ)gdi_objects[i].handle));
+    }
+    gdi_objects_count = 0;
 }
 
 static void gdi_alpha_blend(int32_t x, int32_t y, int32_t w, int32_t h,
         image_t* image, double alpha) {
     assert(image->bpp > 0);
     assert(0 <= alpha && alpha <= 1);
-    not_null(canvas());
-    HDC c = CreateCompatibleDC(canvas());
-    not_null(c);
+    not_null(gdi_canvas());
+    HDC c = gdi_image_dc();
     HBITMAP zero1x1 = SelectBitmap((HDC)c, (HBITMAP)image->bitmap);
     BLENDFUNCTION bf = { 0 };
     bf.SourceConstantAlpha = (uint8_t)(0xFF * alpha + 0.49);
@@ -462,29 +864,201 @@ static void gdi_alpha_blend(int32_t x, int32_t y, int32_t w, int32_t h,
         bf.BlendFlags = 0;
         bf.AlphaFormat = 0;
     }
-    fatal_if_false(AlphaBlend(canvas(), x, y, w, h,
+    fatal_if_false(AlphaBlend(gdi_canvas(), x, y, w, h,
         c, 0, 0, image->w, image->h, bf));
     SelectBitmap((HDC)c, zero1x1);
-    fatal_if_false(DeleteDC(c));
+}
+
+// gdi_image_bgra() returns malloc()-ed opaque BGRA copy of bpp 3 image
+// or null for bpp 4 image pixels that can be used as is
+
+static uint8_t* gdi_image_bgra(const image_t* image) {
+    if (image->bpp != 3) { return null; }
+    const int32_t stride = image->w * 4;
+    uint8_t* bgra = (uint8_t*)malloc((size_t)stride * image->h);
+    fatal_if_null(bgra);
+    for (int32_t y = 0; y < image->h; y++) {
+        const uint8_t* s = (const uint8_t*)image->pixels +
+            (int64_t)y * image->stride;
+        uint8_t* d = bgra + (int64_t)y * stride;
+        for (int32_t x = 0; x < image->w; x++) {
+            d[x * 4 + 0] = s[x * 3 + 0];
+            d[x * 4 + 1] = s[x * 3 + 1];
+            d[x * 4 + 2] = s[x * 3 + 2];
+            d[x * 4 + 3] = 0xFF;
+        }
+    }
+    return bgra;
+}
+
+// gdi_mip() returns the smallest level of image.mip chain that is still
+// at least w x h building missing levels, or null if image is not at
+// least twice as large as w x h. Levels are resampled without holding
+// gdi_scaled.lock and attached under it (the first one wins when two
+// threads draw the same image).
+
+static image_t* gdi_mip(image_t* image, int32_t w, int32_t h) {
+    AcquireSRWLockExclusive(&gdi_scaled.lock);
+    if (image->mip != null && image->mip->bitmap != image->bitmap) {
+        gdi_scaled_free_mip(image); // stale: image.bitmap was drawn into
+    }
+    ReleaseSRWLockExclusive(&gdi_scaled.lock);
+    image_t* level = image;
+    while ((level->w + 1) / 2 >= w && (level->h + 1) / 2 >= h &&
+           (level->w > 1 || level->h > 1)) {
+        AcquireSRWLockExclusive(&gdi_scaled.lock);
+        image_t* next = level->mip;
+        ReleaseSRWLockExclusive(&gdi_scaled.lock);
+        if (next == null) {
+            const uint8_t* s = (const uint8_t*)level->pixels;
+            int32_t stride = level->stride;
+            uint8_t* bgra = null;
+            if (level == image && image->bpp == 3) {
+                bgra = gdi_image_bgra(image);
+                s = bgra;
+                stride = image->w * 4;
+            }
+            const int32_t mw = (level->w + 1) / 2;
+            const int32_t mh = (level->h + 1) / 2;
+            image_t* m = (image_t*)malloc(sizeof(image_t) + (size_t)mw * mh * 4);
+            fatal_if_null(m);
+            memset(m, 0, sizeof(image_t));
+            m->w = mw;
+            m->h = mh;
+            m->bpp = 4;
+            m->stride = mw * 4;
+            m->pixels = m + 1;
+            resample.half((uint8_t*)m->pixels, m->stride, s,
+                level->w, level->h, stride,
+                gdi.image_mipmap == gdi_mipmap_gamma);
+            free(bgra);
+            AcquireSRWLockExclusive(&gdi_scaled.lock);
+            if (level->mip == null) {
+                if (level == image) { gdi_scaled_mipped(m, image->bitmap); }
+                level->mip = m;
+                m = null;
+            }
+            next = level->mip;
+            ReleaseSRWLockExclusive(&gdi_scaled.lock);
+            free(m); // null or built by another thread first
+        }
+        level = next;
+    }
+    return level == image ? null : level;
+}
+
+// gdi_scaled_create() resamples image to w x h BGRA into e without
+// holding gdi_scaled.lock: resampling of a large image must not block
+// scaled draws of other threads.
+
+static void gdi_scaled_create(gdi_scaled_t* e, image_t* image,
+        int32_t w, int32_t h) {
+    memset(e, 0, sizeof(*e));
+    gdi_create_dib_section(&e->image, w, h, 4);
+    e->image.w = w;
+    e->image.h = h;
+    e->image.bpp = 4;
+    e->image.stride = w * 4;
+    e->source = image;
+    e->bitmap = image->bitmap;
+    e->filter = gdi.image_filter;
+    GdiFlush(); // complete pending GDI drawing into image
+    const image_t* mip = gdi.image_mipmap != gdi_mipmap_off ?
+        gdi_mip(image, w, h) : null;
+    if (mip != null) {
+        resample.bgra((uint8_t*)e->image.pixels, w, h, e->image.stride,
+            (const uint8_t*)mip->pixels, mip->w, mip->h, mip->stride,
+            e->filter);
+    } else {
+        uint8_t* bgra = gdi_image_bgra(image);
+        const uint8_t* pixels = bgra != null ?
+            bgra : (const uint8_t*)image->pixels;
+        const int32_t stride = bgra != null ? image->w * 4 : image->stride;
+        resample.bgra((uint8_t*)e->image.pixels, w, h, e->image.stride,
+            pixels, image->w, image->h, stride, e->filter);
+        free(bgra);
+    }
+}
+
+static gdi_scaled_t* gdi_scaled_find(const image_t* image,
+        int32_t w, int32_t h) { // gdi_scaled.lock is held
+    for (int32_t i = 0; i < gdi_scaled.count; i++) {
+        gdi_scaled_t* s = &gdi_scaled.entries[i];
+        if (s->source == image && s->bitmap == image->bitmap &&
+            s->image.w == w && s->image.h == h &&
+            s->filter == gdi.image_filter) {
+            return s;
+        }
+    }
+    return null;
+}
+
+// gdi_scaled_insert() evicts least recently used entries to make room
+// for s, gdi_scaled.lock is held
+
+static gdi_scaled_t* gdi_scaled_insert(const gdi_scaled_t* s) {
+    const int64_t bytes = (int64_t)s->image.stride * s->image.h;
+    while (gdi_scaled.count > 0 && (gdi_scaled.count == gdi_scaled_max ||
+           gdi_scaled.bytes + bytes > gdi_scaled_bytes_max)) {
+        int32_t lru = 0;
+        for (int32_t i = 1; i < gdi_scaled.count; i++) {
+            if (gdi_scaled.entries[i].used < gdi_scaled.entries[lru].used) {
+                lru = i;
+            }
+        }
+        gdi_scaled_remove(lru);
+    }
+    gdi_scaled_t* e = &gdi_scaled.entries[gdi_scaled.count++];
+    *e = *s;
+    gdi_scaled.bytes += bytes;
+    return e;
+}
+
+static bool gdi_draw_scaled(int32_t x, int32_t y, int32_t w, int32_t h,
+        image_t* image) {
+    const bool scale = gdi.image_filter >= 0 && w > 0 && h > 0 &&
+        (w != image->w || h != image->h) && image->pixels != null &&
+        (image->bpp == 3 || image->bpp == 4);
+    if (scale) {
+        AcquireSRWLockExclusive(&gdi_scaled.lock);
+        gdi_scaled_t* e = gdi_scaled_find(image, w, h);
+        if (e == null) {
+            ReleaseSRWLockExclusive(&gdi_scaled.lock);
+            gdi_scaled_t created;
+            gdi_scaled_create(&created, image, w, h);
+            AcquireSRWLockExclusive(&gdi_scaled.lock);
+            e = gdi_scaled_find(image, w, h);
+            if (e == null) {
+                e = gdi_scaled_insert(&created);
+            } else { // another thread inserted the same copy meanwhile
+                fatal_if_false(DeleteBitmap(created.image.bitmap));
+            }
+        }
+        e->used = ++gdi_scaled.tick;
+        HDC c = gdi_image_dc();
+        HBITMAP zero1x1 = SelectBitmap(c, (HBITMAP)e->image.bitmap);
+        fatal_if_false(BitBlt(gdi_canvas(), x, y, w, h, c, 0, 0, SRCCOPY));
+        SelectBitmap(c, zero1x1);
+        ReleaseSRWLockExclusive(&gdi_scaled.lock);
+    }
+    return scale;
 }
 
 static void gdi_draw_image(int32_t x, int32_t y, int32_t w, int32_t h,
         image_t* image) {
     assert(image->bpp == 1 || image->bpp == 3 || image->bpp == 4);
-    not_null(canvas());
+    not_null(gdi_canvas());
     if (image->bpp == 1) { // StretchBlt() is bad for greyscale
         BITMAPINFO* bi = gdi_greyscale_bitmap_info();
-        fatal_if(StretchDIBits(canvas(), x, y, w, h, 0, 0, image->w, image->h,
+        fatal_if(StretchDIBits(gdi_canvas(), x, y, w, h, 0, 0, image->w, image->h,
             image->pixels, gdi_init_bitmap_info(image->w, image->h, 1, bi),
             DIB_RGB_COLORS, SRCCOPY) == 0);
-    } else {
-        HDC c = CreateCompatibleDC(canvas());
-        not_null(c);
+    } else if (!gdi_draw_scaled(x, y, w, h, image)) {
+        HDC c = gdi_image_dc();
         HBITMAP zero1x1 = SelectBitmap(c, image->bitmap);
-        fatal_if_false(StretchBlt(canvas(), x, y, w, h,
+        fatal_if_false(StretchBlt(gdi_canvas(), x, y, w, h,
             c, 0, 0, image->w, image->h, SRCCOPY));
         SelectBitmap(c, zero1x1);
-        fatal_if_false(DeleteDC(c));
     }
 }
 
@@ -534,34 +1108,42 @@ static int32_t gdi_font_height(ui_font_t f) {
     return abs(lf.lfHeight);
 }
 
+static void gdi_measure_invalidate(void);
+
 static void gdi_delete_font(ui_font_t f) {
     fatal_if_false(DeleteFont(f));
+    gdi_measure_invalidate(); // font handle value may be reused
 }
 
 static ui_font_t gdi_set_font(ui_font_t f) {
     not_null(f);
-    return (ui_font_t)SelectFont(canvas(), (HFONT)f);
+    gdi_state_t* st = &gdi_context()->state;
+    if (!gdi_state_changed(st->font == f)) { return f; }
+    st->font = f;
+    return (ui_font_t)SelectFont(gdi_canvas(), (HFONT)f);
 }
 
 #define gdi_with_hdc(code) do {                              \
-    not_null(window());                                      \
-    HDC hdc = canvas() != null ? canvas() : GetDC(window()); \
+    HDC hdc = gdi_canvas();                                  \
+    const bool release = hdc == null;                        \
+    if (release) { hdc = GetDC(window()); }                  \
     not_null(hdc);                                           \
     code                                                     \
-    if (canvas() == null) {                                  \
+    if (release) {                                           \
         ReleaseDC(window(), hdc);                            \
     }                                                        \
 } while (0);
 
 #define gdi_hdc_with_font(f, code) do {                      \
     not_null(f);                                             \
-    not_null(window());                                      \
-    HDC hdc = canvas() != null ? canvas() : GetDC(window()); \
+    HDC hdc = gdi_canvas();                                  \
+    const bool release = hdc == null;                        \
+    if (release) { hdc = GetDC(window()); }                  \
     not_null(hdc);                                           \
     HFONT _font_ = SelectFont(hdc, (HFONT)f);                \
     code                                                     \
     SelectFont(hdc, _font_);                                 \
-    if (canvas() == null) {                                  \
+    if (release) {                                           \
         ReleaseDC(window(), hdc);                            \
     }                                                        \
 } while (0);
@@ -614,14 +1196,28 @@ static double gdi_line_spacing(double height_multiplier) {
 static int32_t gdi_draw_utf16(ui_font_t font, const char* s, int32_t n,
         RECT* r, uint32_t format) {
     // if font == null, draws on HDC with selected font
+    // n is number of UTF-8 bytes in s or -1 if s is zero terminated
+    const wchar_t* utf16 = null;
+    int32_t count = -1;
+    if (n < 0) {
+        utf16 = utf8to16(s);
+    } else if (n > 0) { // UTF-16 never needs more code units than UTF-8 bytes
+        wchar_t* u = (wchar_t*)alloca((n + 1) * sizeof(wchar_t));
+        count = MultiByteToWideChar(CP_UTF8, 0, s, n, u, n);
+        fatal_if(count <= 0);
+        utf16 = u;
+    } else {
+        utf16 = L"";
+        count = 0;
+    }
     int32_t height = 0; // return value is the height of the text in logical units
     if (font != null) {
         gdi_hdc_with_font(font, {
-            height = DrawTextW(hdc, utf8to16(s), n, r, format);
+            height = DrawTextW(hdc, utf16, count, r, format);
         });
     } else {
         gdi_with_hdc({
-            height = DrawTextW(hdc, utf8to16(s), n, r, format);
+            height = DrawTextW(hdc, utf16, count, r, format);
         });
     }
     return height;
@@ -677,17 +1273,158 @@ enum {
     ml_measure       = ml_draw|DT_CALCRECT
 };
 
-static ui_point_t gdi_text_measure(gdi_dtp_t* p) {
-    gdi_text_draw(p);
-    ui_point_t cell = {p->rc.right - p->rc.left, p->rc.bottom - p->rc.top};
-    return cell;
+// LRU cache of measured text keyed by (font, w, flags, text hash, bytes).
+// Entries are 1-based indices; 0 terminates bucket chains and LRU list.
+
+enum { gdi_measure_capacity = 512 }; // power of 2
+
+typedef struct gdi_measure_entry_s {
+    uint64_t hash;
+    ui_font_t font;
+    int32_t w;
+    uint32_t flags;
+    int32_t bytes;
+    ui_point_t size;
+    int32_t prev;  // more recently used
+    int32_t next;  // less recently used
+    int32_t chain; // next entry in the same bucket
+} gdi_measure_entry_t;
+
+static struct {
+    gdi_measure_entry_t entries[gdi_measure_capacity + 1];
+    int32_t buckets[gdi_measure_capacity * 2];
+    int32_t head; // most recently used
+    int32_t tail; // least recently used
+    int32_t count;
+    SRWLOCK lock;
+} gdi_measure = { .lock = SRWLOCK_INIT };
+
+static uint64_t gdi_measure_hash(const char* s, int32_t n) { // FNV-1a
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int32_t i = 0; i < n; i++) {
+        h = (h ^ (uint8_t)s[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static int32_t* gdi_measure_bucket(uint64_t hash, ui_font_t f, int32_t w,
+        uint32_t flags) {
+    uint64_t h = hash ^ (uint64_t)(uintptr_t)f ^ ((uint64_t)w << 32) ^ flags;
+    h = (h ^ (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+    return &gdi_measure.buckets[(h >> 32) % countof(gdi_measure.buckets)];
+}
+
+static void gdi_measure_unlink(int32_t i) {
+    gdi_measure_entry_t* e = &gdi_measure.entries[i];
+    if (e->prev != 0) {
+        gdi_measure.entries[e->prev].next = e->next;
+    } else {
+        gdi_measure.head = e->next;
+    }
+    if (e->next != 0) {
+        gdi_measure.entries[e->next].prev = e->prev;
+    } else {
+        gdi_measure.tail = e->prev;
+    }
+    e->prev = 0;
+    e->next = 0;
+}
+
+static void gdi_measure_link(int32_t i) { // as most recently used
+    gdi_measure_entry_t* e = &gdi_measure.entries[i];
+    e->prev = 0;
+    e->next = gdi_measure.head;
+    if (gdi_measure.head != 0) { gdi_measure.entries[gdi_measure.head].prev = i; }
+    gdi_measure.head = i;
+    if (gdi_measure.tail == 0) { gdi_measure.tail = i; }
+}
+
+static int32_t gdi_measure_evict(void) { // returns freed entry index
+    const int32_t i = gdi_measure.tail;
+    assert(i != 0);
+    gdi_measure_entry_t* e = &gdi_measure.entries[i];
+    int32_t* c = gdi_measure_bucket(e->hash, e->font, e->w, e->flags);
+    while (*c != i) { c = &gdi_measure.entries[*c].chain; }
+    *c = e->chain;
+    gdi_measure_unlink(i);
+    gdi.measure_stats.evictions++;
+    return i;
+}
+
+static void gdi_measure_invalidate(void) {
+    AcquireSRWLockExclusive(&gdi_measure.lock);
+    memset(gdi_measure.buckets, 0, sizeof(gdi_measure.buckets));
+    gdi_measure.head = 0;
+    gdi_measure.tail = 0;
+    gdi_measure.count = 0;
+    ReleaseSRWLockExclusive(&gdi_measure.lock);
+}
+
+static ui_point_t gdi_measure_cached(ui_font_t f, int32_t w, uint32_t flags,
+        const char* text, int32_t k) {
+    const uint64_t hash = gdi_measure_hash(text, k);
+    AcquireSRWLockExclusive(&gdi_measure.lock);
+    int32_t* bucket = gdi_measure_bucket(hash, f, w, flags);
+    int32_t i = *bucket;
+    while (i != 0) {
+        const gdi_measure_entry_t* e = &gdi_measure.entries[i];
+        if (e->hash == hash && e->font == f && e->w == w &&
+            e->flags == flags && e->bytes == k) {
+            break;
+        }
+        i = e->chain;
+    }
+    ui_point_t size;
+    if (i != 0) {
+        gdi.measure_stats.hits++;
+        gdi_measure_unlink(i);
+        gdi_measure_link(i);
+        size = gdi_measure.entries[i].size;
+        ReleaseSRWLockExclusive(&gdi_measure.lock);
+    } else {
+        gdi.measure_stats.misses++;
+        ReleaseSRWLockExclusive(&gdi_measure.lock);
+        RECT rc = { 0, 0, w <= 0 ? 1 : w, 0 };
+        gdi_draw_utf16(f, text, k, &rc, flags);
+        size = (ui_point_t){ rc.right - rc.left, rc.bottom - rc.top };
+        AcquireSRWLockExclusive(&gdi_measure.lock);
+        if (gdi_measure.count < gdi_measure_capacity) {
+            i = ++gdi_measure.count;
+        } else {
+            i = gdi_measure_evict();
+        }
+        gdi_measure_entry_t* e = &gdi_measure.entries[i];
+        *e = (gdi_measure_entry_t){ .hash = hash, .font = f, .w = w,
+            .flags = flags, .bytes = k, .size = size };
+        bucket = gdi_measure_bucket(hash, f, w, flags);
+        e->chain = *bucket;
+        *bucket = i;
+        gdi_measure_link(i);
+        ReleaseSRWLockExclusive(&gdi_measure.lock);
+    }
+    return size;
+}
+
+static ui_point_t gdi_measure_vtext(ui_font_t f, int32_t w, uint32_t flags,
+        const char* format, va_list vl) {
+    not_null(f);
+    int32_t n = 1024;
+    char* text = (char*)alloca(n);
+    str.vformat(text, n - 1, format, vl);
+    int32_t k = (int32_t)strlen(text);
+    while (k >= n - 1 || k < 0) {
+        n = n * 2;
+        text = (char*)alloca(n);
+        str.vformat(text, n - 1, format, vl);
+        k = (int32_t)strlen(text);
+    }
+    return gdi_measure_cached(f, w, flags, text, k);
 }
 
 static ui_point_t gdi_measure_singleline(ui_font_t f, const char* format, ...) {
     va_list vl;
     va_start(vl, format);
-    gdi_dtp_t p = { f, format, vl, {0, 0, 0, 0}, sl_measure };
-    ui_point_t cell = gdi_text_measure(&p);
+    ui_point_t cell = gdi_measure_vtext(f, 0, sl_measure, format, vl);
     va_end(vl);
     return cell;
 }
@@ -696,22 +1433,85 @@ static ui_point_t gdi_measure_multiline(ui_font_t f, int32_t w, const char* form
     va_list vl;
     va_start(vl, format);
     uint32_t flags = w <= 0 ? ml_measure : ml_measure_break;
-    gdi_dtp_t p = { f, format, vl, {gdi.x, gdi.y, gdi.x + (w <= 0 ? 1 : w), gdi.y}, flags };
-    ui_point_t cell = gdi_text_measure(&p);
+    ui_point_t cell = gdi_measure_vtext(f, w <= 0 ? -1 : w, flags, format, vl);
     va_end(vl);
     return cell;
 }
 
+static ui_point_t gdi_measure_text_n(ui_font_t f, const char* s, int32_t n) {
+    not_null(f);
+    assert(n >= 0);
+    return gdi_measure_cached(f, 0, sl_measure, s, n);
+}
+
+static int32_t gdi_measure_offsets(ui_font_t f, const char* s, int32_t n,
+        int32_t* x, int32_t count) {
+    not_null(f);
+    assert(n >= 0 && count >= 0);
+    x[0] = 0;
+    if (n == 0) { return 0; }
+    // UTF-16 never needs more code units than UTF-8 bytes:
+    void* memory = malloc((size_t)n * (sizeof(wchar_t) + sizeof(INT)));
+    fatal_if_null(memory);
+    INT* dx = (INT*)memory;
+    wchar_t* utf16 = (wchar_t*)(dx + n);
+    const int32_t units = MultiByteToWideChar(CP_UTF8, 0, s, n, utf16, n);
+    fatal_if(units <= 0);
+    SIZE size = {0};
+    gdi_hdc_with_font(f, {
+        fatal_if_false(GetTextExtentExPointW(hdc, utf16, units, 0, null,
+            dx, &size));
+    });
+    int32_t k = 0; // code points
+    for (int32_t i = 0; i < units; i++) {
+        const bool high = 0xD800 <= utf16[i] && utf16[i] <= 0xDBFF;
+        if (!high || i == units - 1) { // surrogate pair is one code point
+            k++;
+            if (k <= count) { x[k] = dx[i]; }
+        }
+    }
+    free(memory);
+    return k;
+}
+
+// text_n() and textln_n() take the extent of the text from measurement
+// cache and call DrawTextW() once (vtext() calls it twice, see above)
+
+static ui_point_t gdi_draw_text_n(const char* s, int32_t n) {
+    assert(n >= 0);
+    not_null(gdi_canvas());
+    const gdi_state_t* st = &gdi_context()->state;
+    ui_font_t f = gdi_state_known() && st->font != null ?
+        st->font : (ui_font_t)GetCurrentObject(gdi_canvas(), OBJ_FONT);
+    ui_point_t size = gdi_measure_cached(f, 0, sl_measure, s, n);
+    gdi_xy_t xy = gdi_xy();
+    RECT rc = { *xy.x, *xy.y, *xy.x + size.x, *xy.y + size.y };
+    gdi_draw_utf16(null, s, n, &rc, sl_draw);
+    return size;
+}
+
+static void gdi_text_n(const char* s, int32_t n) {
+    const int32_t w = gdi_draw_text_n(s, n).x;
+    *gdi_xy().x += w;
+}
+
+static void gdi_textln_n(const char* s, int32_t n) {
+    ui_point_t size = gdi_draw_text_n(s, n);
+    *gdi_xy().y += (int)(size.y * gdi.height_multiplier + 0.5f);
+}
+
 static void gdi_vtext(const char* format, va_list vl) {
-    gdi_dtp_t p = { null, format, vl, {gdi.x, gdi.y, 0, 0}, sl_draw };
+    gdi_xy_t xy = gdi_xy();
+    gdi_dtp_t p = { null, format, vl, {*xy.x, *xy.y, 0, 0}, sl_draw };
     gdi_text_draw(&p);
-    gdi.x += p.rc.right - p.rc.left;
+    *xy.x += p.rc.right - p.rc.left;
 }
 
 static void gdi_vtextln(const char* format, va_list vl) {
-    gdi_dtp_t p = { null, format, vl, {gdi.x, gdi.y, gdi.x, gdi.y}, sl_draw };
+    gdi_xy_t xy = gdi_xy();
+    gdi_dtp_t p = { null, format, vl, {*xy.x, *xy.y, *xy.x, *xy.y}, sl_draw };
     gdi_text_draw(&p);
-    gdi.y += (int)((p.rc.bottom - p.rc.top) * gdi.height_multiplier + 0.5f);
+    *xy.y += (int)((p.rc.bottom - p.rc.top) * gdi.height_multiplier + 0.5f);
 }
 
 static void gdi_text(const char* format, ...) {
@@ -732,7 +1532,9 @@ static ui_point_t gdi_multiline(int32_t w, const char* f, ...) {
     va_list vl;
     va_start(vl, f);
     uint32_t flags = w <= 0 ? ml_draw : ml_draw_break;
-    gdi_dtp_t p = { null, f, vl, {gdi.x, gdi.y, gdi.x + (w <= 0 ? 1 : w), gdi.y}, flags };
+    gdi_xy_t xy = gdi_xy();
+    gdi_dtp_t p = { null, f, vl, {*xy.x, *xy.y, *xy.x + (w <= 0 ? 1 : w), *xy.y},
+                    flags };
     gdi_text_draw(&p);
     va_end(vl);
     ui_point_t c = { p.rc.right - p.rc.left, p.rc.bottom - p.rc.top };
@@ -795,15 +1597,25 @@ static uint8_t* gdi_load_image(const void* data, int32_t bytes, int* w, int* h,
 }
 
 static void gdi_image_dispose(image_t* image) {
+    gdi_scaled_invalidate(image);
     fatal_if_false(DeleteBitmap(image->bitmap));
     memset(image, 0, sizeof(image_t));
 }
 
 gdi_t gdi = {
     .height_multiplier = 1.0,
+    .image_mipmap = gdi_mipmap_box,
+    .begin = gdi_begin,
+    .end = gdi_end,
+    .current = gdi_current,
+    .position = gdi_xy,
     .image_init = gdi_image_init,
     .image_init_rgbx = gdi_image_init_rgbx,
+    .image_update = gdi_image_update,
+    .image_acquire = gdi_image_acquire,
+    .image_release = gdi_image_release,
     .image_dispose = gdi_image_dispose,
+    .image_invalidate = gdi_scaled_invalidate,
     .alpha_blend = gdi_alpha_blend,
     .draw_image = gdi_draw_image,
     .set_text_color = gdi_set_text_color,
@@ -816,6 +1628,8 @@ gdi_t gdi = {
     .set_pen = gdi_set_pen,
     .delete_pen = gdi_delete_pen,
     .set_clip = gdi_set_clip,
+    .intersect_clip = gdi_intersect_clip,
+    .visible = gdi_visible,
     .push = gdi_push,
     .pop = gdi_pop,
     .pixel = gdi_pixel,
@@ -828,6 +1642,7 @@ gdi_t gdi = {
     .rect_with = gdi_rect_with,
     .fill_with = gdi_fill_with,
     .poly = gdi_poly,
+    .polygon = gdi_polygon,
     .rounded = gdi_rounded,
     .gradient = gdi_gradient,
     .draw_greyscale = gdi_draw_greyscale,
@@ -846,10 +1661,15 @@ gdi_t gdi = {
     .line_spacing = gdi_line_spacing,
     .measure_text = gdi_measure_singleline,
     .measure_multiline = gdi_measure_multiline,
+    .measure_invalidate = gdi_measure_invalidate,
+    .measure_text_n = gdi_measure_text_n,
+    .measure_offsets = gdi_measure_offsets,
     .vtext = gdi_vtext,
     .vtextln = gdi_vtextln,
     .text = gdi_text,
     .textln = gdi_textln,
+    .text_n = gdi_text_n,
+    .textln_n = gdi_textln_n,
     .vprint = gdi_vprint,
     .vprintln = gdi_vprintln,
     .print = gdi_print,
@@ -0,0 +1,370 @@
+// GIF89a: https://www.w3.org/Graphics/GIF/spec-gif89a.txt
+
+typedef struct gif_slot_s {
+    gif_frame_t frame;
+    uint32_t* pixels; // [h][w]
+} gif_slot_t;
+
+typedef struct gif_stream_s {
+    const uint8_t* data;
+    int64_t bytes;
+    int32_t w;
+    int32_t h;
+    int64_t first; // offset of the first block after global color table
+    int64_t pos;   // offset of the next block to decode
+    int32_t index; // of the next frame
+    uint32_t global[256]; // color table BGRA
+    int32_t colors; // in global color table
+    uint32_t* canvas; // [h][w] composed frames
+    uint32_t* saved;  // [h][w] restore to previous, allocated on demand
+    int32_t dispose;  // of the last decoded frame
+    ui_rect_t rect;   // of the last decoded frame clipped to canvas
+    // LZW:
+    uint16_t prefix[4096];
+    uint8_t  suffix[4096];
+    uint8_t  stack[4097];
+    // ring [head..head + count) decoded, `held` by consumer or -1:
+    gif_slot_t ring[gif_ring];
+    int32_t head;
+    int32_t count;
+    int32_t held;
+    SRWLOCK lock;
+    CONDITION_VARIABLE changed;
+    bool quit;
+    thread_t thread;
+} gif_stream_t;
+
+static int32_t gif_u16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+// gif_skip() sub-blocks starting at pos, returns position after terminator
+
+static int64_t gif_skip(const gif_stream_t* s, int64_t pos) {
+    while (pos < s->bytes) {
+        const int32_t n = s->data[pos++];
+        if (n == 0) { return pos; }
+        pos += n;
+    }
+    return s->bytes;
+}
+
+static void gif_palette(uint32_t* palette, const uint8_t* p, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        palette[i] = 0xFF000000u | (uint32_t)p[i * 3 + 0] << 16 |
+                     (uint32_t)p[i * 3 + 1] << 8 | p[i * 3 + 2];
+    }
+}
+
+// gif_bits reads LZW codes from sub-blocks
+
+typedef struct gif_bits_s {
+    const gif_stream_t* s;
+    int64_t pos;
+    int32_t left; // bytes left in current sub-block
+    uint32_t bits;
+    int32_t count; // number of valid bits
+    bool end; // block terminator has been read
+} gif_bits_t;
+
+static int32_t gif_code(gif_bits_t* b, int32_t size) { // -1 end of data
+    while (b->count < size) {
+        if (b->left == 0) {
+            if (b->pos >= b->s->bytes) { return -1; }
+            b->left = b->s->data[b->pos++];
+            if (b->left == 0) { b->end = true; return -1; }
+        }
+        if (b->pos >= b->s->bytes) { return -1; }
+        b->bits |= (uint32_t)b->s->data[b->pos++] << b->count;
+        b->count += 8;
+        b->left--;
+    }
+    const int32_t code = (int32_t)(b->bits & ((1u << size) - 1));
+    b->bits >>= size;
+    b->count -= size;
+    return code;
+}
+
+// gif_image() decodes image data at s->pos into (fx, fy, fw, fh) of
+// canvas skipping transparent pixels, returns position after the data
+
+static int64_t gif_image(gif_stream_t* s, const uint32_t* palette,
+        int32_t fx, int32_t fy, int32_t fw, int32_t fh, bool interlaced,
+        int32_t transparent) {
+    static const int32_t start[4] = { 0, 4, 2, 1 };
+    static const int32_t step[4]  = { 8, 8, 4, 2 };
+    if (s->pos >= s->bytes) { return s->bytes; }
+    const int32_t min_size = s->data[s->pos];
+    if (min_size < 2 || min_size > 11) { return gif_skip(s, s->pos + 1); }
+    gif_bits_t b = { s, s->pos + 1, 0, 0, 0, false };
+    const int32_t clear = 1 << min_size;
+    int32_t size = min_size + 1;
+    int32_t next = clear + 2;
+    int32_t prev = -1;
+    uint8_t first = 0;
+    for (int32_t i = 0; i < clear; i++) { s->suffix[i] = (uint8_t)i; }
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t pass = 0;
+    const int64_t pixels = (int64_t)fw * fh;
+    int64_t n = 0;
+    while (n < pixels) {
+        const int32_t code = gif_code(&b, size);
+        if (code < 0 || code == clear + 1) { break; }
+        if (code == clear) {
+            size = min_size + 1;
+            next = clear + 2;
+            prev = -1;
+            continue;
+        }
+        int32_t sp = 0;
+        if (prev < 0) {
+            if (code >= clear) { break; } // corrupted
+            first = (uint8_t)code;
+            s->stack[sp++] = first;
+        } else {
+            if (code > next) { break; } // corrupted
+            int32_t c = code;
+            if (code == next) { s->stack[sp++] = first; c = prev; }
+            while (c >= clear) { s->stack[sp++] = s->suffix[c]; c = s->prefix[c]; }
+            first = s->suffix[c];
+            s->stack[sp++] = first;
+            if (next < 4096) {
+                s->prefix[next] = (uint16_t)prev;
+                s->suffix[next] = first;
+                next++;
+                if (next == (1 << size) && size < 12) { size++; }
+            }
+        }
+        prev = code;
+        while (sp > 0 && n < pixels) {
+            const int32_t ix = s->stack[--sp];
+            const int32_t cx = fx + x;
+            const int32_t cy = fy + y;
+            if (ix != transparent && 0 <= cx && cx < s->w && 0 <= cy && cy < s->h) {
+                s->canvas[(int64_t)cy * s->w + cx] = palette[ix];
+            }
+            n++;
+            if (++x == fw) {
+                x = 0;
+                if (interlaced) {
+                    y += step[pass];
+                    while (y >= fh && pass < 3) { pass++; y = start[pass]; }
+                } else {
+                    y++;
+                }
+            }
+        }
+    }
+    // rest of sub-blocks after end of information code (if any):
+    return b.end ? b.pos : gif_skip(s, b.pos + b.left);
+}
+
+static void gif_fill(gif_stream_t* s, const ui_rect_t* r, const uint32_t* from) {
+    for (int32_t y = r->y; y < r->y + r->h; y++) {
+        uint32_t* d = s->canvas + (int64_t)y * s->w + r->x;
+        if (from == null) {
+            memset(d, 0, r->w * sizeof(uint32_t));
+        } else {
+            memcpy(d, from + (int64_t)y * s->w + r->x, r->w * sizeof(uint32_t));
+        }
+    }
+}
+
+static void gif_restart(gif_stream_t* s) {
+    s->pos = s->first;
+    s->index = 0;
+    s->dispose = 0;
+    memset(s->canvas, 0, (size_t)s->w * s->h * sizeof(uint32_t));
+}
+
+// gif_decode() composes next frame on canvas and copies it to the slot
+
+static void gif_decode(gif_stream_t* s, gif_slot_t* slot) {
+    int32_t delay = 0;
+    int32_t transparent = -1;
+    int32_t dispose = 0;
+    bool decoded = false;
+    bool restarted = false;
+    while (!decoded) {
+        const int32_t block = s->pos < s->bytes ? s->data[s->pos++] : 0x3B;
+        if (block == 0x21 && s->pos < s->bytes) { // extension
+            const int32_t label = s->data[s->pos++];
+            const uint8_t* p = s->data + s->pos;
+            if (label == 0xF9 && s->pos + 5 <= s->bytes && p[0] >= 4) {
+                dispose = (p[1] >> 2) & 0x7;
+                delay = gif_u16(p + 2) * 10;
+                transparent = (p[1] & 0x1) ? p[4] : -1;
+            }
+            s->pos = gif_skip(s, s->pos);
+        } else if (block == 0x2C && s->pos + 9 <= s->bytes) { // image
+            const uint8_t* p = s->data + s->pos;
+            const int32_t fx = gif_u16(p + 0);
+            const int32_t fy = gif_u16(p + 2);
+            const int32_t fw = gif_u16(p + 4);
+            const int32_t fh = gif_u16(p + 6);
+            const int32_t flags = p[8];
+            s->pos += 9;
+            uint32_t local[256];
+            const uint32_t* palette = s->global;
+            if (flags & 0x80) {
+                const int32_t n = 2 << (flags & 0x7);
+                if (s->pos + n * 3 > s->bytes) { s->pos = s->bytes; continue; }
+                gif_palette(local, s->data + s->pos, n);
+                for (int32_t i = n; i < countof(local); i++) { local[i] = 0; }
+                s->pos += n * 3;
+                palette = local;
+            }
+            // truncated before image data: not counted by gif_count()
+            if (s->pos >= s->bytes) { continue; }
+            // previous frame disposal:
+            if (s->dispose == 2) {
+                gif_fill(s, &s->rect, null);
+            } else if (s->dispose == 3 && s->saved != null) {
+                gif_fill(s, &s->rect, s->saved);
+            }
+            const int32_t x0 = min(fx, s->w);
+            const int32_t y0 = min(fy, s->h);
+            s->rect = (ui_rect_t){ x0, y0, min(fx + fw, s->w) - x0,
+                                   min(fy + fh, s->h) - y0 };
+            s->dispose = dispose;
+            if (dispose == 3) { // keep canvas to restore after this frame
+                if (s->saved == null) {
+                    s->saved = (uint32_t*)malloc((size_t)s->w * s->h *
+                                                 sizeof(uint32_t));
+                    fatal_if_null(s->saved);
+                }
+                memcpy(s->saved, s->canvas, (size_t)s->w * s->h *
+                                            sizeof(uint32_t));
+            }
+            s->pos = gif_image(s, palette, fx, fy, fw, fh,
+                               (flags & 0x40) != 0, transparent);
+            decoded = true;
+        } else { // trailer, truncated or unknown block: loop animation
+            if (restarted) { break; } // corrupted: blank frame
+            gif_restart(s);
+            restarted = true;
+        }
+    }
+    memcpy(slot->pixels, s->canvas, (size_t)s->w * s->h * sizeof(uint32_t));
+    slot->frame.index = s->index;
+    slot->frame.delay = delay;
+    s->index++;
+}
+
+static void gif_worker(void* p) {
+    gif_stream_t* s = (gif_stream_t*)p;
+    threads.name("gif");
+    AcquireSRWLockExclusive(&s->lock);
+    for (;;) {
+        while (!s->quit && s->count + (s->held >= 0) >= gif_ring) {
+            SleepConditionVariableSRW(&s->changed, &s->lock, INFINITE, 0);
+        }
+        if (s->quit) { break; }
+        gif_slot_t* slot = &s->ring[(s->head + s->count) % gif_ring];
+        ReleaseSRWLockExclusive(&s->lock);
+        gif_decode(s, slot); // slot is not visible to consumer yet
+        AcquireSRWLockExclusive(&s->lock);
+        s->count++;
+        WakeAllConditionVariable(&s->changed);
+    }
+    ReleaseSRWLockExclusive(&s->lock);
+}
+
+// gif_count() frames, 0 if data is not GIF
+
+static int32_t gif_count(const gif_stream_t* s) {
+    int32_t frames = 0;
+    int64_t pos = s->first;
+    while (pos < s->bytes) {
+        const int32_t block = s->data[pos++];
+        if (block == 0x21 && pos < s->bytes) {
+            pos = gif_skip(s, pos + 1);
+        } else if (block == 0x2C && pos + 9 <= s->bytes) {
+            const int32_t flags = s->data[pos + 8];
+            pos += 9 + ((flags & 0x80) ? (2 << (flags & 0x7)) * 3 : 0);
+            if (pos >= s->bytes) { break; }
+            pos = gif_skip(s, pos + 1); // LZW minimum code size
+            frames++;
+        } else {
+            break; // trailer or garbage
+        }
+    }
+    return frames;
+}
+
+static errno_t gif_open(gif_t* g, const uint8_t* data, int64_t bytes) {
+    memset(g, 0, sizeof(*g));
+    if (bytes < 13 || memcmp(data, "GIF8", 4) != 0) { return EINVAL; }
+    const int32_t w = gif_u16(data + 6);
+    const int32_t h = gif_u16(data + 8);
+    const int32_t flags = data[10];
+    const int32_t colors = (flags & 0x80) ? 2 << (flags & 0x7) : 0;
+    if (w == 0 || h == 0 || 13 + colors * 3 > bytes) { return EINVAL; }
+    gif_stream_t* s = (gif_stream_t*)calloc(1, sizeof(gif_stream_t));
+    fatal_if_null(s);
+    s->data = data;
+    s->bytes = bytes;
+    s->w = w;
+    s->h = h;
+    s->colors = colors;
+    gif_palette(s->global, data + 13, colors);
+    s->first = 13 + colors * 3;
+    const int32_t frames = gif_count(s);
+    if (frames == 0) { free(s); return EINVAL; }
+    const size_t frame_bytes = (size_t)w * h * sizeof(uint32_t);
+    s->canvas = (uint32_t*)malloc(frame_bytes);
+    fatal_if_null(s->canvas);
+    for (int32_t i = 0; i < gif_ring; i++) {
+        s->ring[i].pixels = (uint32_t*)malloc(frame_bytes);
+        fatal_if_null(s->ring[i].pixels);
+        s->ring[i].frame.pixels = s->ring[i].pixels;
+    }
+    gif_restart(s);
+    s->held = -1;
+    InitializeSRWLock(&s->lock);
+    InitializeConditionVariable(&s->changed);
+    g->w = w;
+    g->h = h;
+    g->frames = frames;
+    g->stream = s;
+    s->thread = threads.start(gif_worker, s);
+    return 0;
+}
+
+static const gif_frame_t* gif_next(gif_t* g) {
+    gif_stream_t* s = g->stream;
+    not_null(s);
+    AcquireSRWLockExclusive(&s->lock);
+    s->held = -1; // previous frame buffer can be reused
+    WakeAllConditionVariable(&s->changed);
+    while (s->count == 0) {
+        SleepConditionVariableSRW(&s->changed, &s->lock, INFINITE, 0);
+    }
+    s->held = s->head;
+    s->head = (s->head + 1) % gif_ring;
+    s->count--;
+    const gif_frame_t* f = &s->ring[s->held].frame;
+    ReleaseSRWLockExclusive(&s->lock);
+    return f;
+}
+
+static void gif_close(gif_t* g) {
+    gif_stream_t* s = g->stream;
+    if (s != null) {
+        AcquireSRWLockExclusive(&s->lock);
+        s->quit = true;
+        WakeAllConditionVariable(&s->changed);
+        ReleaseSRWLockExclusive(&s->lock);
+        threads.join(s->thread, -1);
+        for (int32_t i = 0; i < gif_ring; i++) { free(s->ring[i].pixels); }
+        free(s->saved);
+        free(s->canvas);
+        free(s);
+    }
+    memset(g, 0, sizeof(*g));
+}
+
+gif_if gif = {
+    .open  = gif_open,
+    .next  = gif_next,
+    .close = gif_close
+};
@@ -0,0 +1,341 @@
+#pragma warning(push)
+#pragma warning(disable: 4100) // unreferenced formal parameter
+#pragma warning(disable: 4244) // conversion, possible loss of data
+#pragma warning(disable: 4459) // declaration of '...' hides global declaration
+#pragma warning(disable: 4505) // unreferenced function with internal linkage
+#pragma warning(disable: 4701) // potentially uninitialized local variable
+#define STBTT_assert(x) assert(x)
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb/stb_truetype.h"
+#pragma warning(pop)
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define glyphs_sse2
+#endif
+
+enum {
+    glyphs_phases = 4, // horizontal subpixel positions
+    glyphs_atlas_w = 1024,
+    glyphs_atlas_h = 1024,
+    glyphs_capacity = 4096 // power of 2, at most half full
+};
+
+typedef struct glyphs_glyph_s {
+    uint32_t key; // (codepoint * glyphs_phases + phase) + 1, 0 empty slot
+    float advance; // in pixels
+    int16_t x; // atlas position
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    int16_t dx; // offset of the mask from pen position on the baseline
+    int16_t dy;
+} glyphs_glyph_t;
+
+typedef struct glyphs_font_s {
+    stbtt_fontinfo info;
+    float scale;
+    int32_t ascent; // pixels
+    int32_t height; // line height in pixels
+    uint8_t* atlas; // [glyphs_atlas_h][glyphs_atlas_w] coverage
+    int32_t ax; // shelf packer: next free position on current shelf
+    int32_t ay;
+    int32_t shelf; // height of current shelf
+    glyphs_glyph_t table[glyphs_capacity];
+    int32_t count;
+    glyphs_stats_t stats;
+    SRWLOCK lock; // shared: lookup and blit, exclusive: rasterize
+} glyphs_font_t;
+
+static glyphs_font_t* glyphs_create(const void* ttf, int64_t bytes,
+        int32_t height) {
+    assert(height > 0 && bytes > 0);
+    glyphs_font_t* f = (glyphs_font_t*)calloc(1, sizeof(glyphs_font_t));
+    fatal_if_null(f);
+    const uint8_t* data = (const uint8_t*)ttf;
+    const int offset = stbtt_GetFontOffsetForIndex(data, 0);
+    fatal_if(offset < 0 || !stbtt_InitFont(&f->info, data, offset),
+             "not a TrueType font");
+    f->scale = stbtt_ScaleForPixelHeight(&f->info, (float)height);
+    int ascent = 0;
+    int descent = 0;
+    int gap = 0;
+    stbtt_GetFontVMetrics(&f->info, &ascent, &descent, &gap);
+    f->ascent = (int32_t)ceilf(ascent * f->scale);
+    f->height = (int32_t)ceilf((ascent - descent + gap) * f->scale);
+    f->atlas = (uint8_t*)malloc(glyphs_atlas_w * glyphs_atlas_h);
+    fatal_if_null(f->atlas);
+    InitializeSRWLock(&f->lock);
+    return f;
+}
+
+static void glyphs_dispose(glyphs_font_t* f) {
+    free(f->atlas);
+    free(f);
+}
+
+static int32_t glyphs_height(glyphs_font_t* f) { return f->height; }
+
+static int32_t glyphs_baseline(glyphs_font_t* f) { return f->ascent; }
+
+static glyphs_stats_t glyphs_font_stats(glyphs_font_t* f) {
+    AcquireSRWLockExclusive(&f->lock);
+    glyphs_stats_t stats = f->stats;
+    ReleaseSRWLockExclusive(&f->lock);
+    return stats;
+}
+
+static uint32_t glyphs_utf8(const char* s, int32_t n, int32_t* bytes) {
+    const uint8_t* u = (const uint8_t*)s;
+    int32_t k = (u[0] & 0x80) == 0x00 ? 1 :
+                (u[0] & 0xE0) == 0xC0 ? 2 :
+                (u[0] & 0xF0) == 0xE0 ? 3 :
+                (u[0] & 0xF8) == 0xF0 ? 4 : 0;
+    if (k == 0 || k > n) { *bytes = 1; return 0xFFFD; } // replacement
+    uint32_t c = k == 1 ? u[0] : u[0] & (0x7F >> k);
+    for (int32_t i = 1; i < k; i++) {
+        if ((u[i] & 0xC0) != 0x80) { *bytes = i; return 0xFFFD; }
+        c = (c << 6) | (u[i] & 0x3F);
+    }
+    *bytes = k;
+    return c;
+}
+
+static inline uint32_t glyphs_div255(uint32_t v) { // exact for [0..255*255]
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+static inline uint32_t glyphs_mix(uint32_t d, uint32_t c, uint32_t m) {
+    const uint32_t im = 255 - m;
+    return glyphs_div255(((c >>  0) & 0xFF) * m + ((d >>  0) & 0xFF) * im) <<  0 |
+           glyphs_div255(((c >>  8) & 0xFF) * m + ((d >>  8) & 0xFF) * im) <<  8 |
+           glyphs_div255(((c >> 16) & 0xFF) * m + ((d >> 16) & 0xFF) * im) << 16 |
+           glyphs_div255(((c >> 24) & 0xFF) * m + ((d >> 24) & 0xFF) * im) << 24;
+}
+
+#ifdef glyphs_sse2
+
+static inline __m128i glyphs_mix_epi16(__m128i d, __m128i c, __m128i m) {
+    const __m128i im = _mm_sub_epi16(_mm_set1_epi16(255), m);
+    __m128i v = _mm_add_epi16(_mm_mullo_epi16(c, m), _mm_mullo_epi16(d, im));
+    v = _mm_add_epi16(v, _mm_set1_epi16(128)); // v <= 255 * 255 + 128
+    return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+#endif
+
+static void glyphs_blend_mask(uint32_t* d, const uint8_t* m, int32_t n,
+        uint32_t c) {
+    int32_t i = 0;
+    #ifdef glyphs_sse2
+        const __m128i z = _mm_setzero_si128();
+        const __m128i c16 = _mm_unpacklo_epi8(_mm_set1_epi32((int32_t)c), z);
+        for (; i + 4 <= n; i += 4) {
+            int32_t m4;
+            memcpy(&m4, m + i, sizeof(m4));
+            if (m4 == 0) { continue; } // most of glyph box is empty
+            // m0 m0 m0 m0 m1 m1 m1 m1 and m2 m2 m2 m2 m3 m3 m3 m3:
+            __m128i mm = _mm_unpacklo_epi8(_mm_cvtsi32_si128(m4), z);
+            mm = _mm_unpacklo_epi16(mm, mm);
+            const __m128i mlo = _mm_unpacklo_epi32(mm, mm);
+            const __m128i mhi = _mm_unpackhi_epi32(mm, mm);
+            const __m128i dp = _mm_loadu_si128((const __m128i*)(d + i));
+            const __m128i lo = glyphs_mix_epi16(_mm_unpacklo_epi8(dp, z), c16, mlo);
+            const __m128i hi = glyphs_mix_epi16(_mm_unpackhi_epi8(dp, z), c16, mhi);
+            _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+        }
+    #endif
+    for (; i < n; i++) {
+        if (m[i] == 0xFF) {
+            d[i] = c;
+        } else if (m[i] != 0) {
+            d[i] = glyphs_mix(d[i], c, m[i]);
+        }
+    }
+}
+
+static glyphs_glyph_t* glyphs_find(glyphs_font_t* f, uint32_t key) {
+    uint32_t i = (key * 2654435761u) & (glyphs_capacity - 1);
+    while (f->table[i].key != 0) {
+        if (f->table[i].key == key) { return &f->table[i]; }
+        i = (i + 1) & (glyphs_capacity - 1);
+    }
+    return null;
+}
+
+static void glyphs_reset(glyphs_font_t* f) {
+    memset(f->table, 0, sizeof(f->table));
+    f->count = 0;
+    f->ax = 0;
+    f->ay = 0;
+    f->shelf = 0;
+    f->stats.resets++;
+}
+
+// glyphs_pack() allocates w x h rectangle in the atlas, false if full
+
+static bool glyphs_pack(glyphs_font_t* f, int32_t w, int32_t h,
+        int32_t* x, int32_t* y) {
+    if (f->ax + w > glyphs_atlas_w) { // next shelf
+        f->ay += f->shelf + 1;
+        f->ax = 0;
+        f->shelf = 0;
+    }
+    if (f->ay + h > glyphs_atlas_h) { return false; }
+    *x = f->ax;
+    *y = f->ay;
+    f->ax += w + 1;
+    f->shelf = max(f->shelf, h);
+    return true;
+}
+
+static glyphs_glyph_t* glyphs_add(glyphs_font_t* f, uint32_t codepoint,
+        int32_t phase, uint32_t key) {
+    const int32_t index = stbtt_FindGlyphIndex(&f->info, (int)codepoint);
+    const float shift = (float)phase / glyphs_phases;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    stbtt_GetGlyphBitmapBoxSubpixel(&f->info, index, f->scale, f->scale,
+        shift, 0, &x0, &y0, &x1, &y1);
+    int32_t w = x1 - x0;
+    int32_t h = y1 - y0;
+    if (w > glyphs_atlas_w || h > glyphs_atlas_h) { w = 0; h = 0; } // huge
+    int32_t x = 0;
+    int32_t y = 0;
+    if (f->count >= glyphs_capacity / 2 || !glyphs_pack(f, w, h, &x, &y)) {
+        glyphs_reset(f);
+        fatal_if_false(glyphs_pack(f, w, h, &x, &y));
+    }
+    if (w > 0 && h > 0) {
+        stbtt_MakeGlyphBitmapSubpixel(&f->info,
+            f->atlas + (int64_t)y * glyphs_atlas_w + x, w, h, glyphs_atlas_w,
+            f->scale, f->scale, shift, 0, index);
+    }
+    int advance = 0;
+    int bearing = 0;
+    stbtt_GetGlyphHMetrics(&f->info, index, &advance, &bearing);
+    uint32_t i = (key * 2654435761u) & (glyphs_capacity - 1);
+    while (f->table[i].key != 0) { i = (i + 1) & (glyphs_capacity - 1); }
+    glyphs_glyph_t* g = &f->table[i];
+    g->key = key;
+    g->advance = advance * f->scale;
+    g->x = (int16_t)x;
+    g->y = (int16_t)y;
+    g->w = (int16_t)w;
+    g->h = (int16_t)h;
+    g->dx = (int16_t)x0;
+    g->dy = (int16_t)y0;
+    f->count++;
+    f->stats.misses++;
+    return g;
+}
+
+static void glyphs_blit(glyphs_font_t* f, const glyphs_glyph_t* g,
+        image_t* image, const ui_rect_t* clip, int32_t x, int32_t y,
+        uint32_t c) {
+    const int32_t x0 = max(x, clip->x);
+    const int32_t y0 = max(y, clip->y);
+    const int32_t x1 = min(x + g->w, clip->x + clip->w);
+    const int32_t y1 = min(y + g->h, clip->y + clip->h);
+    for (int32_t j = y0; j < y1 && x0 < x1; j++) {
+        uint32_t* d = (uint32_t*)((uint8_t*)image->pixels +
+            (int64_t)j * image->stride) + x0;
+        const uint8_t* m = f->atlas +
+            (int64_t)(g->y + j - y) * glyphs_atlas_w + g->x + x0 - x;
+        glyphs_blend_mask(d, m, x1 - x0, c);
+    }
+}
+
+// glyphs_text() measures when image == null
+
+static ui_point_t glyphs_text(glyphs_font_t* f, image_t* image,
+        const ui_rect_t* clip, int32_t x, int32_t y, const char* s, int32_t n,
+        ui_color_t color) {
+    ui_rect_t bounds = {0};
+    uint32_t c = 0;
+    if (image != null) {
+        fatal_if(image->bpp != 4 || image->pixels == null, "bpp: %d",
+                 image->bpp);
+        if (color_is_hdr(color)) { color = color_hdr_to_rgb(color); }
+        assert(color_is_8bit(color));
+        bounds = (ui_rect_t){0, 0, image->w, image->h};
+        if (clip != null) {
+            const int32_t x0 = max(clip->x, 0);
+            const int32_t y0 = max(clip->y, 0);
+            bounds.w = min(clip->x + clip->w, image->w) - x0;
+            bounds.h = min(clip->y + clip->h, image->h) - y0;
+            bounds.x = x0;
+            bounds.y = y0;
+        }
+        c = 0xFF000000u | (((uint32_t)color & 0xFF) << 16) |
+            ((uint32_t)color & 0xFF00) | (((uint32_t)color >> 16) & 0xFF);
+    }
+    float pen = (float)x;
+    float width = 0;
+    int32_t baseline = y + f->ascent;
+    int32_t lines = n > 0 ? 1 : 0;
+    AcquireSRWLockShared(&f->lock);
+    int32_t i = 0;
+    while (i < n) {
+        int32_t k = 0;
+        const uint32_t codepoint = glyphs_utf8(s + i, n - i, &k);
+        i += k;
+        if (codepoint == '\n') {
+            width = max(width, pen - x);
+            pen = (float)x;
+            baseline += f->height;
+            lines++;
+            continue;
+        }
+        const float ix = floorf(pen);
+        const int32_t phase = (int32_t)((pen - ix) * glyphs_phases);
+        const uint32_t key = codepoint * glyphs_phases + phase + 1;
+        glyphs_glyph_t* g = glyphs_find(f, key);
+        if (g != null) {
+            InterlockedIncrement64(&f->stats.hits);
+            if (image != null) {
+                glyphs_blit(f, g, image, &bounds,
+                    (int32_t)ix + g->dx, baseline + g->dy, c);
+            }
+            pen += g->advance;
+        } else { // rasterize under exclusive lock
+            ReleaseSRWLockShared(&f->lock);
+            AcquireSRWLockExclusive(&f->lock);
+            g = glyphs_find(f, key);
+            if (g == null) { g = glyphs_add(f, codepoint, phase, key); }
+            if (image != null) {
+                glyphs_blit(f, g, image, &bounds,
+                    (int32_t)ix + g->dx, baseline + g->dy, c);
+            }
+            pen += g->advance;
+            ReleaseSRWLockExclusive(&f->lock);
+            AcquireSRWLockShared(&f->lock);
+        }
+    }
+    ReleaseSRWLockShared(&f->lock);
+    width = max(width, pen - x);
+    return (ui_point_t){ (int32_t)ceilf(width), lines * f->height };
+}
+
+static ui_point_t glyphs_measure(glyphs_font_t* f, const char* s, int32_t n) {
+    return glyphs_text(f, null, null, 0, 0, s, n, 0);
+}
+
+static ui_point_t glyphs_draw(glyphs_font_t* f, image_t* image,
+        const ui_rect_t* clip, int32_t x, int32_t y, const char* s, int32_t n,
+        ui_color_t c) {
+    not_null(image);
+    return glyphs_text(f, image, clip, x, y, s, n, c);
+}
+
+glyphs_if glyphs = {
+    .create     = glyphs_create,
+    .dispose    = glyphs_dispose,
+    .height     = glyphs_height,
+    .baseline   = glyphs_baseline,
+    .measure    = glyphs_measure,
+    .draw       = glyphs_draw,
+    .blend_mask = glyphs_blend_mask,
+    .stats      = glyphs_font_stats
+};
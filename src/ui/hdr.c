@@ -0,0 +1,327 @@
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define hdr_sse2
+#endif
+
+// 8x8 Bayer matrix thresholds [0..255] added to 8.8 fixed point values
+// before truncating to 8 bit:
+
+static const uint8_t hdr_bayer[8][8] = {
+    {   2, 130,  34, 162,  10, 138,  42, 170 },
+    { 194,  66, 226,  98, 202,  74, 234, 106 },
+    {  50, 178,  18, 146,  58, 186,  26, 154 },
+    { 242, 114, 210,  82, 250, 122, 218,  90 },
+    {  14, 142,  46, 174,   6, 134,  38, 166 },
+    { 206,  78, 238, 110, 198,  70, 230, 102 },
+    {  62, 190,  30, 158,  54, 182,  22, 150 },
+    { 254, 126, 222,  94, 246, 118, 214,  86 }
+};
+
+static inline uint32_t hdr_div65535(uint32_t v) { // exact for [0..65535^2]
+    v += 32768;
+    return (v + (v >> 16)) >> 16;
+}
+
+static inline uint32_t hdr_channel(uint64_t p, int32_t i) {
+    return (uint32_t)(p >> (i * 16)) & 0xFFFF;
+}
+
+static void hdr_init(image_t* image, int32_t w, int32_t h) {
+    fatal_if(w <= 0 || h <= 0, "w: %d h: %d", w, h);
+    memset(image, 0, sizeof(*image));
+    image->pixels = calloc((size_t)w * h, sizeof(uint64_t));
+    fatal_if_null(image->pixels);
+    image->w = w;
+    image->h = h;
+    image->bpp = 8;
+    image->stride = w * 8;
+}
+
+static void hdr_dispose(image_t* image) {
+    assert(image->bpp == 8 && image->bitmap == null);
+    free(image->pixels);
+    memset(image, 0, sizeof(*image));
+}
+
+static uint64_t hdr_pixel(ui_color_t c) {
+    uint32_t r, g, b, a;
+    if (color_is_hdr(c)) {
+        r = (uint32_t)color_hdr_r(c);
+        g = (uint32_t)color_hdr_g(c);
+        b = (uint32_t)color_hdr_b(c);
+        a = (uint32_t)color_hdr_a(c);
+        a |= a >> 14; // 0x3FFF << 2 -> 0xFFFF
+        r = hdr_div65535(r * a);
+        g = hdr_div65535(g * a);
+        b = hdr_div65535(b * a);
+    } else {
+        assert(color_is_8bit(c));
+        r = (uint32_t)(c & 0xFF) * 257;
+        g = (uint32_t)((c >> 8) & 0xFF) * 257;
+        b = (uint32_t)((c >> 16) & 0xFF) * 257;
+        a = 0xFFFF;
+    }
+    return (uint64_t)b | (uint64_t)g << 16 | (uint64_t)r << 32 |
+           (uint64_t)a << 48;
+}
+
+#ifdef hdr_sse2
+
+// round(v * m / 65535) for 8 uint16_t lanes
+
+static inline __m128i hdr_mul(__m128i v, __m128i m) {
+    const __m128i lo = _mm_mullo_epi16(v, m);
+    const __m128i hi = _mm_mulhi_epu16(v, m);
+    const __m128i half = _mm_set1_epi32(32768);
+    __m128i p0 = _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half);
+    __m128i p1 = _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half);
+    p0 = _mm_srli_epi32(_mm_add_epi32(p0, _mm_srli_epi32(p0, 16)), 16);
+    p1 = _mm_srli_epi32(_mm_add_epi32(p1, _mm_srli_epi32(p1, 16)), 16);
+    // [0..0xFFFF] -> sign extended int16_t so packs_epi32 keeps the bits
+    p0 = _mm_srai_epi32(_mm_slli_epi32(p0, 16), 16);
+    p1 = _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16);
+    return _mm_packs_epi32(p0, p1);
+}
+
+#endif
+
+static void hdr_blend_span(uint64_t* d, const uint64_t* s, int32_t n,
+        uint32_t alpha) {
+    assert(alpha <= 0xFFFF);
+    int32_t i = 0;
+    #ifdef hdr_sse2
+        const __m128i ones = _mm_set1_epi32(-1);
+        const __m128i ca = _mm_set1_epi16((int16_t)alpha);
+        for (; i + 2 <= n; i += 2) {
+            __m128i sv = _mm_loadu_si128((const __m128i*)(s + i));
+            if (alpha != 0xFFFF) { sv = hdr_mul(sv, ca); }
+            __m128i sa = _mm_shufflelo_epi16(sv, _MM_SHUFFLE(3, 3, 3, 3));
+            sa = _mm_shufflehi_epi16(sa, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128i dv = _mm_loadu_si128((const __m128i*)(d + i));
+            const __m128i r = hdr_mul(dv, _mm_xor_si128(sa, ones));
+            _mm_storeu_si128((__m128i*)(d + i), _mm_adds_epu16(sv, r));
+        }
+    #endif
+    for (; i < n; i++) {
+        uint32_t sc[4];
+        for (int32_t k = 0; k < 4; k++) {
+            sc[k] = hdr_channel(s[i], k);
+            if (alpha != 0xFFFF) { sc[k] = hdr_div65535(sc[k] * alpha); }
+        }
+        const uint32_t inv = 0xFFFF - sc[3];
+        uint64_t p = 0;
+        for (int32_t k = 0; k < 4; k++) {
+            const uint32_t v = sc[k] + hdr_div65535(hdr_channel(d[i], k) * inv);
+            p |= (uint64_t)min(v, 0xFFFF) << (k * 16);
+        }
+        d[i] = p;
+    }
+}
+
+static void hdr_dither_span(uint32_t* d, const uint64_t* s, int32_t n,
+        int32_t x, int32_t y) {
+    const uint8_t* t = hdr_bayer[y & 7];
+    int32_t i = 0;
+    #ifdef hdr_sse2
+        __m128i th[4]; // thresholds of pixels pairs (x + i) & 7
+        for (int32_t k = 0; k < 4; k++) {
+            const int16_t t0 = t[(x + k * 2) & 7];
+            const int16_t t1 = t[(x + k * 2 + 1) & 7];
+            th[k] = _mm_set_epi16(t1, t1, t1, t1, t0, t0, t0, t0);
+        }
+        for (; i + 4 <= n; i += 4) {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(s + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(s + i + 2));
+            // v - (v >> 8) maps [0..0xFFFF] to [0..0xFF00] 8.8 fixed point
+            v0 = _mm_sub_epi16(v0, _mm_srli_epi16(v0, 8));
+            v1 = _mm_sub_epi16(v1, _mm_srli_epi16(v1, 8));
+            v0 = _mm_srli_epi16(_mm_adds_epu16(v0, th[(i >> 1) & 3]), 8);
+            v1 = _mm_srli_epi16(_mm_adds_epu16(v1, th[((i >> 1) + 1) & 3]), 8);
+            _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(v0, v1));
+        }
+    #endif
+    for (; i < n; i++) {
+        const uint32_t th = t[(x + i) & 7];
+        uint32_t p = 0;
+        for (int32_t k = 0; k < 4; k++) {
+            const uint32_t v = hdr_channel(s[i], k);
+            p |= ((v - (v >> 8) + th) >> 8) << (k * 8);
+        }
+        d[i] = p;
+    }
+}
+
+// hdr_clip() clips rectangle to image bounds returns false if empty
+
+static bool hdr_clip(const image_t* image, int32_t* x, int32_t* y,
+        int32_t* w, int32_t* h) {
+    const int32_t x0 = max(*x, 0);
+    const int32_t y0 = max(*y, 0);
+    const int32_t x1 = min(*x + *w, image->w);
+    const int32_t y1 = min(*y + *h, image->h);
+    *x = x0; *y = y0; *w = x1 - x0; *h = y1 - y0;
+    return x0 < x1 && y0 < y1;
+}
+
+static inline uint64_t* hdr_row(const image_t* image, int32_t y) {
+    return (uint64_t*)((uint8_t*)image->pixels + (int64_t)y * image->stride);
+}
+
+// hdr_rows() blends or copies (opaque) row of `w` pixels into rows
+// [y..y + h) at x
+
+static void hdr_rows(image_t* image, int32_t x, int32_t y, int32_t w,
+        int32_t h, const uint64_t* row, bool opaque) {
+    for (int32_t j = y; j < y + h; j++) {
+        uint64_t* d = hdr_row(image, j) + x;
+        if (opaque) {
+            memcpy(d, row, w * sizeof(uint64_t));
+        } else {
+            hdr_blend_span(d, row, w, 0xFFFF);
+        }
+    }
+}
+
+static void hdr_fill(image_t* image, int32_t x, int32_t y, int32_t w,
+        int32_t h, ui_color_t c) {
+    assert(image->bpp == 8);
+    if (hdr_clip(image, &x, &y, &w, &h)) {
+        const uint64_t p = hdr_pixel(c);
+        uint64_t* row = (uint64_t*)malloc(w * sizeof(uint64_t));
+        fatal_if_null(row);
+        for (int32_t i = 0; i < w; i++) { row[i] = p; }
+        hdr_rows(image, x, y, w, h, row, (p >> 48) == 0xFFFF);
+        free(row);
+    }
+}
+
+// hdr_lerp() premultiplied a + (b - a) * i / n
+
+static uint64_t hdr_lerp(uint64_t a, uint64_t b, int32_t i, int32_t n) {
+    int64_t v[4];
+    for (int32_t k = 0; k < 4; k++) {
+        const int64_t ca = hdr_channel(a, k);
+        const int64_t cb = hdr_channel(b, k);
+        v[k] = n == 0 ? ca : ca + ((cb - ca) * i * 2 + n) / (n * 2);
+    }
+    uint64_t p = (uint64_t)v[3] << 48;
+    for (int32_t k = 0; k < 3; k++) { // rounding must keep colors <= alpha
+        p |= (uint64_t)min(v[k], v[3]) << (k * 16);
+    }
+    return p;
+}
+
+static void hdr_gradient(image_t* image, int32_t x, int32_t y, int32_t w,
+        int32_t h, ui_color_t from, ui_color_t to, bool vertical) {
+    assert(image->bpp == 8);
+    const uint64_t a = hdr_pixel(from);
+    const uint64_t b = hdr_pixel(to);
+    const bool opaque = (a >> 48) == 0xFFFF && (b >> 48) == 0xFFFF;
+    const int32_t x0 = x;
+    const int32_t y0 = y;
+    const int32_t n = (vertical ? h : w) - 1;
+    if (hdr_clip(image, &x, &y, &w, &h)) {
+        uint64_t* row = (uint64_t*)malloc(w * sizeof(uint64_t));
+        fatal_if_null(row);
+        if (vertical) {
+            for (int32_t j = y; j < y + h; j++) {
+                const uint64_t p = hdr_lerp(a, b, j - y0, n);
+                for (int32_t i = 0; i < w; i++) { row[i] = p; }
+                hdr_rows(image, x, j, w, 1, row, opaque);
+            }
+        } else {
+            for (int32_t i = 0; i < w; i++) {
+                row[i] = hdr_lerp(a, b, x + i - x0, n);
+            }
+            hdr_rows(image, x, y, w, h, row, opaque);
+        }
+        free(row);
+    }
+}
+
+typedef struct hdr_blend_s {
+    image_t* d;
+    const image_t* s;
+    int32_t x; // destination
+    int32_t y;
+    int32_t sx; // source
+    int32_t sy;
+    int32_t w;
+    uint32_t alpha;
+} hdr_blend_t;
+
+static void hdr_blend_band(void* that, int32_t y0, int32_t y1) {
+    const hdr_blend_t* b = (const hdr_blend_t*)that;
+    uint64_t* row = b->s->bpp == 4 ?
+        (uint64_t*)malloc(b->w * sizeof(uint64_t)) : null;
+    fatal_if(b->s->bpp == 4 && row == null);
+    for (int32_t j = y0; j < y1; j++) {
+        const uint8_t* s = (const uint8_t*)b->s->pixels +
+            (int64_t)(b->sy + j) * b->s->stride;
+        const uint64_t* src;
+        if (b->s->bpp == 4) { // 8 -> 16 bit: v * 257
+            const uint8_t* p = s + b->sx * 4;
+            for (int32_t i = 0; i < b->w; i++) {
+                row[i] = 0;
+                for (int32_t k = 0; k < 4; k++) {
+                    row[i] |= (uint64_t)(p[i * 4 + k] * 257u) << (k * 16);
+                }
+            }
+            src = row;
+        } else {
+            src = (const uint64_t*)s + b->sx;
+        }
+        hdr_blend_span(hdr_row(b->d, b->y + j) + b->x, src, b->w, b->alpha);
+    }
+    free(row);
+}
+
+static void hdr_blend(image_t* d, int32_t x, int32_t y, const image_t* s,
+        double alpha) {
+    assert(d->bpp == 8 && (s->bpp == 8 || s->bpp == 4));
+    assert(0 <= alpha && alpha <= 1);
+    int32_t w = s->w;
+    int32_t h = s->h;
+    const int32_t x0 = x;
+    const int32_t y0 = y;
+    if (hdr_clip(d, &x, &y, &w, &h)) {
+        GdiFlush(); // s may be DIB section with pending GDI drawing
+        hdr_blend_t b = { d, s, x, y, x - x0, y - y0, w,
+                          (uint32_t)(alpha * 0xFFFF + 0.5) };
+        conversions.bands(&b, hdr_blend_band, w, h);
+    }
+}
+
+typedef struct hdr_dither_s {
+    image_t* d;
+    const image_t* s;
+} hdr_dither_t;
+
+static void hdr_dither_band(void* that, int32_t y0, int32_t y1) {
+    const hdr_dither_t* b = (const hdr_dither_t*)that;
+    for (int32_t y = y0; y < y1; y++) {
+        uint32_t* d = (uint32_t*)((uint8_t*)b->d->pixels +
+            (int64_t)y * b->d->stride);
+        hdr_dither_span(d, hdr_row(b->s, y), b->s->w, 0, y);
+    }
+}
+
+static void hdr_dither(image_t* d, const image_t* s) {
+    fatal_if(d->bpp != 4 || s->bpp != 8, "d.bpp: %d s.bpp: %d", d->bpp, s->bpp);
+    fatal_if(d->w != s->w || d->h != s->h);
+    GdiFlush(); // GDI may still be reading the bitmap
+    hdr_dither_t b = { d, s };
+    conversions.bands(&b, hdr_dither_band, s->w, s->h);
+}
+
+hdr_if hdr = {
+    .init        = hdr_init,
+    .dispose     = hdr_dispose,
+    .pixel       = hdr_pixel,
+    .fill        = hdr_fill,
+    .gradient    = hdr_gradient,
+    .blend       = hdr_blend,
+    .dither      = hdr_dither,
+    .blend_span  = hdr_blend_span,
+    .dither_span = hdr_dither_span
+};
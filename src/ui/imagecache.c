@@ -0,0 +1,286 @@
+// File: 64 bytes header followed by level 0 pixels [h][w] and mip levels
+// (each half of the previous one rounded up, down to 1x1), all tightly
+// packed premultiplied BGRA. Level 0 is mapped as DIB section pixels at
+// the header offset, mip levels point into read only view of the file.
+
+enum {
+    imagecache_magic   = 0x31434D49, // "IMC1"
+    imagecache_version = 2
+};
+
+typedef struct imagecache_header_s {
+    uint32_t magic;
+    uint32_t version;
+    imagecache_key_t key; // all fields must match the requested key
+    int32_t w;
+    int32_t h;
+    int32_t levels; // number of mip levels after level 0
+    int32_t mipmap; // gdi.image_mipmap the levels were built with
+    uint8_t reserved[8];
+} imagecache_header_t;
+
+typedef struct imagecache_mapping_s {
+    ui_bitmap_t bitmap; // of the image loaded from cache
+    HANDLE section;
+    void* view; // of the whole file for mip levels
+} imagecache_mapping_t;
+
+static struct {
+    imagecache_mapping_t* entries;
+    int32_t count;
+    int32_t capacity;
+    SRWLOCK lock;
+} imagecache_mappings = { .lock = SRWLOCK_INIT };
+
+static const char* imagecache_folder(void) {
+    static char temp[MAX_PATH];
+    static SRWLOCK lock = SRWLOCK_INIT;
+    if (imagecache.folder != null) { return imagecache.folder; }
+    AcquireSRWLockExclusive(&lock);
+    if (temp[0] == 0) {
+        char path[MAX_PATH];
+        fatal_if(GetTempPathA(countof(path), path) == 0);
+        strprintf(temp, "%sui.imagecache", path); // path ends with "\"
+    }
+    ReleaseSRWLockExclusive(&lock);
+    return temp;
+}
+
+static inline uint64_t imagecache_mix(uint64_t h) { // murmur3 fmix64
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// imagecache_key() hashes 8 bytes words (it is called on every load and
+// encoded images are megabytes) with two independent functions: every
+// bit of each word affects all bits of both hashes. Encoded length and
+// requested size are hashed too and kept in the key for verification.
+
+static imagecache_key_t imagecache_key(const void* data, int64_t bytes,
+        int32_t w, int32_t h) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint64_t size = (uint64_t)(uint32_t)w << 32 | (uint32_t)h;
+    uint64_t h0 = imagecache_mix(0x243F6A8885A308D3ULL ^ (uint64_t)bytes);
+    uint64_t h1 = imagecache_mix(0x13198A2E03707344ULL + (uint64_t)bytes);
+    int64_t i = 0;
+    for (;;) {
+        uint64_t v = 0;
+        const int64_t n = min(bytes - i, 8);
+        if (n <= 0) { break; }
+        memcpy(&v, p + i, (size_t)n); // last word is zero padded
+        h0 = imagecache_mix(h0 ^ v);
+        h1 = (h1 ^ (v * 0x9E3779B97F4A7C15ULL)) * 0x94D049BB133111EBULL;
+        h1 = h1 << 29 | h1 >> 35;
+        i += n;
+    }
+    return (imagecache_key_t){
+        .hash  = imagecache_mix(h0 ^ size),
+        .check = imagecache_mix(h1 ^ imagecache_mix(size)),
+        .bytes = bytes, .w = w, .h = h
+    };
+}
+
+static int64_t imagecache_levels_bytes(int32_t w, int32_t h, int32_t* levels) {
+    int64_t bytes = (int64_t)w * h * 4;
+    *levels = 0;
+    while (w > 1 || h > 1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        bytes += (int64_t)w * h * 4;
+        (*levels)++;
+    }
+    return bytes;
+}
+
+static errno_t imagecache_write(HANDLE file, const void* data, int64_t bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (bytes > 0) {
+        const DWORD chunk = (DWORD)min(bytes, 1024 * 1024 * 1024);
+        DWORD written = 0;
+        if (!WriteFile(file, p, chunk, &written, null)) { return GetLastError(); }
+        if (written != chunk) { return ERROR_WRITE_FAULT; }
+        p += chunk;
+        bytes -= chunk;
+    }
+    return 0;
+}
+
+static errno_t imagecache_store(image_t* image, const imagecache_key_t* key) {
+    fatal_if(image->bpp != 4, "bpp=%d only premultiplied BGRA", image->bpp);
+    not_null(image->bitmap);
+    assert(image->stride == image->w * 4);
+    const char* folder = imagecache_folder();
+    errno_t r = CreateDirectoryA(folder, null) ? 0 : GetLastError();
+    if (r == ERROR_ALREADY_EXISTS) { r = 0; }
+    char temp[MAX_PATH] = {0};
+    if (r == 0) {
+        // unique temporary file in the same folder is renamed when complete
+        r = GetTempFileNameA(folder, "imc", 0, temp) != 0 ? 0 : GetLastError();
+    }
+    HANDLE file = INVALID_HANDLE_VALUE;
+    if (r == 0) {
+        file = CreateFileA(temp, GENERIC_WRITE, 0, null, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, null);
+        r = file != INVALID_HANDLE_VALUE ? 0 : GetLastError();
+    }
+    if (r == 0) {
+        imagecache_header_t header = {
+            .magic = imagecache_magic, .version = imagecache_version,
+            .key = *key, .w = image->w, .h = image->h,
+            .mipmap = gdi.image_mipmap
+        };
+        imagecache_levels_bytes(image->w, image->h, &header.levels);
+        GdiFlush(); // GDI may still be drawing into the bitmap
+        r = imagecache_write(file, &header, sizeof(header));
+        if (r == 0) {
+            r = imagecache_write(file, image->pixels, (int64_t)image->stride * image->h);
+        }
+        // mip levels are built once and kept for drawing anyway
+        // (gdi_mip() takes gdi_scaled.lock itself):
+        gdi_mip(image, 1, 1);
+        for (const image_t* m = image->mip; m != null && r == 0; m = m->mip) {
+            r = imagecache_write(file, m->pixels, (int64_t)m->stride * m->h);
+        }
+        fatal_if_false(CloseHandle(file));
+    }
+    if (r == 0) {
+        char path[MAX_PATH];
+        strprintf(path, "%s\\%016llX.bgra", folder, key->hash);
+        r = MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING) ? 0 : GetLastError();
+    }
+    if (r != 0 && temp[0] != 0) { DeleteFileA(temp); }
+    return r;
+}
+
+// imagecache_open() returns read only file mapping of a valid cache file
+// for the key or null. File of another image with the same key.hash (or
+// of the same image at another size) differs in key.check or key.bytes.
+
+static HANDLE imagecache_open(const imagecache_key_t* key,
+        imagecache_header_t* header) {
+    char path[MAX_PATH];
+    strprintf(path, "%s\\%016llX.bgra", imagecache_folder(), key->hash);
+    HANDLE file = CreateFileA(path, GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE, null, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, null);
+    if (file == INVALID_HANDLE_VALUE) { return null; }
+    DWORD read = 0;
+    LARGE_INTEGER size = {0};
+    bool valid = ReadFile(file, header, sizeof(*header), &read, null) &&
+        read == sizeof(*header) && GetFileSizeEx(file, &size) &&
+        header->magic == imagecache_magic &&
+        header->version == imagecache_version &&
+        memcmp(&header->key, key, sizeof(*key)) == 0 &&
+        header->w > 0 && header->h > 0;
+    if (valid) {
+        int32_t levels = 0;
+        const int64_t bytes = imagecache_levels_bytes(header->w, header->h,
+            &levels);
+        valid = header->levels == levels &&
+                size.QuadPart == (int64_t)sizeof(*header) + bytes;
+    }
+    // DIB sections cannot be read only: PAGE_WRITECOPY makes writes to
+    // the image pixels private to the process
+    HANDLE section = valid ?
+        CreateFileMappingA(file, null, PAGE_WRITECOPY, 0, 0, null) : null;
+    fatal_if_false(CloseHandle(file)); // section keeps the file open
+    return section;
+}
+
+static errno_t imagecache_load(image_t* image, const imagecache_key_t* key) {
+    fatal_if(image->bitmap != null, "image_dispose() not called?");
+    imagecache_header_t header = {0};
+    HANDLE section = imagecache_open(key, &header);
+    void* view = section != null ?
+        MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0) : null;
+    if (view != null) {
+        const int32_t w = header.w;
+        const int32_t h = header.h;
+        BITMAPINFO bi = { {sizeof(BITMAPINFOHEADER)} };
+        HDC c = CreateCompatibleDC(null);
+        image->bitmap = (ui_bitmap_t)CreateDIBSection(c,
+            gdi_init_bitmap_info(w, h, 4, &bi), DIB_RGB_COLORS,
+            &image->pixels, section, sizeof(header));
+        fatal_if_false(DeleteDC(c));
+        if (image->bitmap == null) {
+            fatal_if_false(UnmapViewOfFile(view));
+            view = null;
+        }
+    }
+    if (view == null) {
+        if (section != null) { fatal_if_false(CloseHandle(section)); }
+        InterlockedIncrement((volatile LONG*)&imagecache.misses);
+        return ERROR_NOT_FOUND;
+    }
+    image->w = header.w;
+    image->h = header.h;
+    image->bpp = 4;
+    image->stride = header.w * 4;
+    if (header.mipmap == gdi.image_mipmap) {
+        const uint8_t* p = (const uint8_t*)view + sizeof(header) +
+            (int64_t)image->stride * image->h;
+        image_t* level = image;
+        for (int32_t i = 0; i < header.levels; i++) {
+            image_t* m = (image_t*)calloc(1, sizeof(image_t));
+            fatal_if_null(m);
+            m->w = (level->w + 1) / 2;
+            m->h = (level->h + 1) / 2;
+            m->bpp = 4;
+            m->stride = m->w * 4;
+            m->pixels = (void*)p; // never written: used as resample source
+            p += (int64_t)m->stride * m->h;
+            level->mip = m;
+            level = m;
+        }
+        if (image->mip != null) { // stale when image is drawn into
+            AcquireSRWLockExclusive(&gdi_scaled.lock);
+            gdi_scaled_mipped(image->mip, image->bitmap);
+            ReleaseSRWLockExclusive(&gdi_scaled.lock);
+        }
+    }
+    AcquireSRWLockExclusive(&imagecache_mappings.lock);
+    if (imagecache_mappings.count == imagecache_mappings.capacity) {
+        const int32_t n = imagecache_mappings.capacity * 2 + 16;
+        imagecache_mapping_t* entries = (imagecache_mapping_t*)realloc(
+            imagecache_mappings.entries, n * sizeof(imagecache_mapping_t));
+        fatal_if_null(entries);
+        imagecache_mappings.entries = entries;
+        imagecache_mappings.capacity = n;
+    }
+    imagecache_mappings.entries[imagecache_mappings.count++] =
+        (imagecache_mapping_t){ image->bitmap, section, view };
+    ReleaseSRWLockExclusive(&imagecache_mappings.lock);
+    InterlockedIncrement((volatile LONG*)&imagecache.hits);
+    return 0;
+}
+
+static void imagecache_dispose(image_t* image) {
+    imagecache_mapping_t mapping = {0};
+    AcquireSRWLockExclusive(&imagecache_mappings.lock);
+    for (int32_t i = 0; i < imagecache_mappings.count; i++) {
+        if (imagecache_mappings.entries[i].bitmap == image->bitmap) {
+            mapping = imagecache_mappings.entries[i];
+            imagecache_mappings.entries[i] =
+                imagecache_mappings.entries[--imagecache_mappings.count];
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&imagecache_mappings.lock);
+    gdi.image_dispose(image); // frees mip levels before unmapping them
+    if (mapping.view != null) {
+        // section must be closed after the DIB section is deleted
+        fatal_if_false(UnmapViewOfFile(mapping.view));
+        fatal_if_false(CloseHandle(mapping.section));
+    }
+}
+
+imagecache_if imagecache = {
+    .key     = imagecache_key,
+    .load    = imagecache_load,
+    .store   = imagecache_store,
+    .dispose = imagecache_dispose
+};
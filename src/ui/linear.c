@@ -0,0 +1,229 @@
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define linear_sse2
+#endif
+
+enum { linear_max = (1 << linear_bits) - 1 };
+
+static uint16_t linear_decode[256];        // sRGB -> linear
+static uint8_t  linear_encode[linear_max + 1]; // linear -> sRGB
+static uint32_t linear_rcp[256];           // round((255 << 16) / a)
+static volatile LONG linear_ready;
+static SRWLOCK linear_lock = SRWLOCK_INIT;
+
+static void linear_init(void) {
+    if (!linear_ready) {
+        AcquireSRWLockExclusive(&linear_lock);
+        if (!linear_ready) {
+            for (int32_t i = 0; i < countof(linear_decode); i++) {
+                const double c = i / 255.0;
+                const double l = c <= 0.04045 ? c / 12.92 :
+                    pow((c + 0.055) / 1.055, 2.4);
+                linear_decode[i] = (uint16_t)(l * linear_max + 0.5);
+            }
+            for (int32_t i = 0; i < countof(linear_encode); i++) {
+                const double l = (double)i / linear_max;
+                const double c = l <= 0.0031308 ? l * 12.92 :
+                    1.055 * pow(l, 1 / 2.4) - 0.055;
+                linear_encode[i] = (uint8_t)(c * 255 + 0.5);
+            }
+            for (int32_t a = 1; a < countof(linear_rcp); a++) {
+                linear_rcp[a] = (uint32_t)(((255u << 16) + a / 2) / a);
+            }
+            InterlockedExchange(&linear_ready, 1);
+        }
+        ReleaseSRWLockExclusive(&linear_lock);
+    }
+}
+
+static const uint16_t* linear_decode_table(void) {
+    linear_init();
+    return linear_decode;
+}
+
+static const uint8_t* linear_encode_table(void) {
+    linear_init();
+    return linear_encode;
+}
+
+// linear_unpack() premultiplied sRGB BGRA -> premultiplied linear light
+// b, g, r [0..linear_max] and alpha [0..255] in c[3]
+
+static inline void linear_unpack(uint32_t p, uint32_t c[4]) {
+    const uint32_t a = p >> 24;
+    c[3] = a;
+    if (a == 255) {
+        c[0] = linear_decode[p & 0xFF];
+        c[1] = linear_decode[(p >> 8) & 0xFF];
+        c[2] = linear_decode[(p >> 16) & 0xFF];
+    } else if (a == 0) {
+        c[0] = 0; c[1] = 0; c[2] = 0;
+    } else {
+        for (int32_t k = 0; k < 3; k++) {
+            const uint32_t v = (p >> (k * 8)) & 0xFF; // v <= a
+            const uint32_t s = min((v * linear_rcp[a] + 0x8000) >> 16, 255);
+            c[k] = (linear_decode[s] * a + 127) / 255;
+        }
+    }
+}
+
+// linear_pack() is inverse of linear_unpack()
+
+static inline uint32_t linear_pack(const uint32_t c[4]) {
+    const uint32_t a = c[3];
+    uint32_t p = a << 24;
+    if (a == 255) {
+        p |= linear_encode[c[0]] | linear_encode[c[1]] << 8 |
+             (uint32_t)linear_encode[c[2]] << 16;
+    } else if (a != 0) {
+        for (int32_t k = 0; k < 3; k++) {
+            const uint32_t l = min((c[k] * 255 + a / 2) / a, linear_max);
+            p |= ((linear_encode[l] * a + 127) / 255) << (k * 8);
+        }
+    }
+    return p;
+}
+
+static inline uint32_t linear_over(uint32_t d, uint32_t s, uint32_t alpha) {
+    uint32_t sc[4];
+    uint32_t dc[4];
+    linear_unpack(s, sc);
+    linear_unpack(d, dc);
+    if (alpha != 255) {
+        for (int32_t k = 0; k < 4; k++) { sc[k] = (sc[k] * alpha + 127) / 255; }
+    }
+    const uint32_t ia = 255 - sc[3];
+    for (int32_t k = 0; k < 4; k++) {
+        dc[k] = sc[k] + (dc[k] * ia + 127) / 255;
+    }
+    return linear_pack(dc);
+}
+
+static void linear_blend_span(uint32_t* d, const uint32_t* s, int32_t n,
+        int32_t alpha) {
+    assert(0 <= alpha && alpha <= 255);
+    linear_init();
+    if (alpha == 0) { return; }
+    int32_t i = 0;
+    while (i < n) {
+        #ifdef linear_sse2
+            if (alpha == 255) { // skip transparent and copy opaque runs
+                const __m128i z = _mm_setzero_si128();
+                const __m128i ones = _mm_set1_epi32(-1);
+                for (; i + 4 <= n; i += 4) {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+                    const __m128i a = _mm_srli_epi32(v, 24);
+                    const int32_t zero = _mm_movemask_epi8(_mm_cmpeq_epi32(a, z));
+                    if (zero != 0xFFFF) {
+                        const __m128i o = _mm_cmpeq_epi32(_mm_or_si128(v,
+                            _mm_set1_epi32(0x00FFFFFF)), ones);
+                        if (_mm_movemask_epi8(o) != 0xFFFF) { break; }
+                        _mm_storeu_si128((__m128i*)(d + i), v);
+                    }
+                }
+            }
+        #endif
+        const int32_t e = min(i + 4, n);
+        for (; i < e; i++) {
+            const uint32_t sa = s[i] >> 24;
+            if (sa == 255 && alpha == 255) {
+                d[i] = s[i];
+            } else if (sa != 0) {
+                d[i] = linear_over(d[i], s[i], (uint32_t)alpha);
+            }
+        }
+    }
+}
+
+static uint32_t linear_lerp(ui_color_t c0, ui_color_t c1, int64_t i,
+        int64_t n) {
+    linear_init();
+    static const int32_t shift[4] = { 16, 8, 0, 24 }; // r g b a
+    uint32_t bgra = 0;
+    for (int32_t k = 0; k < 4; k++) {
+        const int64_t v0 = (c0 >> (k * 8)) & 0xFF;
+        const int64_t v1 = (c1 >> (k * 8)) & 0xFF;
+        int64_t v;
+        if (k == 3) {
+            v = n == 0 ? v0 : v0 + (v1 - v0) * i / n;
+        } else {
+            const int64_t l0 = linear_decode[v0];
+            const int64_t l1 = linear_decode[v1];
+            v = linear_encode[n == 0 ? l0 : l0 + (l1 - l0) * i / n];
+        }
+        bgra |= (uint32_t)v << shift[k];
+    }
+    return bgra;
+}
+
+typedef struct linear_downscale_s {
+    uint8_t* d;
+    int32_t dw;
+    int32_t dh;
+    int32_t d_stride;
+    const uint8_t* s;
+    int32_t sw;
+    int32_t sh;
+    int32_t s_stride;
+    const int32_t* xs; // [sw + 1] first source column of destination column
+} linear_downscale_t;
+
+static void linear_downscale_band(void* that, int32_t j0, int32_t j1) {
+    const linear_downscale_t* b = (const linear_downscale_t*)that;
+    uint32_t* acc = (uint32_t*)malloc((size_t)b->dw * 4 * sizeof(uint32_t));
+    fatal_if_null(acc);
+    for (int32_t j = j0; j < j1; j++) {
+        const int32_t y0 = (int32_t)((int64_t)j * b->sh / b->dh);
+        const int32_t y1 = (int32_t)((int64_t)(j + 1) * b->sh / b->dh);
+        memset(acc, 0, (size_t)b->dw * 4 * sizeof(uint32_t));
+        for (int32_t y = y0; y < y1; y++) {
+            const uint32_t* s = (const uint32_t*)(b->s + (int64_t)y * b->s_stride);
+            for (int32_t i = 0; i < b->dw; i++) {
+                uint32_t* a = acc + i * 4;
+                for (int32_t x = b->xs[i]; x < b->xs[i + 1]; x++) {
+                    uint32_t c[4];
+                    linear_unpack(s[x], c);
+                    a[0] += c[0]; a[1] += c[1]; a[2] += c[2]; a[3] += c[3];
+                }
+            }
+        }
+        uint32_t* d = (uint32_t*)(b->d + (int64_t)j * b->d_stride);
+        for (int32_t i = 0; i < b->dw; i++) {
+            const uint32_t count = (uint32_t)((b->xs[i + 1] - b->xs[i]) *
+                                              (y1 - y0));
+            uint32_t c[4];
+            for (int32_t k = 0; k < 4; k++) {
+                c[k] = (acc[i * 4 + k] + count / 2) / count;
+            }
+            d[i] = linear_pack(c);
+        }
+    }
+    free(acc);
+}
+
+static void linear_downscale(uint8_t* d, int32_t dw, int32_t dh,
+        int32_t d_stride, const uint8_t* s, int32_t sw, int32_t sh,
+        int32_t s_stride) {
+    fatal_if(dw <= 0 || dh <= 0 || dw > sw || dh > sh,
+        "%dx%d -> %dx%d", sw, sh, dw, dh);
+    // counts fit: (sw / dw + 1) * (sh / dh + 1) * linear_max < 2^32
+    fatal_if((int64_t)(sw / dw + 1) * (sh / dh + 1) > (1 << 20),
+        "%dx%d -> %dx%d", sw, sh, dw, dh);
+    linear_init();
+    int32_t* xs = (int32_t*)malloc((dw + 1) * sizeof(int32_t));
+    fatal_if_null(xs);
+    for (int32_t i = 0; i <= dw; i++) {
+        xs[i] = (int32_t)((int64_t)i * sw / dw);
+    }
+    linear_downscale_t b = { d, dw, dh, d_stride, s, sw, sh, s_stride, xs };
+    conversions.bands(&b, linear_downscale_band, sw * (sh / dh), dh);
+    free(xs);
+}
+
+linear_if linear = {
+    .decode_table = linear_decode_table,
+    .encode_table = linear_encode_table,
+    .blend_span   = linear_blend_span,
+    .lerp         = linear_lerp,
+    .downscale    = linear_downscale
+};
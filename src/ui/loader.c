@@ -0,0 +1,154 @@
+// Decoded images are queued by workers and delivered by loader_drain()
+// on the UI thread: on ui.message.loaded posted to the window and once
+// the window opens (results that came before window creation).
+
+typedef struct loader_result_s loader_result_t;
+
+typedef struct loader_result_s {
+    loader_request_t* request;
+    image_t image; // bitmap == null if none
+    bool final;
+    loader_result_t* next;
+} loader_result_t;
+
+static struct {
+    loader_result_t* head;
+    loader_result_t* tail;
+    SRWLOCK lock;
+} loader_queue = { .lock = SRWLOCK_INIT };
+
+static bool loader_canceled(const loader_request_t* r) {
+    return r->canceled != 0; // volatile read
+}
+
+static void loader_post(loader_request_t* r, const image_t* image,
+        bool final) {
+    loader_result_t* e = (loader_result_t*)calloc(1, sizeof(loader_result_t));
+    fatal_if_null(e);
+    e->request = r;
+    if (image != null) { e->image = *image; }
+    e->final = final;
+    AcquireSRWLockExclusive(&loader_queue.lock);
+    if (loader_queue.tail != null) {
+        loader_queue.tail->next = e;
+    } else {
+        loader_queue.head = e;
+    }
+    loader_queue.tail = e;
+    ReleaseSRWLockExclusive(&loader_queue.lock);
+    // window is created after app.init(): queued results are delivered
+    // by app_window_opening(). Failure to post after window is
+    // destroyed is not an error.
+    if (app.window != null) {
+        PostMessageA(window(), ui.message.loaded, 0, 0);
+    }
+}
+
+static void loader_drain(void) {
+    assert(threads.id() == app.tid);
+    AcquireSRWLockExclusive(&loader_queue.lock);
+    loader_result_t* e = loader_queue.head;
+    loader_queue.head = null;
+    loader_queue.tail = null;
+    ReleaseSRWLockExclusive(&loader_queue.lock);
+    while (e != null) {
+        loader_result_t* next = e->next;
+        loader_request_t* r = e->request;
+        image_t* image = e->image.bitmap != null ? &e->image : null;
+        if (loader_canceled(r) && image != null) {
+            imagecache.dispose(image);
+            image = null;
+        }
+        if (e->final || image != null) { r->loaded(r, image, e->final); }
+        free(e);
+        e = next;
+    }
+}
+
+// loader_fit() w x h shrunk to fit into mw x mh keeping aspect ratio
+
+static void loader_fit(int32_t* w, int32_t* h, int32_t mw, int32_t mh) {
+    if (mw > 0 && mh > 0 && (*w > mw || *h > mh)) {
+        const double s = min((double)mw / *w, (double)mh / *h);
+        *w = max(1, (int32_t)(*w * s + 0.5));
+        *h = max(1, (int32_t)(*h * s + 0.5));
+    }
+}
+
+// loader_image() of w x h from premultiplied BGRA s[sh][sw]
+
+static void loader_image(image_t* image, int32_t w, int32_t h,
+        const uint8_t* s, int32_t sw, int32_t sh, int32_t filter) {
+    gdi.image_acquire(image, w, h, 4);
+    if (w == sw && h == sh) {
+        for (int32_t y = 0; y < h; y++) {
+            memcpy((uint8_t*)image->pixels + (int64_t)y * image->stride,
+                   s + (int64_t)y * sw * 4, (size_t)w * 4);
+        }
+    } else {
+        resample.bgra(image->pixels, w, h, image->stride, s, sw, sh, sw * 4,
+            filter);
+    }
+}
+
+static void CALLBACK loader_worker(PTP_CALLBACK_INSTANCE unused(instance),
+        void* context) {
+    loader_request_t* r = (loader_request_t*)context;
+    image_t image = {0};
+    imagecache_key_t key = {0};
+    if (r->cache && !loader_canceled(r)) {
+        key = imagecache.key(r->data, r->bytes, r->w, r->h);
+        if (imagecache.load(&image, &key) == 0) {
+            r->size = (ui_point_t){image.w, image.h};
+            loader_post(r, &image, true);
+            return;
+        }
+    }
+    int32_t w = 0;
+    int32_t h = 0;
+    uint8_t* pixels = loader_canceled(r) ? null :
+        r->decode(r->data, r->bytes, &w, &h);
+    if (pixels != null && w > 0 && h > 0 && !loader_canceled(r)) {
+        conversions.rows(conversions.rgba_premultiply, pixels, w * 4,
+                         pixels, w * 4, w, h);
+        int32_t fw = w;
+        int32_t fh = h;
+        loader_fit(&fw, &fh, r->w, r->h);
+        r->size = (ui_point_t){fw, fh};
+        int32_t pw = fw;
+        int32_t ph = fh;
+        loader_fit(&pw, &ph, r->preview, r->preview);
+        if (r->preview > 0 && (pw < fw || ph < fh)) {
+            image_t preview = {0};
+            loader_image(&preview, pw, ph, pixels, w, h, resample_box);
+            loader_post(r, &preview, false);
+        }
+        if (!loader_canceled(r)) {
+            loader_image(&image, fw, fh, pixels, w, h, resample_auto);
+        }
+        if (r->cache && image.bitmap != null) {
+            errno_t e = imagecache.store(&image, &key);
+            if (e != 0) { traceln("imagecache.store() failed %s", str.error(e)); }
+        }
+    }
+    free(pixels);
+    loader_post(r, image.bitmap != null ? &image : null, true);
+}
+
+static void loader_load(loader_request_t* r) {
+    not_null(r->decode);
+    not_null(r->loaded);
+    fatal_if(r->data == null || r->bytes <= 0);
+    r->canceled = 0;
+    r->size = (ui_point_t){0, 0};
+    fatal_if_false(TrySubmitThreadpoolCallback(loader_worker, r, null));
+}
+
+static void loader_cancel(loader_request_t* r) {
+    r->canceled = 1; // volatile write
+}
+
+loader_if loader = {
+    .load   = loader_load,
+    .cancel = loader_cancel
+};
@@ -0,0 +1,304 @@
+// Edges of polygon with vertices relative to origin. Scanline y samples
+// pixel centers y + 0.5.
+
+typedef struct polyfill_edge_s {
+    int32_t x;  // top vertex x, y0
+    int32_t dx; // to the bottom vertex x + dx, y1
+    int32_t dy; // y1 - y0 > 0
+    int32_t y0;
+    int32_t y1;
+    int32_t winding; // +1 downwards, -1 upwards
+    double key; // x at the center of row y0: sort order
+} polyfill_edge_t;
+
+// Active edge x at the row center is exactly xi + num / den: pixels on
+// the edge (centers exactly on it) are always decided the same way.
+
+typedef struct polyfill_active_s {
+    int32_t xi;
+    int32_t y1;
+    int64_t num; // [0..den)
+    int64_t den; // 2 * dy
+    int64_t rn;  // step per row is qi + rn / den
+    int32_t qi;
+    int32_t winding;
+} polyfill_active_t;
+
+typedef struct polyfill_span_s { int32_t x0; int32_t x1; } polyfill_span_t;
+
+// polyfill_hash() of relative vertices only rejects changed polygons
+// fast: xorshift after each multiply folds y (high half) into low bits.
+// Equal hashes are confirmed by polyfill_same().
+
+static uint64_t polyfill_hash(const ui_point_t* points, int32_t count) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ (uint64_t)count;
+    for (int32_t i = 0; i < count; i++) {
+        const uint64_t v = (uint64_t)(uint32_t)(points[i].x - points[0].x) |
+            (uint64_t)(uint32_t)(points[i].y - points[0].y) << 32;
+        h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+static bool polyfill_same(const polyfill_t* p, const ui_point_t* points,
+        int32_t count) {
+    if (p->edges == null || p->points != count) { return false; }
+    for (int32_t i = 0; i < count; i++) {
+        if (p->vertices[i].x != points[i].x - points[0].x ||
+            p->vertices[i].y != points[i].y - points[0].y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int polyfill_compare(const void* a, const void* b) {
+    const polyfill_edge_t* ea = (const polyfill_edge_t*)a;
+    const polyfill_edge_t* eb = (const polyfill_edge_t*)b;
+    if (ea->y0 != eb->y0) { return ea->y0 < eb->y0 ? -1 : 1; }
+    return ea->key < eb->key ? -1 : ea->key > eb->key ? 1 : 0;
+}
+
+static bool polyfill_edges(polyfill_t* p, const ui_point_t* points,
+        int32_t count) {
+    assert(count > 0);
+    const uint64_t hash = polyfill_hash(points, count);
+    const bool same = p->hash == hash && polyfill_same(p, points, count);
+    p->origin = points[0];
+    if (!same) {
+        if (p->capacity < count) {
+            p->edges = (polyfill_edge_t*)realloc(p->edges,
+                (size_t)count * sizeof(polyfill_edge_t));
+            fatal_if_null(p->edges);
+            p->vertices = (ui_point_t*)realloc(p->vertices,
+                (size_t)count * sizeof(ui_point_t));
+            fatal_if_null(p->vertices);
+            p->capacity = count;
+        }
+        p->points = count;
+        p->hash = hash;
+        p->count = 0;
+        int32_t x0 = 0;
+        int32_t y0 = 0;
+        int32_t x1 = 0;
+        int32_t y1 = 0;
+        for (int32_t i = 0; i < count; i++) {
+            const int32_t ax = points[i].x - p->origin.x;
+            const int32_t ay = points[i].y - p->origin.y;
+            p->vertices[i] = (ui_point_t){ ax, ay };
+            const ui_point_t* b = &points[i + 1 < count ? i + 1 : 0];
+            const int32_t bx = b->x - p->origin.x;
+            const int32_t by = b->y - p->origin.y;
+            x0 = min(x0, ax); x1 = max(x1, ax);
+            y0 = min(y0, ay); y1 = max(y1, ay);
+            if (ay != by) { // vertices are pixel corners: the edge
+                // crosses centers of rows [top..bottom)
+                const bool down = ay < by;
+                polyfill_edge_t* e = &p->edges[p->count++];
+                e->x = down ? ax : bx;
+                e->dx = down ? bx - ax : ax - bx;
+                e->dy = abs(by - ay);
+                e->y0 = min(ay, by);
+                e->y1 = max(ay, by);
+                e->winding = down ? 1 : -1;
+                e->key = e->x + 0.5 * e->dx / e->dy;
+            }
+        }
+        p->bounds = (ui_rect_t){ x0, y0, x1 - x0, y1 - y0 };
+        qsort(p->edges, (size_t)p->count, sizeof(polyfill_edge_t),
+              polyfill_compare);
+    }
+    return same;
+}
+
+static void* polyfill_scratch(polyfill_t* p, int64_t bytes) {
+    if (p->scratch_bytes < bytes) {
+        p->scratch = realloc(p->scratch, (size_t)bytes);
+        fatal_if_null(p->scratch);
+        p->scratch_bytes = bytes;
+    }
+    return p->scratch;
+}
+
+static inline int64_t polyfill_floor_div(int64_t a, int64_t b) { // b > 0
+    const int64_t q = a / b;
+    return q * b > a ? q - 1 : q;
+}
+
+// polyfill_active() of edge at the center of row y
+
+static polyfill_active_t polyfill_active(const polyfill_edge_t* e, int32_t y) {
+    // x = e.x + (2 * (y - e.y0) + 1) * dx / (2 * dy)
+    const int64_t den = 2 * (int64_t)e->dy;
+    const int64_t n = (2 * ((int64_t)y - e->y0) + 1) * e->dx;
+    const int64_t q = polyfill_floor_div(n, den);
+    const int64_t s = polyfill_floor_div(2 * (int64_t)e->dx, den);
+    return (polyfill_active_t){
+        .xi = e->x + (int32_t)q, .y1 = e->y1, .num = n - q * den, .den = den,
+        .rn = 2 * (int64_t)e->dx - s * den, .qi = (int32_t)s,
+        .winding = e->winding
+    };
+}
+
+static inline void polyfill_advance(polyfill_active_t* a) {
+    a->xi += a->qi;
+    a->num += a->rn;
+    if (a->num >= a->den) { a->num -= a->den; a->xi++; }
+}
+
+static inline bool polyfill_less(const polyfill_active_t* a,
+        const polyfill_active_t* b) {
+    return a->xi != b->xi ? a->xi < b->xi : a->num * b->den < b->num * a->den;
+}
+
+// polyfill_sort() insertion sort by x: fast for nearly sorted edges
+
+static void polyfill_sort(polyfill_active_t* a, int32_t n) {
+    for (int32_t i = 1; i < n; i++) {
+        if (polyfill_less(&a[i], &a[i - 1])) {
+            const polyfill_active_t e = a[i];
+            int32_t j = i;
+            while (j > 0 && polyfill_less(&e, &a[j - 1])) { a[j] = a[j - 1]; j--; }
+            a[j] = e;
+        }
+    }
+}
+
+static void polyfill_merge(polyfill_active_t* d, const polyfill_active_t* a,
+        int32_t na, const polyfill_active_t* b, int32_t nb) {
+    int32_t i = 0;
+    int32_t j = 0;
+    while (i < na && j < nb) {
+        *d++ = polyfill_less(&b[j], &a[i]) ? b[j++] : a[i++];
+    }
+    while (i < na) { *d++ = a[i++]; }
+    while (j < nb) { *d++ = b[j++]; }
+}
+
+// polyfill_spans() of the row from active edges sorted by x, returns count
+
+static int32_t polyfill_spans(const polyfill_active_t* a, int32_t n,
+        int32_t rule, int32_t cx0, int32_t cx1, polyfill_span_t* spans) {
+    int32_t k = 0;
+    int32_t winding = 0;
+    int32_t start = 0;
+    for (int32_t i = 0; i < n; i++) {
+        const bool inside = rule == polyfill_even_odd ?
+            (i & 1) != 0 : winding != 0;
+        winding += a[i].winding;
+        const bool next = rule == polyfill_even_odd ?
+            (i & 1) == 0 : winding != 0;
+        // first pixel with center x + 0.5 >= edge x:
+        const int32_t x = a[i].xi + (2 * a[i].num > a[i].den);
+        if (!inside && next) {
+            start = x;
+        } else if (inside && !next) {
+            const int32_t x0 = max(start, cx0);
+            const int32_t x1 = min(x, cx1);
+            if (x0 < x1) {
+                if (k > 0 && spans[k - 1].x1 >= x0) { // touching spans
+                    spans[k - 1].x1 = max(spans[k - 1].x1, x1);
+                } else {
+                    spans[k++] = (polyfill_span_t){ x0, x1 };
+                }
+            }
+        }
+    }
+    return k;
+}
+
+static void polyfill_fill(polyfill_t* p, int32_t rule, const ui_rect_t* clip,
+        void* that, void (*span)(void* that, int32_t x, int32_t y,
+        int32_t w, int32_t h)) {
+    fatal_if(rule != polyfill_even_odd && rule != polyfill_non_zero,
+        "rule: %d", rule);
+    if (p->count == 0) { return; }
+    const int32_t ox = p->origin.x;
+    const int32_t oy = p->origin.y;
+    // clip relative to origin:
+    int32_t cx0 = p->bounds.x;
+    int32_t cy0 = p->bounds.y;
+    int32_t cx1 = p->bounds.x + p->bounds.w;
+    int32_t cy1 = p->bounds.y + p->bounds.h;
+    if (clip != null) {
+        cx0 = (int32_t)max((int64_t)cx0, (int64_t)clip->x - ox);
+        cy0 = (int32_t)max((int64_t)cy0, (int64_t)clip->y - oy);
+        cx1 = (int32_t)min((int64_t)cx1, (int64_t)clip->x + clip->w - ox);
+        cy1 = (int32_t)min((int64_t)cy1, (int64_t)clip->y + clip->h - oy);
+    }
+    if (cx0 >= cx1 || cy0 >= cy1) { return; }
+    // at most count active edges (twice for merging) and count / 2 spans
+    // in each of two rows:
+    uint8_t* s = (uint8_t*)polyfill_scratch(p, (int64_t)p->count *
+        (2 * sizeof(polyfill_active_t) + sizeof(polyfill_span_t)) +
+        2 * sizeof(polyfill_span_t));
+    polyfill_active_t* active = (polyfill_active_t*)s;
+    polyfill_active_t* merged = active + p->count;
+    polyfill_span_t* spans[2] = {
+        (polyfill_span_t*)(merged + p->count),
+        (polyfill_span_t*)(merged + p->count) + p->count / 2 + 1
+    };
+    int32_t counts[2] = { 0, 0 };
+    int32_t n = 0; // active edges
+    int32_t next = 0; // first edge of p->edges not yet active
+    int32_t run = cy0; // first row of the run of identical spans
+    int32_t cur = 0;   // spans[cur] of the run
+    for (int32_t y = cy0; y <= cy1; y++) {
+        int32_t k = 0;
+        if (y < cy1) {
+            // drop edges below the row and advance the rest:
+            int32_t j = 0;
+            for (int32_t i = 0; i < n; i++) {
+                if (active[i].y1 > y) {
+                    active[j] = active[i];
+                    if (y > cy0) { polyfill_advance(&active[j]); }
+                    j++;
+                }
+            }
+            n = j;
+            polyfill_sort(active, n); // order changes only where edges cross
+            // edges that start at the row (or above the clip) sorted by x
+            // are merged with active edges:
+            const int32_t m = n;
+            while (next < p->count && p->edges[next].y0 <= y) {
+                const polyfill_edge_t* e = &p->edges[next++];
+                if (e->y1 > y) {
+                    active[n++] = polyfill_active(e, y);
+                }
+            }
+            if (n > m) {
+                polyfill_sort(active + m, n - m);
+                polyfill_merge(merged, active, m, active + m, n - m);
+                polyfill_active_t* t = active; active = merged; merged = t;
+            }
+            const int32_t other = 1 - cur;
+            k = polyfill_spans(active, n, rule, cx0, cx1, spans[other]);
+            counts[other] = k;
+            if (y > run && k == counts[cur] && memcmp(spans[other], spans[cur],
+                    (size_t)k * sizeof(polyfill_span_t)) == 0) {
+                continue; // same spans as the row above: extend the run
+            }
+        }
+        for (int32_t i = 0; i < counts[cur] && y > run; i++) {
+            const polyfill_span_t* r = &spans[cur][i];
+            span(that, r->x0 + ox, run + oy, r->x1 - r->x0, y - run);
+        }
+        run = y;
+        cur = 1 - cur;
+        if (y >= cy1 || (n == 0 && next == p->count)) { break; }
+    }
+}
+
+static void polyfill_dispose(polyfill_t* p) {
+    free(p->edges);
+    free(p->vertices);
+    free(p->scratch);
+    memset(p, 0, sizeof(*p));
+}
+
+polyfill_if polyfill = {
+    .edges   = polyfill_edges,
+    .fill    = polyfill_fill,
+    .dispose = polyfill_dispose
+};
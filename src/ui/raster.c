@@ -0,0 +1,1346 @@
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define raster_sse2
+#endif
+
+// Win32 GDI implementation of gdi_t captured by raster_install() used
+// by threads without current software rendering context:
+
+static gdi_t raster_gdi;
+
+static thread_local raster_context_t* raster_rc;
+
+typedef struct raster_object_s { // software pen or brush
+    ui_color_t color;
+    int32_t width; // pen width in pixels
+} raster_object_t;
+
+static raster_object_t raster_dc_pen; // see gdi.set_colored_pen()
+
+// Pens and brushes created inside raster.begin()/end() are heap objects
+// registered in raster_objects. Anything else selected into the context
+// is a Win32 GDI handle (gdi.create_pen() before raster.begin()) that is
+// never dereferenced but resolved by GetObject() when selected.
+
+static struct {
+    raster_object_t** objects;
+    int32_t count;
+    int32_t capacity;
+    SRWLOCK lock;
+} raster_objects = { .lock = SRWLOCK_INIT };
+
+static void raster_object_register(raster_object_t* o) {
+    AcquireSRWLockExclusive(&raster_objects.lock);
+    if (raster_objects.count == raster_objects.capacity) {
+        const int32_t n = raster_objects.capacity * 2 + 16;
+        raster_object_t** objects = (raster_object_t**)realloc(
+            raster_objects.objects, n * sizeof(raster_object_t*));
+        fatal_if_null(objects);
+        raster_objects.objects = objects;
+        raster_objects.capacity = n;
+    }
+    raster_objects.objects[raster_objects.count++] = o;
+    ReleaseSRWLockExclusive(&raster_objects.lock);
+}
+
+// raster_object_unregister() returns false for Win32 GDI handles
+
+static bool raster_object_unregister(void* handle) {
+    bool found = false;
+    AcquireSRWLockExclusive(&raster_objects.lock);
+    for (int32_t i = 0; i < raster_objects.count && !found; i++) {
+        if (raster_objects.objects[i] == (raster_object_t*)handle) {
+            raster_objects.objects[i] =
+                raster_objects.objects[--raster_objects.count];
+            found = true;
+        }
+    }
+    ReleaseSRWLockExclusive(&raster_objects.lock);
+    return found;
+}
+
+// raster_object() copies raster object or returns false for Win32 handle
+
+static bool raster_object(void* handle, raster_object_t* o) {
+    bool found = false;
+    AcquireSRWLockShared(&raster_objects.lock);
+    for (int32_t i = 0; i < raster_objects.count && !found; i++) {
+        if (raster_objects.objects[i] == (raster_object_t*)handle) {
+            *o = *raster_objects.objects[i];
+            found = true;
+        }
+    }
+    ReleaseSRWLockShared(&raster_objects.lock);
+    return found;
+}
+
+static void raster_resolve_pen(raster_state_t* st, ui_pen_t p) {
+    raster_object_t o = {0};
+    if (p == gdi.pen_hollow) {
+        st->pen_width = 0;
+    } else if (p == (ui_pen_t)&raster_dc_pen) {
+        st->pen_width = 1; // color is state.pen_color
+    } else if (raster_object(p, &o)) {
+        st->pen_rgb = o.color;
+        st->pen_width = o.width;
+    } else {
+        LOGPEN lp = {0};
+        fatal_if(GetObjectType((HGDIOBJ)p) != OBJ_PEN ||
+                 GetObject((HGDIOBJ)p, sizeof(lp), &lp) != sizeof(lp),
+                 "%p is not a pen of gdi.create_pen()", p);
+        st->pen_rgb = (ui_color_t)lp.lopnColor;
+        st->pen_width = lp.lopnStyle == PS_NULL ? 0 : max(1, lp.lopnWidth.x);
+    }
+}
+
+static void raster_resolve_brush(raster_state_t* st, ui_brush_t b) {
+    raster_object_t o = {0};
+    if (b == gdi.brush_hollow || b == gdi.brush_color) {
+        // color is state.brush_color
+    } else if (raster_object(b, &o)) {
+        st->brush_rgb = o.color;
+    } else {
+        LOGBRUSH lb = {0};
+        fatal_if(GetObjectType((HGDIOBJ)b) != OBJ_BRUSH ||
+                 GetObject((HGDIOBJ)b, sizeof(lb), &lb) != sizeof(lb) ||
+                 lb.lbStyle != BS_SOLID,
+                 "%p is not a solid brush of gdi.create_brush()", b);
+        st->brush_rgb = (ui_color_t)lb.lbColor;
+    }
+}
+
+static inline uint32_t raster_bgra(ui_color_t c) { // opaque
+    if (color_is_hdr(c)) { c = color_hdr_to_rgb(c); }
+    assert(color_is_8bit(c));
+    return 0xFF000000u | (((uint32_t)c & 0xFF) << 16) |
+           ((uint32_t)c & 0xFF00) | (((uint32_t)c >> 16) & 0xFF);
+}
+
+static inline uint32_t* raster_row(raster_context_t* rc, int32_t y) {
+    return (uint32_t*)((uint8_t*)rc->image->pixels +
+        (int64_t)y * rc->image->stride);
+}
+
+// clip rectangle [x..x + w) [y..y + h) to the context clip
+
+static bool raster_clip(raster_context_t* rc, int32_t* x, int32_t* y,
+        int32_t* w, int32_t* h) {
+    const ui_rect_t* c = &rc->state.clip;
+    int32_t x0 = max(*x, c->x);
+    int32_t y0 = max(*y, c->y);
+    int32_t x1 = min(*x + *w, c->x + c->w);
+    int32_t y1 = min(*y + *h, c->y + c->h);
+    *x = x0;
+    *y = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return *w > 0 && *h > 0;
+}
+
+static void raster_fill_span(uint32_t* d, int32_t n, uint32_t bgra) {
+    int32_t i = 0;
+    #ifdef raster_sse2
+        const __m128i v = _mm_set1_epi32((int32_t)bgra);
+        for (; i + 4 <= n; i += 4) { _mm_storeu_si128((__m128i*)(d + i), v); }
+    #endif
+    for (; i < n; i++) { d[i] = bgra; }
+}
+
+static inline uint32_t raster_div255(uint32_t v) { // exact for [0..255*255]
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+static inline uint32_t raster_over(uint32_t d, uint32_t s, uint32_t alpha) {
+    const uint32_t b = raster_div255(((s >>  0) & 0xFF) * alpha);
+    const uint32_t g = raster_div255(((s >>  8) & 0xFF) * alpha);
+    const uint32_t r = raster_div255(((s >> 16) & 0xFF) * alpha);
+    const uint32_t a = raster_div255(((s >> 24) & 0xFF) * alpha);
+    const uint32_t ia = 255 - a;
+    return (b + raster_div255(((d >>  0) & 0xFF) * ia)) <<  0 |
+           (g + raster_div255(((d >>  8) & 0xFF) * ia)) <<  8 |
+           (r + raster_div255(((d >> 16) & 0xFF) * ia)) << 16 |
+           (a + raster_div255(((d >> 24) & 0xFF) * ia)) << 24;
+}
+
+#ifdef raster_sse2
+
+static inline __m128i raster_div255_epi16(__m128i v) {
+    v = _mm_add_epi16(v, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+// two pixels unpacked to 16 bit lanes:
+
+static inline __m128i raster_over_epi16(__m128i d, __m128i s, __m128i alpha) {
+    s = raster_div255_epi16(_mm_mullo_epi16(s, alpha));
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+    const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return _mm_add_epi16(s, raster_div255_epi16(_mm_mullo_epi16(d, ia)));
+}
+
+#endif
+
+static void raster_blend_span(uint32_t* d, const uint32_t* s, int32_t n,
+        int32_t alpha) {
+    assert(0 <= alpha && alpha <= 255);
+    int32_t i = 0;
+    #ifdef raster_sse2
+        const __m128i z = _mm_setzero_si128();
+        const __m128i a = _mm_set1_epi16((int16_t)alpha);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i sp = _mm_loadu_si128((const __m128i*)(s + i));
+            const __m128i dp = _mm_loadu_si128((const __m128i*)(d + i));
+            const __m128i lo = raster_over_epi16(_mm_unpacklo_epi8(dp, z),
+                _mm_unpacklo_epi8(sp, z), a);
+            const __m128i hi = raster_over_epi16(_mm_unpackhi_epi8(dp, z),
+                _mm_unpackhi_epi8(sp, z), a);
+            _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+        }
+    #endif
+    for (; i < n; i++) { d[i] = raster_over(d[i], s[i], (uint32_t)alpha); }
+}
+
+// raster_cover_span() premultiplied bgra over destination with per pixel
+// coverage [0..255] (anti-aliased edges): zero runs are skipped and fully
+// covered runs of opaque color are stored
+
+static void raster_cover_span(uint32_t* d, const uint8_t* cover, int32_t n,
+        uint32_t bgra) {
+    const bool opaque = (bgra >> 24) == 0xFF;
+    int32_t i = 0;
+    #ifdef raster_sse2
+        const __m128i z = _mm_setzero_si128();
+        const __m128i c = _mm_set1_epi32((int32_t)bgra);
+        const __m128i s = _mm_unpacklo_epi8(c, z);
+        for (; i + 4 <= n; i += 4) {
+            uint32_t c4;
+            memcpy(&c4, cover + i, sizeof(c4));
+            if (c4 == 0) {
+                continue;
+            } else if (c4 == 0xFFFFFFFFu && opaque) {
+                _mm_storeu_si128((__m128i*)(d + i), c);
+            } else {
+                __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int32_t)c4), z);
+                a = _mm_unpacklo_epi16(a, a); // c0 c0 c1 c1 c2 c2 c3 c3
+                const __m128i dp = _mm_loadu_si128((const __m128i*)(d + i));
+                const __m128i lo = raster_over_epi16(_mm_unpacklo_epi8(dp, z),
+                    s, _mm_unpacklo_epi32(a, a));
+                const __m128i hi = raster_over_epi16(_mm_unpackhi_epi8(dp, z),
+                    s, _mm_unpackhi_epi32(a, a));
+                _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+            }
+        }
+    #endif
+    for (; i < n; i++) {
+        if (cover[i] == 255 && opaque) {
+            d[i] = bgra;
+        } else if (cover[i] != 0) {
+            d[i] = raster_over(d[i], bgra, cover[i]);
+        }
+    }
+}
+
+// raster_coverage() of the pixel by the shape at signed distance `d`
+// from pixel center to the outline (negative inside)
+
+static inline uint8_t raster_coverage(double d) {
+    return d <= -0.5 ? 255 : d >= 0.5 ? 0 : (uint8_t)((0.5 - d) * 255 + 0.5);
+}
+
+static void raster_fill_rect(raster_context_t* rc, int32_t x, int32_t y,
+        int32_t w, int32_t h, uint32_t bgra) {
+    if (raster_clip(rc, &x, &y, &w, &h)) {
+        for (int32_t i = 0; i < h; i++) {
+            raster_fill_span(raster_row(rc, y + i) + x, w, bgra);
+        }
+    }
+}
+
+static bool raster_brush(raster_context_t* rc, uint32_t* bgra) {
+    const ui_brush_t b = rc->state.brush;
+    if (b == gdi.brush_hollow) {
+        return false;
+    } else if (b == gdi.brush_color) {
+        *bgra = raster_bgra(rc->state.brush_color);
+    } else {
+        *bgra = raster_bgra(rc->state.brush_rgb);
+    }
+    return true;
+}
+
+static int32_t raster_pen(raster_context_t* rc, uint32_t* bgra) {
+    const ui_pen_t p = rc->state.pen;
+    if (p == (ui_pen_t)&raster_dc_pen) {
+        *bgra = raster_bgra(rc->state.pen_color);
+    } else if (rc->state.pen_width > 0) {
+        *bgra = raster_bgra(rc->state.pen_rgb);
+    }
+    return rc->state.pen_width;
+}
+
+// raster_plot() pen of `width` pixels centered at x, y
+
+static void raster_plot(raster_context_t* rc, int32_t x, int32_t y,
+        int32_t width, uint32_t bgra) {
+    const int32_t o = (width - 1) / 2;
+    raster_fill_rect(rc, x - o, y - o, width, width, bgra);
+}
+
+// raster_capsule() anti-aliased segment from x0, y0 to x1, y1 with round
+// caps of radius r. Coverage is from the distance of pixel centers to the
+// segment: only the pixels that can be reached from the segment in each
+// row are visited.
+
+static void raster_capsule(raster_context_t* rc, double x0, double y0,
+        double x1, double y1, double r, uint32_t bgra) {
+    const double dx = x1 - x0;
+    const double dy = y1 - y0;
+    const double dd = dx * dx + dy * dy;
+    const double e = r + 1; // reach of the coverage
+    int32_t bx = (int32_t)floor(min(x0, x1) - e);
+    int32_t by = (int32_t)floor(min(y0, y1) - e);
+    int32_t bw = (int32_t)ceil(max(x0, x1) + e) - bx;
+    int32_t bh = (int32_t)ceil(max(y0, y1) + e) - by;
+    if (!raster_clip(rc, &bx, &by, &bw, &bh)) { return; }
+    uint8_t* cover = (uint8_t*)malloc((size_t)bw);
+    fatal_if_null(cover);
+    for (int32_t j = by; j < by + bh; j++) {
+        const double py = j + 0.5 - y0;
+        double xl = min(x0, x1);
+        double xr = max(x0, x1);
+        if (dy != 0) {
+            const double ta = min(1.0, max(0.0, (py - e) / dy));
+            const double tb = min(1.0, max(0.0, (py + e) / dy));
+            xl = x0 + min(ta, tb) * dx;
+            xr = x0 + max(ta, tb) * dx;
+            if (xl > xr) { const double t = xl; xl = xr; xr = t; }
+        }
+        const int32_t i0 = max(bx, (int32_t)floor(xl - e));
+        const int32_t i1 = min(bx + bw, (int32_t)ceil(xr + e));
+        for (int32_t i = i0; i < i1; i++) {
+            const double px = i + 0.5 - x0;
+            const double t = dd == 0 ? 0 :
+                min(1.0, max(0.0, (px * dx + py * dy) / dd));
+            const double ex = px - t * dx;
+            const double ey = py - t * dy;
+            cover[i - i0] = raster_coverage(sqrt(ex * ex + ey * ey) - r);
+        }
+        if (i0 < i1) {
+            raster_cover_span(raster_row(rc, j) + i0, cover, i1 - i0, bgra);
+        }
+    }
+    free(cover);
+}
+
+// raster_segment() Bresenham line from x0, y0 to x1, y1 excluding
+// the last point (like Win32 LineTo()) or anti-aliased capsule
+
+static void raster_segment(raster_context_t* rc, int32_t x0, int32_t y0,
+        int32_t x1, int32_t y1) {
+    uint32_t c = 0;
+    const int32_t width = raster_pen(rc, &c);
+    if (width > 0 && rc->antialiased) { // through pixel centers
+        raster_capsule(rc, x0 + 0.5, y0 + 0.5, x1 + 0.5, y1 + 0.5,
+            width / 2.0, c);
+    } else if (width > 0) {
+        if (y0 == y1 && width == 1) { // horizontal span
+            const int32_t x = min(x0, x1 + (x1 < x0));
+            raster_fill_rect(rc, x, y0, abs(x1 - x0), 1, c);
+        } else if (x0 == x1 && width == 1) { // vertical span
+            const int32_t y = min(y0, y1 + (y1 < y0));
+            raster_fill_rect(rc, x0, y, 1, abs(y1 - y0), c);
+        } else {
+            const int32_t dx =  abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+            const int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+            int32_t e = dx + dy;
+            while (x0 != x1 || y0 != y1) {
+                raster_plot(rc, x0, y0, width, c);
+                const int32_t e2 = 2 * e;
+                if (e2 >= dy) { e += dy; x0 += sx; }
+                if (e2 <= dx) { e += dx; y0 += sy; }
+            }
+        }
+    }
+}
+
+static ui_color_t raster_set_text_color(ui_color_t c) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_text_color(c); }
+    const ui_color_t previous = rc->state.text_color;
+    rc->state.text_color = c;
+    return previous;
+}
+
+static raster_object_t* raster_create_object(ui_color_t c, int32_t width) {
+    raster_object_t* o = (raster_object_t*)malloc(sizeof(raster_object_t));
+    fatal_if_null(o);
+    o->color = c;
+    o->width = width;
+    raster_object_register(o);
+    return o;
+}
+
+static ui_brush_t raster_create_brush(ui_color_t c) {
+    if (raster_rc == null) { return raster_gdi.create_brush(c); }
+    return (ui_brush_t)raster_create_object(c, 0);
+}
+
+static void raster_delete_brush(ui_brush_t b) {
+    not_null(b);
+    if (raster_object_unregister(b)) {
+        free(b);
+    } else {
+        raster_gdi.delete_brush(b);
+    }
+}
+
+static ui_color_t raster_set_brush_color(ui_color_t c) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_brush_color(c); }
+    const ui_color_t previous = rc->state.brush_color;
+    rc->state.brush_color = c;
+    return previous;
+}
+
+static ui_brush_t raster_set_brush(ui_brush_t b) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_brush(b); }
+    not_null(b);
+    const ui_brush_t previous = rc->state.brush;
+    raster_resolve_brush(&rc->state, b);
+    rc->state.brush = b;
+    return previous;
+}
+
+static ui_pen_t raster_set_colored_pen(ui_color_t c) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_colored_pen(c); }
+    const ui_pen_t previous = rc->state.pen;
+    rc->state.pen = (ui_pen_t)&raster_dc_pen;
+    rc->state.pen_color = c;
+    rc->state.pen_width = 1;
+    return previous;
+}
+
+static ui_pen_t raster_create_pen(ui_color_t c, int32_t width) {
+    if (raster_rc == null) { return raster_gdi.create_pen(c, width); }
+    assert(width >= 1);
+    return (ui_pen_t)raster_create_object(c, width);
+}
+
+static ui_pen_t raster_set_pen(ui_pen_t p) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_pen(p); }
+    not_null(p);
+    const ui_pen_t previous = rc->state.pen;
+    raster_resolve_pen(&rc->state, p);
+    rc->state.pen = p;
+    return previous;
+}
+
+static void raster_delete_pen(ui_pen_t p) {
+    not_null(p);
+    assert(p != (ui_pen_t)&raster_dc_pen && p != gdi.pen_hollow);
+    if (raster_object_unregister(p)) {
+        free(p);
+    } else {
+        raster_gdi.delete_pen(p);
+    }
+}
+
+static void raster_set_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.set_clip(x, y, w, h);
+    } else {
+        rc->state.clip = (ui_rect_t){0, 0, rc->image->w, rc->image->h};
+        if (w > 0 && h > 0) {
+            // empty intersection is kept as empty clip: nothing is drawn
+            if (!raster_clip(rc, &x, &y, &w, &h)) { w = 0; h = 0; }
+            rc->state.clip = (ui_rect_t){x, y, w, h};
+        }
+    }
+}
+
+static void raster_intersect_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.intersect_clip(x, y, w, h);
+    } else {
+        const ui_rect_t* c = &rc->state.clip;
+        if (!raster_clip(rc, &x, &y, &w, &h)) { x = c->x; y = c->y; w = 0; h = 0; }
+        rc->state.clip = (ui_rect_t){x, y, w, h};
+    }
+}
+
+static bool raster_visible(int32_t x, int32_t y, int32_t w, int32_t h) {
+    raster_context_t* rc = raster_rc;
+    return rc == null ? raster_gdi.visible(x, y, w, h) :
+                        raster_clip(rc, &x, &y, &w, &h);
+}
+
+static void raster_push(int32_t x, int32_t y) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.push(x, y);
+    } else {
+        fatal_if(rc->top >= countof(rc->stack));
+        rc->stack[rc->top] = rc->state;
+        rc->top++;
+        rc->state.x = x;
+        rc->state.y = y;
+    }
+}
+
+static void raster_pop(void) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.pop();
+    } else {
+        fatal_if(rc->top <= 0);
+        rc->top--;
+        rc->state = rc->stack[rc->top];
+    }
+}
+
+static void raster_pixel(int32_t x, int32_t y, ui_color_t c) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.pixel(x, y, c);
+    } else {
+        raster_fill_rect(rc, x, y, 1, 1, raster_bgra(c));
+    }
+}
+
+static ui_point_t raster_move_to(int32_t x, int32_t y) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.move_to(x, y); }
+    ui_point_t pt = { rc->state.x, rc->state.y };
+    rc->state.x = x;
+    rc->state.y = y;
+    return pt;
+}
+
+static void raster_line(int32_t x, int32_t y) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.line(x, y);
+    } else {
+        raster_segment(rc, rc->state.x, rc->state.y, x, y);
+        rc->state.x = x;
+        rc->state.y = y;
+    }
+}
+
+// raster_rect() follows Win32 Rectangle(): pen is centered on the
+// outline and with hollow pen the filled area is one pixel smaller
+// on the right and bottom
+
+static void raster_rect(int32_t x, int32_t y, int32_t w, int32_t h) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.rect(x, y, w, h);
+    } else {
+        uint32_t fc = 0;
+        uint32_t pc = 0;
+        const bool fill = raster_brush(rc, &fc);
+        const int32_t pw = raster_pen(rc, &pc);
+        if (pw == 0) {
+            if (fill) { raster_fill_rect(rc, x, y, w - 1, h - 1, fc); }
+        } else {
+            const int32_t o = (pw - 1) / 2; // outside of the outline
+            const int32_t i = pw - 1 - o;   // inside
+            if (fill) {
+                raster_fill_rect(rc, x + i + 1, y + i + 1,
+                    w - 2 * (i + 1), h - 2 * (i + 1), fc);
+            }
+            const int32_t l = x - o;
+            const int32_t t = y - o;
+            const int32_t ow = w + 2 * o;
+            const int32_t oh = h + 2 * o;
+            raster_fill_rect(rc, l, t, ow, pw, pc);
+            raster_fill_rect(rc, l, t + oh - pw, ow, pw, pc);
+            raster_fill_rect(rc, l, t + pw, pw, oh - 2 * pw, pc);
+            raster_fill_rect(rc, l + ow - pw, t + pw, pw, oh - 2 * pw, pc);
+        }
+    }
+}
+
+static void raster_fill(int32_t x, int32_t y, int32_t w, int32_t h) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.fill(x, y, w, h);
+    } else {
+        uint32_t c = 0;
+        if (raster_brush(rc, &c)) { raster_fill_rect(rc, x, y, w, h, c); }
+    }
+}
+
+static void raster_poly(ui_point_t* points, int32_t count) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.poly(points, count);
+    } else {
+        assert(count > 1);
+        for (int32_t i = 1; i < count; i++) {
+            raster_segment(rc, points[i - 1].x, points[i - 1].y,
+                               points[i].x, points[i].y);
+        }
+    }
+}
+
+typedef struct raster_polyfill_s {
+    raster_context_t* rc;
+    uint32_t bgra;
+} raster_polyfill_t;
+
+static void raster_polyfill_span(void* that, int32_t x, int32_t y,
+        int32_t w, int32_t h) {
+    const raster_polyfill_t* f = (const raster_polyfill_t*)that;
+    raster_fill_rect(f->rc, x, y, w, h, f->bgra);
+}
+
+// raster_polyfill() gdi.polygon() is filled by scanline spans (aliased,
+// see raster.polygon() for anti-aliased polygons)
+
+static void raster_polyfill(ui_point_t* points, int32_t count, int32_t rule) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.polygon(points, count, rule);
+    } else {
+        raster_polyfill_t f = { rc, 0 };
+        if (raster_brush(rc, &f.bgra)) {
+            gdi_polygon_spans(points, count, rule, &rc->state.clip, &f,
+                raster_polyfill_span);
+        }
+    }
+}
+
+// raster_inset() horizontal inset of the row `j` [0..h) of rounded
+// rectangle `h` pixels high with corner ellipse semi-axes a, b
+
+static int32_t raster_inset(int32_t j, int32_t h, double a, double b) {
+    const double cy = j + 0.5;
+    double dy = 0;
+    if (cy < b) {
+        dy = b - cy;
+    } else if (cy > h - b) {
+        dy = cy - (h - b);
+    }
+    if (dy <= 0 || b <= 0) {
+        return 0;
+    } else {
+        const double t = dy / b;
+        return (int32_t)(a - a * sqrt(max(0.0, 1.0 - t * t)) + 0.5);
+    }
+}
+
+// raster_rounded_distance() signed distance from px, py to the outline of
+// rounded rectangle centered at 0, 0 with half sizes hw, hh and corner
+// ellipse semi-axes a, b
+
+static double raster_rounded_distance(double px, double py, double hw,
+        double hh, double a, double b) {
+    const double qx = fabs(px) - (hw - a);
+    const double qy = fabs(py) - (hh - b);
+    if (qx <= 0 || qy <= 0 || a <= 0 || b <= 0) {
+        return max(qx - a, qy - b);
+    } else if (a == b) {
+        return sqrt(qx * qx + qy * qy) - a;
+    } else { // first order approximation of the distance to ellipse
+        const double k0 = sqrt(qx * qx / (a * a) + qy * qy / (b * b));
+        const double k1 = sqrt(qx * qx / (a * a * a * a) +
+                               qy * qy / (b * b * b * b));
+        return k0 * (k0 - 1) / k1;
+    }
+}
+
+// raster_rounded_aa() pen is drawn with the outer shape coverage except
+// fully filled pixels and then brush with the shape inset by pen width:
+// partially covered pixels on the inner edge of the pen blend pen and
+// brush colors without the background showing through.
+
+static void raster_rounded_aa(raster_context_t* rc, int32_t x, int32_t y,
+        int32_t w, int32_t h, double a, double b, int32_t pw,
+        const uint32_t* fc, uint32_t pc) { // fc == null: hollow brush
+    int32_t cx0 = x;
+    int32_t cy0 = y;
+    int32_t cw = w;
+    int32_t ch = h;
+    if (!raster_clip(rc, &cx0, &cy0, &cw, &ch)) { return; }
+    uint8_t* co = (uint8_t*)malloc((size_t)cw * 2); // outer shape coverage
+    fatal_if_null(co);
+    uint8_t* ci = co + cw; // inner shape coverage
+    const double hw = w / 2.0;
+    const double hh = h / 2.0;
+    const double cx = x + hw;
+    const double cy = y + hh;
+    // coverage of the middle columns only depends on the row:
+    const double m = hw - max(a, (double)pw) - 1;
+    const int32_t m0 = m < 0 ? cx0 :
+        min(cx0 + cw, max(cx0, (int32_t)ceil(cx - m - 0.5)));
+    const int32_t m1 = m < 0 ? cx0 :
+        min(cx0 + cw, max(m0, (int32_t)floor(cx + m - 0.5) + 1));
+    for (int32_t j = cy0; j < cy0 + ch; j++) {
+        const double py = j + 0.5 - cy;
+        for (int32_t i = cx0; i < cx0 + cw; i++) {
+            if (i == m0 && m0 < m1) {
+                const double d = fabs(py) - hh;
+                memset(co + (m0 - cx0), raster_coverage(d), m1 - m0);
+                memset(ci + (m0 - cx0), raster_coverage(d + pw), m1 - m0);
+                i = m1 - 1;
+            } else {
+                const double d = raster_rounded_distance(i + 0.5 - cx, py,
+                    hw, hh, a, b);
+                co[i - cx0] = raster_coverage(d);
+                ci[i - cx0] = raster_coverage(d + pw);
+            }
+        }
+        uint32_t* row = raster_row(rc, j) + cx0;
+        if (pw == 0) {
+            if (fc != null) { raster_cover_span(row, co, cw, *fc); }
+        } else if (fc != null) {
+            for (int32_t i = 0; i < cw; i++) { if (ci[i] == 255) { co[i] = 0; } }
+            raster_cover_span(row, co, cw, pc);
+            raster_cover_span(row, ci, cw, *fc);
+        } else {
+            for (int32_t i = 0; i < cw; i++) { co[i] -= ci[i]; }
+            raster_cover_span(row, co, cw, pc);
+        }
+    }
+    free(co);
+}
+
+static void raster_rounded(int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t rx, int32_t ry) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.rounded(x, y, w, h, rx, ry);
+    } else {
+        uint32_t fc = 0;
+        uint32_t pc = 0;
+        const bool fill = raster_brush(rc, &fc);
+        const int32_t pw = raster_pen(rc, &pc);
+        if (pw == 0) { w--; h--; } // see raster_rect()
+        const double a = min(rx, w) / 2.0;
+        const double b = min(ry, h) / 2.0;
+        if (rc->antialiased) {
+            raster_rounded_aa(rc, x, y, w, h, a, b, pw, fill ? &fc : null, pc);
+            return;
+        }
+        const double ai = max(0.0, a - pw);
+        const double bi = max(0.0, b - pw);
+        for (int32_t j = 0; j < h; j++) {
+            const int32_t inset = raster_inset(j, h, a, b);
+            const int32_t l = x + inset;
+            const int32_t r = x + w - inset;
+            if (j < pw || j >= h - pw) {
+                raster_fill_rect(rc, l, y + j, r - l, 1, pc);
+            } else {
+                const int32_t ii = raster_inset(j - pw, h - 2 * pw, ai, bi);
+                const int32_t il = max(l + pw, x + pw + ii);
+                const int32_t ir = min(r - pw, x + w - pw - ii);
+                if (pw > 0) {
+                    raster_fill_rect(rc, l, y + j, il - l, 1, pc);
+                    raster_fill_rect(rc, ir, y + j, r - ir, 1, pc);
+                }
+                if (fill) { raster_fill_rect(rc, il, y + j, ir - il, 1, fc); }
+            }
+        }
+    }
+}
+
+// raster_lerp() color i/n of the way from rgba c0 to c1 as BGRA
+
+static uint32_t raster_lerp(ui_color_t c0, ui_color_t c1, int64_t i,
+        int64_t n) {
+    static const int32_t shift[4] = { 16, 8, 0, 24 }; // r g b a
+    uint32_t bgra = 0;
+    for (int32_t k = 0; k < 4; k++) {
+        const int64_t v0 = (c0 >> (k * 8)) & 0xFF;
+        const int64_t v1 = (c1 >> (k * 8)) & 0xFF;
+        const int64_t v = n == 0 ? v0 : v0 + (v1 - v0) * i / n;
+        bgra |= (uint32_t)v << shift[k];
+    }
+    return bgra;
+}
+
+static void raster_gradient(int32_t x, int32_t y, int32_t w, int32_t h,
+        ui_color_t rgba_from, ui_color_t rgba_to, bool vertical) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.gradient(x, y, w, h, rgba_from, rgba_to, vertical);
+    } else {
+        int32_t cx = x;
+        int32_t cy = y;
+        int32_t cw = w;
+        int32_t ch = h;
+        if (raster_clip(rc, &cx, &cy, &cw, &ch)) {
+            uint32_t (*lerp)(ui_color_t c0, ui_color_t c1, int64_t i,
+                int64_t n) = rc->linear ? linear.lerp : raster_lerp;
+            if (vertical) {
+                for (int32_t j = cy; j < cy + ch; j++) {
+                    const uint32_t c = lerp(rgba_from, rgba_to, j - y, h - 1);
+                    raster_fill_span(raster_row(rc, j) + cx, cw, c);
+                }
+            } else {
+                uint32_t* span = raster_row(rc, cy) + cx;
+                for (int32_t i = 0; i < cw; i++) {
+                    span[i] = lerp(rgba_from, rgba_to, cx + i - x, w - 1);
+                }
+                for (int32_t j = cy + 1; j < cy + ch; j++) {
+                    memcpy(raster_row(rc, j) + cx, span, cw * sizeof(uint32_t));
+                }
+            }
+        }
+    }
+}
+
+static inline uint32_t raster_fetch(const uint8_t* p, int32_t bpp,
+        bool opaque) {
+    switch (bpp) {
+        case 1: return 0xFF000000u | p[0] * 0x010101u;
+        case 3: return 0xFF000000u | p[0] | p[1] << 8 | p[2] << 16;
+        default: {
+            uint32_t bgra;
+            memcpy(&bgra, p, sizeof(bgra));
+            return opaque ? bgra | 0xFF000000u : bgra;
+        }
+    }
+}
+
+typedef struct raster_stretch_s {
+    raster_context_t* rc;
+    int32_t cx; // clipped destination
+    int32_t cy;
+    int32_t cw;
+    int32_t dy; // destination y and height
+    int32_t dh;
+    int32_t x;  // source rectangle
+    int32_t y;
+    int32_t h;
+    int32_t bpp;
+    int32_t stride;
+    const uint8_t* pixels;
+    const int32_t* xs; // source x for each destination x or null
+    bool opaque;
+    int32_t alpha;
+} raster_stretch_t;
+
+static void raster_stretch_band(void* that, int32_t j0, int32_t j1) {
+    raster_stretch_t* r = (raster_stretch_t*)that;
+    const int32_t ah = abs(r->h);
+    uint32_t* line = r->xs == null ?
+        null : (uint32_t*)alloca(r->cw * sizeof(uint32_t));
+    for (int32_t j = j0; j < j1; j++) {
+        const int32_t t = (int32_t)(((int64_t)(r->cy - r->dy + j) * 2 + 1) *
+                                    ah / (2 * r->dh));
+        const int32_t sy = r->h > 0 ? r->y + t : r->y + ah - 1 - t;
+        const uint8_t* row = r->pixels + (int64_t)sy * r->stride;
+        const uint32_t* src = null;
+        if (r->xs == null) {
+            src = (const uint32_t*)row + r->x;
+        } else {
+            for (int32_t i = 0; i < r->cw; i++) {
+                line[i] = raster_fetch(row + r->xs[i] * r->bpp, r->bpp,
+                                       r->opaque);
+            }
+            src = line;
+        }
+        uint32_t* d = raster_row(r->rc, r->cy + j) + r->cx;
+        if (r->alpha < 0) {
+            memcpy(d, src, r->cw * sizeof(uint32_t));
+        } else if (r->rc->linear) {
+            linear.blend_span(d, src, r->cw, r->alpha);
+        } else {
+            raster_blend_span(d, src, r->cw, r->alpha);
+        }
+    }
+}
+
+// raster_stretch() nearest neighbor scaling of (x, y, w, h) rectangle
+// of source pixels into destination (dx, dy, dw, dh) rectangle.
+// h < 0 flips source vertically. alpha < 0 copies pixels otherwise
+// premultiplied source is blended over destination with constant
+// alpha. `opaque` ignores alpha of 4 bytes per pixel source.
+// Large destinations are processed in parallel bands of rows.
+
+static void raster_stretch(raster_context_t* rc,
+        int32_t dx, int32_t dy, int32_t dw, int32_t dh,
+        int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t bpp, int32_t stride, const uint8_t* pixels,
+        bool opaque, int32_t alpha) {
+    int32_t cx = dx;
+    int32_t cy = dy;
+    int32_t cw = dw;
+    int32_t ch = dh;
+    if (dw > 0 && dh > 0 && w > 0 && h != 0 &&
+        raster_clip(rc, &cx, &cy, &cw, &ch)) {
+        const bool direct = bpp == 4 && !opaque && w == dw && h == dh;
+        int32_t* xs = direct ? null : (int32_t*)malloc(cw * sizeof(int32_t));
+        fatal_if(!direct && xs == null);
+        for (int32_t i = 0; !direct && i < cw; i++) {
+            xs[i] = x + (int32_t)(((int64_t)(cx - dx + i) * 2 + 1) * w / (2 * dw));
+        }
+        raster_stretch_t r = {
+            .rc = rc, .cx = cx, .cy = cy, .cw = cw, .dy = dy, .dh = dh,
+            .x = direct ? x + cx - dx : x, .y = y, .h = h,
+            .bpp = bpp, .stride = stride, .pixels = pixels, .xs = xs,
+            .opaque = opaque, .alpha = alpha
+        };
+        conversions.bands(&r, raster_stretch_band, cw, ch);
+        free(xs);
+    }
+}
+
+static void raster_draw_greyscale(int32_t sx, int32_t sy, int32_t sw,
+        int32_t sh, int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.draw_greyscale(sx, sy, sw, sh, x, y, w, h,
+                                  iw, ih, stride, pixels);
+    } else {
+        fatal_if(stride != ((iw + 3) & ~0x3));
+        (void)ih;
+        raster_stretch(rc, sx, sy, sw, sh, x, y, w, h, 1, stride, pixels,
+                       true, -1);
+    }
+}
+
+static void raster_draw_bgr(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+        int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.draw_bgr(sx, sy, sw, sh, x, y, w, h,
+                            iw, ih, stride, pixels);
+    } else {
+        fatal_if(stride != ((iw * 3 + 3) & ~0x3));
+        (void)ih;
+        raster_stretch(rc, sx, sy, sw, sh, x, y, w, h, 3, stride, pixels,
+                       true, -1);
+    }
+}
+
+static void raster_draw_bgrx(int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+        int32_t x, int32_t y, int32_t w, int32_t h,
+        int32_t iw, int32_t ih, int32_t stride, const uint8_t* pixels) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.draw_bgrx(sx, sy, sw, sh, x, y, w, h,
+                             iw, ih, stride, pixels);
+    } else {
+        fatal_if(stride != ((iw * 4 + 3) & ~0x3));
+        (void)ih;
+        raster_stretch(rc, sx, sy, sw, sh, x, y, w, h, 4, stride, pixels,
+                       true, -1);
+    }
+}
+
+static void raster_alpha_blend(int32_t x, int32_t y, int32_t w, int32_t h,
+        image_t* image, double alpha) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.alpha_blend(x, y, w, h, image, alpha);
+    } else {
+        assert(image->bpp > 0);
+        assert(0 <= alpha && alpha <= 1);
+        const int32_t a = (int32_t)(0xFF * alpha + 0.49);
+        raster_stretch(rc, x, y, w, h, 0, 0, image->w, image->h,
+            image->bpp, image->stride, (const uint8_t*)image->pixels,
+            false, a);
+    }
+}
+
+static void raster_draw_image(int32_t x, int32_t y, int32_t w, int32_t h,
+        image_t* image) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.draw_image(x, y, w, h, image);
+    } else {
+        assert(image->bpp == 1 || image->bpp == 3 || image->bpp == 4);
+        raster_stretch(rc, x, y, w, h, 0, 0, image->w, image->h,
+            image->bpp, image->stride, (const uint8_t*)image->pixels,
+            false, -1);
+    }
+}
+
+static ui_font_t raster_set_font(ui_font_t f) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) { return raster_gdi.set_font(f); }
+    not_null(f);
+    const ui_font_t previous = rc->state.font;
+    rc->state.font = f;
+    return previous;
+}
+
+// raster_text_utf8() draws (or measures with DT_CALCRECT) k bytes of
+// UTF-8 text on memory DC of the context or by context glyphs
+
+static void raster_text_utf8(raster_context_t* rc, const char* text,
+        int32_t k, RECT* r, uint32_t flags) {
+    fatal_if(rc->dc == null && rc->glyphs == null,
+             "text needs image created by gdi.image_init()");
+    if (rc->glyphs != null) {
+        ui_point_t e = (flags & DT_CALCRECT) != 0 ?
+            glyphs.measure(rc->glyphs, text, k) :
+            glyphs.draw(rc->glyphs, rc->image, &rc->state.clip,
+                r->left, r->top, text, k, rc->state.text_color);
+        r->right = r->left + e.x;
+        r->bottom = r->top + e.y;
+        return;
+    }
+    // UTF-16 never needs more code units than UTF-8 bytes:
+    wchar_t* utf16 = (wchar_t*)alloca((k + 1) * sizeof(wchar_t));
+    int32_t count = 0;
+    if (k > 0) {
+        count = MultiByteToWideChar(CP_UTF8, 0, text, k, utf16, k);
+        fatal_if(count <= 0);
+    }
+    utf16[count] = 0;
+    HDC dc = (HDC)rc->dc;
+    ui_font_t font = rc->state.font != null ?
+        rc->state.font : app.fonts.regular;
+    if (font == null) { font = (ui_font_t)GetStockFont(DEFAULT_GUI_FONT); }
+    const ui_rect_t* c = &rc->state.clip;
+    fatal_if(SaveDC(dc) == 0);
+    IntersectClipRect(dc, c->x, c->y, c->x + c->w, c->y + c->h);
+    SelectFont(dc, (HFONT)font);
+    SetTextColor(dc, gdi_color_ref(rc->state.text_color));
+    SetBkMode(dc, TRANSPARENT);
+    if ((flags & DT_CALCRECT) == 0) {
+        DrawTextW(dc, utf16, count, r, flags | DT_CALCRECT);
+    }
+    DrawTextW(dc, utf16, count, r, flags);
+    fatal_if_false(RestoreDC(dc, -1));
+    GdiFlush(); // pixels are accessed directly by software rendering
+}
+
+// raster_text_draw() is gdi_text_draw() on memory DC of the context
+
+static void raster_text_draw(raster_context_t* rc, gdi_dtp_t* p) {
+    int32_t n = 1024;
+    char* text = (char*)alloca(n);
+    int32_t k = -1;
+    for (;;) { // each attempt formats from a fresh copy of p->vl
+        va_list vl;
+        va_copy(vl, p->vl);
+        str.vformat(text, n - 1, p->format, vl);
+        va_end(vl);
+        k = (int32_t)strlen(text);
+        if (0 <= k && k < n - 1) { break; }
+        n = n * 2;
+        text = (char*)alloca(n);
+    }
+    raster_text_utf8(rc, text, k, &p->rc, p->flags);
+}
+
+static void raster_vtext(const char* format, va_list vl) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.vtext(format, vl);
+    } else {
+        const raster_state_t* st = &rc->state;
+        gdi_dtp_t p = { null, format, vl, {st->x, st->y, 0, 0}, sl_draw };
+        raster_text_draw(rc, &p);
+        rc->state.x += p.rc.right - p.rc.left;
+    }
+}
+
+static void raster_vtextln(const char* format, va_list vl) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.vtextln(format, vl);
+    } else {
+        const raster_state_t* st = &rc->state;
+        gdi_dtp_t p = { null, format, vl, {st->x, st->y, st->x, st->y},
+                        sl_draw };
+        raster_text_draw(rc, &p);
+        rc->state.y += (int)((p.rc.bottom - p.rc.top) *
+                             gdi.height_multiplier + 0.5f);
+    }
+}
+
+// text_n() and textln_n() are not formatted (no str.vformat())
+
+static void raster_text_n(const char* s, int32_t n) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.text_n(s, n);
+    } else {
+        RECT r = { rc->state.x, rc->state.y, 0, 0 };
+        raster_text_utf8(rc, s, n, &r, sl_draw);
+        rc->state.x += r.right - r.left;
+    }
+}
+
+static void raster_textln_n(const char* s, int32_t n) {
+    raster_context_t* rc = raster_rc;
+    if (rc == null) {
+        raster_gdi.textln_n(s, n);
+    } else {
+        RECT r = { rc->state.x, rc->state.y, rc->state.x, rc->state.y };
+        raster_text_utf8(rc, s, n, &r, sl_draw);
+        rc->state.y += (int)((r.bottom - r.top) *
+                             gdi.height_multiplier + 0.5f);
+    }
+}
+
+static gdi_xy_t raster_position(void) {
+    raster_context_t* rc = raster_rc;
+    return rc != null ? (gdi_xy_t){ &rc->state.x, &rc->state.y } :
+                        raster_gdi.position();
+}
+
+static ui_point_t raster_multiline(int32_t w, const char* f, ...) {
+    va_list vl;
+    va_start(vl, f);
+    uint32_t flags = w <= 0 ? ml_draw : ml_draw_break;
+    raster_context_t* rc = raster_rc;
+    const gdi_xy_t xy = raster_position();
+    gdi_dtp_t p = { null, f, vl, {*xy.x, *xy.y, *xy.x + (w <= 0 ? 1 : w),
+                    *xy.y}, flags };
+    if (rc == null) {
+        gdi_text_draw(&p);
+    } else {
+        raster_text_draw(rc, &p);
+    }
+    va_end(vl);
+    ui_point_t c = { p.rc.right - p.rc.left, p.rc.bottom - p.rc.top };
+    return c;
+}
+
+// Polygon coverage is accumulated as exact signed area of the edges in
+// the cells of clipped bounding box and prefix summed along the rows:
+// |sum| clamped to 1 is non-zero winding coverage.
+
+typedef struct raster_area_s {
+    float* a; // [h][w + 2] the last edge column may spill over w
+    int32_t w;
+    int32_t h;
+} raster_area_t;
+
+// raster_area_line() accumulates the area of 0 <= x0, x1 <= w segment
+
+static void raster_area_line(raster_area_t* ar, double x0, double y0,
+        double x1, double y1) {
+    if (y0 == y1) { return; }
+    double dir = 1;
+    if (y0 > y1) {
+        double t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+        dir = -1;
+    }
+    const double dxdy = (x1 - x0) / (y1 - y0);
+    double x = y0 < 0 ? x0 - y0 * dxdy : x0;
+    const int32_t y_end = (int32_t)min((double)ar->h, ceil(y1));
+    for (int32_t y = (int32_t)max(0.0, floor(y0)); y < y_end; y++) {
+        float* a = ar->a + (int64_t)y * (ar->w + 2);
+        const double dy = min(y + 1.0, y1) - max((double)y, y0);
+        const double xn = x + dxdy * dy;
+        const double d = dy * dir;
+        const double xa = min(x, xn);
+        const double xb = max(x, xn);
+        const double xa_floor = floor(xa);
+        const double xb_ceil = ceil(xb);
+        const int32_t ia = (int32_t)xa_floor;
+        const int32_t ib = (int32_t)xb_ceil;
+        if (ib <= ia + 1) { // within one cell
+            const double xm = 0.5 * (x + xn) - xa_floor;
+            a[ia] += (float)(d - d * xm);
+            a[ia + 1] += (float)(d * xm);
+        } else {
+            const double s = 1 / (xb - xa);
+            const double fa = xa - xa_floor;
+            const double a0 = 0.5 * s * (1 - fa) * (1 - fa);
+            const double fb = xb - xb_ceil + 1;
+            const double am = 0.5 * s * fb * fb;
+            a[ia] += (float)(d * a0);
+            if (ib == ia + 2) {
+                a[ia + 1] += (float)(d * (1 - a0 - am));
+            } else {
+                const double a1 = s * (1.5 - fa);
+                a[ia + 1] += (float)(d * (a1 - a0));
+                for (int32_t i = ia + 2; i < ib - 1; i++) { a[i] += (float)(d * s); }
+                const double a2 = a1 + (ib - ia - 3) * s;
+                a[ib - 1] += (float)(d * (1 - a2 - am));
+            }
+            a[ib] += (float)(d * am);
+        }
+        x = xn;
+    }
+}
+
+// raster_area_edge() parts of the edge left or right of the box are
+// projected on its vertical sides: they still change the winding of all
+// pixels to the right of them
+
+static void raster_area_edge(raster_area_t* ar, double x0, double y0,
+        double x1, double y1) {
+    double t[4] = { 0, 1 };
+    int32_t n = 2;
+    if (x0 != x1) {
+        const double bounds[2] = { 0, ar->w };
+        for (int32_t k = 0; k < 2; k++) {
+            const double tk = (bounds[k] - x0) / (x1 - x0);
+            if (0 < tk && tk < 1) {
+                int32_t i = n++;
+                while (t[i - 1] > tk) { t[i] = t[i - 1]; i--; }
+                t[i] = tk;
+            }
+        }
+    }
+    for (int32_t k = 0; k < n - 1; k++) {
+        const double xa = min((double)ar->w, max(0.0, x0 + t[k] * (x1 - x0)));
+        const double xb = min((double)ar->w, max(0.0, x0 + t[k + 1] * (x1 - x0)));
+        raster_area_line(ar, xa, y0 + t[k] * (y1 - y0),
+                             xb, y0 + t[k + 1] * (y1 - y0));
+    }
+}
+
+static void raster_polygon(const raster_vertex_t* v, int32_t count) {
+    raster_context_t* rc = raster_rc;
+    fatal_if(rc == null, "raster.begin() not called");
+    uint32_t c = 0;
+    if (count < 3 || !raster_brush(rc, &c)) { return; }
+    const ui_rect_t* clip = &rc->state.clip;
+    double x0 = v[0].x;
+    double y0 = v[0].y;
+    double x1 = v[0].x;
+    double y1 = v[0].y;
+    for (int32_t i = 1; i < count; i++) {
+        x0 = min(x0, v[i].x);
+        y0 = min(y0, v[i].y);
+        x1 = max(x1, v[i].x);
+        y1 = max(y1, v[i].y);
+    }
+    // bounding box clipped before conversion to integers:
+    x0 = max(x0, (double)clip->x);
+    y0 = max(y0, (double)clip->y);
+    x1 = min(x1, (double)(clip->x + clip->w));
+    y1 = min(y1, (double)(clip->y + clip->h));
+    if (!(x0 < x1 && y0 < y1)) { return; } // also NaN
+    const int32_t bx = (int32_t)floor(x0);
+    const int32_t by = (int32_t)floor(y0);
+    raster_area_t ar = {
+        .w = (int32_t)ceil(x1) - bx,
+        .h = (int32_t)ceil(y1) - by
+    };
+    ar.a = (float*)calloc((size_t)(ar.w + 2) * ar.h, sizeof(float));
+    fatal_if_null(ar.a);
+    for (int32_t i = 0; i < count; i++) {
+        const raster_vertex_t* p = &v[i];
+        const raster_vertex_t* q = &v[i + 1 < count ? i + 1 : 0];
+        raster_area_edge(&ar, p->x - bx, p->y - by, q->x - bx, q->y - by);
+    }
+    uint8_t* cover = (uint8_t*)malloc((size_t)ar.w);
+    fatal_if_null(cover);
+    for (int32_t j = 0; j < ar.h; j++) {
+        const float* a = ar.a + (int64_t)j * (ar.w + 2);
+        float sum = 0;
+        for (int32_t i = 0; i < ar.w; i++) {
+            sum += a[i];
+            const float f = fabsf(sum);
+            cover[i] = f >= 1 ? 255 : (uint8_t)(f * 255 + 0.5f);
+        }
+        raster_cover_span(raster_row(rc, by + j) + bx, cover, ar.w, c);
+    }
+    free(cover);
+    free(ar.a);
+}
+
+// raster_install() is called once by app on the main thread before any
+// other thread exists (see app_install_gdi()): gdi.* function pointers
+// are never written while threads may call through them.
+
+static void raster_install(void) {
+    fatal_if(raster_gdi.fill != null, "installed twice");
+    raster_gdi = gdi;
+    gdi.set_text_color  = raster_set_text_color;
+    gdi.create_brush    = raster_create_brush;
+    gdi.delete_brush    = raster_delete_brush;
+    gdi.set_brush_color = raster_set_brush_color;
+    gdi.set_brush       = raster_set_brush;
+    gdi.set_colored_pen = raster_set_colored_pen;
+    gdi.create_pen      = raster_create_pen;
+    gdi.set_pen         = raster_set_pen;
+    gdi.delete_pen      = raster_delete_pen;
+    gdi.set_clip        = raster_set_clip;
+    gdi.intersect_clip  = raster_intersect_clip;
+    gdi.visible         = raster_visible;
+    gdi.push            = raster_push;
+    gdi.pop             = raster_pop;
+    gdi.pixel           = raster_pixel;
+    gdi.move_to         = raster_move_to;
+    gdi.line            = raster_line;
+    gdi.rect            = raster_rect;
+    gdi.fill            = raster_fill;
+    gdi.poly            = raster_poly;
+    gdi.polygon         = raster_polyfill;
+    gdi.rounded         = raster_rounded;
+    gdi.gradient        = raster_gradient;
+    gdi.draw_greyscale  = raster_draw_greyscale;
+    gdi.draw_bgr        = raster_draw_bgr;
+    gdi.draw_bgrx       = raster_draw_bgrx;
+    gdi.alpha_blend     = raster_alpha_blend;
+    gdi.draw_image      = raster_draw_image;
+    gdi.set_font        = raster_set_font;
+    gdi.vtext           = raster_vtext;
+    gdi.vtextln         = raster_vtextln;
+    gdi.text_n          = raster_text_n;
+    gdi.textln_n        = raster_textln_n;
+    gdi.multiline       = raster_multiline;
+    gdi.position        = raster_position;
+}
+
+static void raster_begin(raster_context_t* rc, image_t* image) {
+    fatal_if(image->bpp != 4 || image->pixels == null, "bpp: %d", image->bpp);
+    fatal_if(raster_gdi.fill == null, "raster_install() not called");
+    memset(rc, 0, sizeof(*rc));
+    rc->image = image;
+    rc->state.clip = (ui_rect_t){0, 0, image->w, image->h};
+    rc->state.brush = gdi.brush_color;
+    rc->state.brush_color = rgb(255, 255, 255); // Win32 DC defaults
+    rc->state.pen = (ui_pen_t)&raster_dc_pen;
+    rc->state.pen_color = rgb(0, 0, 0);
+    rc->state.pen_width = 1;
+    rc->state.text_color = rgb(0, 0, 0);
+    rc->state.font = app.fonts.regular;
+    if (image->bitmap != null) {
+        HDC dc = CreateCompatibleDC(null);
+        not_null(dc);
+        rc->bitmap = (ui_bitmap_t)SelectBitmap(dc, (HBITMAP)image->bitmap);
+        rc->dc = (ui_canvas_t)dc;
+    }
+    GdiFlush(); // complete pending GDI drawing into image
+    gdi_scaled_invalidate(image); // scaled copies of image become stale
+    rc->previous = raster_rc;
+    raster_rc = rc;
+}
+
+static void raster_end(void) {
+    raster_context_t* rc = raster_rc;
+    not_null(rc);
+    assert(rc->top == 0, "unbalanced push/pop: %d", rc->top);
+    gdi_scaled_invalidate(rc->image); // drawn while inside begin()
+    if (rc->dc != null) {
+        SelectBitmap((HDC)rc->dc, (HBITMAP)rc->bitmap);
+        fatal_if_false(DeleteDC((HDC)rc->dc));
+        rc->dc = null;
+    }
+    raster_rc = rc->previous;
+}
+
+static raster_context_t* raster_current(void) { return raster_rc; }
+
+raster_if raster = {
+    .begin      = raster_begin,
+    .end        = raster_end,
+    .current    = raster_current,
+    .fill_span  = raster_fill_span,
+    .blend_span = raster_blend_span,
+    .cover_span = raster_cover_span,
+    .polygon    = raster_polygon
+};
@@ -0,0 +1,343 @@
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define resample_sse2
+#endif
+
+enum { resample_bits = 14 }; // fixed point weights sum to 1 << 14
+
+typedef struct resample_weights_s {
+    int32_t taps;   // weights per destination pixel
+    int32_t* start; // [n] first source pixel, start + taps <= source size
+    int16_t* w;     // [n][taps]
+} resample_weights_t;
+
+typedef struct resample_s {
+    uint8_t* d;
+    int32_t dw;
+    int32_t dh;
+    int32_t d_stride;
+    const uint8_t* s;
+    int32_t sw;
+    int32_t sh;
+    int32_t s_stride;
+    uint8_t* t; // [sh][dw] result of horizontal pass
+    int32_t t_stride;
+    resample_weights_t x;
+    resample_weights_t y;
+} resample_t;
+
+static double resample_support(int32_t filter) {
+    switch (filter) {
+        case resample_box    : return 0.5;
+        case resample_bicubic: return 2.0;
+        case resample_lanczos: return 3.0;
+        default: fatal_if(true, "filter: %d", filter); return 0;
+    }
+}
+
+static double resample_sinc(double x) {
+    x *= M_PI;
+    return x == 0 ? 1.0 : sin(x) / x;
+}
+
+static double resample_kernel(int32_t filter, double x) {
+    if (filter == resample_box) {
+        return -0.5 <= x && x < 0.5 ? 1.0 : 0.0;
+    } else if (filter == resample_bicubic) { // Catmull-Rom a = -0.5
+        const double a = -0.5;
+        x = fabs(x);
+        if (x < 1.0) { return ((a + 2) * x - (a + 3)) * x * x + 1; }
+        if (x < 2.0) { return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a; }
+        return 0.0;
+    } else {
+        assert(filter == resample_lanczos);
+        return -3.0 < x && x < 3.0 ? resample_sinc(x) * resample_sinc(x / 3) : 0;
+    }
+}
+
+static void resample_weights(resample_weights_t* rw, int32_t filter,
+        int32_t dn, int32_t sn) {
+    if (filter == resample_auto) {
+        filter = dn < sn ? resample_box : resample_bicubic;
+    }
+    const double scale = max(1.0, (double)sn / dn); // stretch kernel to shrink
+    const double support = resample_support(filter) * scale;
+    const int32_t taps = min((int32_t)ceil(support) * 2 + 1, sn);
+    rw->taps = taps;
+    rw->start = (int32_t*)malloc(dn * sizeof(int32_t));
+    rw->w = (int16_t*)calloc((size_t)dn * taps, sizeof(int16_t));
+    double* f = (double*)malloc(taps * sizeof(double));
+    fatal_if(rw->start == null || rw->w == null || f == null);
+    for (int32_t i = 0; i < dn; i++) {
+        const double center = (i + 0.5) * sn / dn;
+        const int32_t x0 = max(0, (int32_t)floor(center - support + 0.5));
+        const int32_t x1 = min(min(sn, (int32_t)floor(center + support + 0.5)),
+                               x0 + taps);
+        double sum = 0;
+        for (int32_t x = x0; x < x1; x++) {
+            f[x - x0] = resample_kernel(filter, (x + 0.5 - center) / scale);
+            sum += f[x - x0];
+        }
+        const int32_t start = min(x0, sn - taps);
+        int16_t* w = rw->w + (int64_t)i * taps;
+        int32_t total = 0;
+        int32_t peak = x0 - start; // largest weight absorbs rounding error
+        for (int32_t x = x0; x < x1 && sum != 0; x++) {
+            const int32_t v = (int32_t)floor(f[x - x0] / sum *
+                                             (1 << resample_bits) + 0.5);
+            w[x - start] = (int16_t)v;
+            total += v;
+            if (abs(v) > abs(w[peak])) { peak = x - start; }
+        }
+        w[peak] = (int16_t)(w[peak] + (1 << resample_bits) - total);
+        rw->start[i] = start;
+    }
+    free(f);
+}
+
+static void resample_weights_dispose(resample_weights_t* rw) {
+    free(rw->start);
+    free(rw->w);
+}
+
+// `taps` pixels `step` bytes apart -> premultiplied BGRA pixel
+
+static uint32_t resample_pixel(const uint8_t* p, int32_t step,
+        const int16_t* w, int32_t taps) {
+    int32_t c[4] = { 1 << (resample_bits - 1), 1 << (resample_bits - 1),
+                     1 << (resample_bits - 1), 1 << (resample_bits - 1) };
+    for (int32_t k = 0; k < taps; k++) {
+        const uint8_t* q = p + (int64_t)k * step;
+        c[0] += q[0] * w[k];
+        c[1] += q[1] * w[k];
+        c[2] += q[2] * w[k];
+        c[3] += q[3] * w[k];
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        c[i] = min(max(c[i] >> resample_bits, 0), 255);
+    }
+    // bicubic and Lanczos ring: keep premultiplied colors <= alpha
+    return (uint32_t)min(c[0], c[3]) | (uint32_t)min(c[1], c[3]) << 8 |
+           (uint32_t)min(c[2], c[3]) << 16 | (uint32_t)c[3] << 24;
+}
+
+#ifdef resample_sse2
+
+static inline __m128i resample_pair(int16_t w0, int16_t w1) {
+    return _mm_set1_epi32((int32_t)((uint32_t)(uint16_t)w0 |
+                                    (uint32_t)(uint16_t)w1 << 16));
+}
+
+// packs 4 pixels of int32 channels and clamps colors to alpha
+
+static inline __m128i resample_pack(__m128i p0, __m128i p1, __m128i p2,
+        __m128i p3) {
+    p0 = _mm_srai_epi32(p0, resample_bits);
+    p1 = _mm_srai_epi32(p1, resample_bits);
+    p2 = _mm_srai_epi32(p2, resample_bits);
+    p3 = _mm_srai_epi32(p3, resample_bits);
+    const __m128i v = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                       _mm_packs_epi32(p2, p3));
+    __m128i a = _mm_srli_epi32(v, 24);
+    a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+    a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+    return _mm_min_epu8(v, a);
+}
+
+#endif
+
+static void resample_row(uint32_t* d, const uint32_t* s,
+        const resample_weights_t* rw, int32_t dn) {
+    const int32_t taps = rw->taps;
+    for (int32_t i = 0; i < dn; i++) {
+        const uint32_t* p = s + rw->start[i];
+        const int16_t* w = rw->w + (int64_t)i * taps;
+        #ifdef resample_sse2
+            const __m128i z = _mm_setzero_si128();
+            __m128i acc = _mm_set1_epi32(1 << (resample_bits - 1));
+            int32_t k = 0;
+            for (; k + 2 <= taps; k += 2) { // b0 b1 g0 g1 r0 r1 a0 a1
+                const __m128i px = _mm_unpacklo_epi8(_mm_unpacklo_epi8(
+                    _mm_cvtsi32_si128((int32_t)p[k]),
+                    _mm_cvtsi32_si128((int32_t)p[k + 1])), z);
+                acc = _mm_add_epi32(acc,
+                    _mm_madd_epi16(px, resample_pair(w[k], w[k + 1])));
+            }
+            if (k < taps) {
+                const __m128i px = _mm_unpacklo_epi8(
+                    _mm_cvtsi32_si128((int32_t)p[k]), z);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(
+                    _mm_unpacklo_epi16(px, z), resample_pair(w[k], 0)));
+            }
+            d[i] = (uint32_t)_mm_cvtsi128_si32(resample_pack(acc, acc, acc, acc));
+        #else
+            d[i] = resample_pixel((const uint8_t*)p, 4, w, taps);
+        #endif
+    }
+}
+
+static void resample_column(uint32_t* d, const uint8_t* s, int32_t stride,
+        const int16_t* w, int32_t taps, int32_t n) {
+    int32_t x = 0;
+    #ifdef resample_sse2
+        const __m128i z = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(1 << (resample_bits - 1));
+        for (; x + 4 <= n; x += 4) {
+            __m128i p0 = round;
+            __m128i p1 = round;
+            __m128i p2 = round;
+            __m128i p3 = round;
+            for (int32_t k = 0; k < taps; k += 2) {
+                const uint8_t* r = s + (int64_t)k * stride + x * 4;
+                const __m128i ra = _mm_loadu_si128((const __m128i*)r);
+                const __m128i rb = k + 1 < taps ?
+                    _mm_loadu_si128((const __m128i*)(r + stride)) : z;
+                const __m128i wk = resample_pair(w[k], k + 1 < taps ? w[k + 1] : 0);
+                const __m128i lo = _mm_unpacklo_epi8(ra, rb); // pixels 0, 1
+                const __m128i hi = _mm_unpackhi_epi8(ra, rb); // pixels 2, 3
+                p0 = _mm_add_epi32(p0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, z), wk));
+                p1 = _mm_add_epi32(p1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, z), wk));
+                p2 = _mm_add_epi32(p2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, z), wk));
+                p3 = _mm_add_epi32(p3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, z), wk));
+            }
+            _mm_storeu_si128((__m128i*)(d + x), resample_pack(p0, p1, p2, p3));
+        }
+    #endif
+    for (; x < n; x++) { d[x] = resample_pixel(s + x * 4, stride, w, taps); }
+}
+
+static void resample_horizontal_band(void* that, int32_t y0, int32_t y1) {
+    resample_t* r = (resample_t*)that;
+    for (int32_t y = y0; y < y1; y++) {
+        resample_row((uint32_t*)(r->t + (int64_t)y * r->t_stride),
+            (const uint32_t*)(r->s + (int64_t)y * r->s_stride), &r->x, r->dw);
+    }
+}
+
+static void resample_vertical_band(void* that, int32_t y0, int32_t y1) {
+    resample_t* r = (resample_t*)that;
+    const int32_t taps = r->y.taps;
+    for (int32_t y = y0; y < y1; y++) {
+        resample_column((uint32_t*)(r->d + (int64_t)y * r->d_stride),
+            r->t + (int64_t)r->y.start[y] * r->t_stride, r->t_stride,
+            r->y.w + (int64_t)y * taps, taps, r->dw);
+    }
+}
+
+static void resample_bgra(uint8_t* d, int32_t dw, int32_t dh, int32_t d_stride,
+        const uint8_t* s, int32_t sw, int32_t sh, int32_t s_stride,
+        int32_t filter) {
+    assert(dw > 0 && dh > 0 && sw > 0 && sh > 0);
+    resample_t r = { d, dw, dh, d_stride, s, sw, sh, s_stride };
+    if (dw == sw) { // no horizontal pass
+        r.t = (uint8_t*)s;
+        r.t_stride = s_stride;
+    } else {
+        resample_weights(&r.x, filter, dw, sw);
+        if (dh == sh) { // no vertical pass
+            r.t = d;
+            r.t_stride = d_stride;
+        } else {
+            r.t_stride = dw * 4;
+            r.t = (uint8_t*)malloc((size_t)r.t_stride * sh);
+            fatal_if_null(r.t);
+        }
+        conversions.bands(&r, resample_horizontal_band, dw * r.x.taps, sh);
+        resample_weights_dispose(&r.x);
+    }
+    if (dh != sh) {
+        resample_weights(&r.y, filter, dh, sh);
+        conversions.bands(&r, resample_vertical_band, dw * r.y.taps, dh);
+        resample_weights_dispose(&r.y);
+    } else if (dw == sw) {
+        for (int32_t y = 0; y < dh; y++) {
+            memcpy(d + (int64_t)y * d_stride, s + (int64_t)y * s_stride, dw * 4);
+        }
+    }
+    if (r.t != s && r.t != d) { free(r.t); }
+}
+
+typedef struct resample_half_s {
+    uint8_t* d;
+    int32_t d_stride;
+    const uint8_t* s;
+    int32_t sw;
+    int32_t sh;
+    int32_t s_stride;
+    bool gamma; // average in linear light (see linear.h)
+} resample_half_t;
+
+static uint32_t resample_half_pixel(const resample_half_t* h,
+        const uint8_t* r0, const uint8_t* r1, int32_t x0, int32_t x1) {
+    uint32_t p = 0;
+    if (h->gamma) {
+        // premultiplied colors: decode(c * a) != decode(c) * a thus
+        // pixels are unpacked to premultiplied linear light first
+        const uint8_t* q[4] = { r0 + x0 * 4, r0 + x1 * 4,
+                                r1 + x0 * 4, r1 + x1 * 4 };
+        uint32_t sum[4] = {0};
+        for (int32_t i = 0; i < 4; i++) {
+            uint32_t v;
+            memcpy(&v, q[i], sizeof(v));
+            uint32_t c[4];
+            linear_unpack(v, c);
+            for (int32_t k = 0; k < 4; k++) { sum[k] += c[k]; }
+        }
+        for (int32_t k = 0; k < 4; k++) { sum[k] = (sum[k] + 2) >> 2; }
+        p = linear_pack(sum);
+    } else {
+        for (int32_t c = 0; c < 4; c++) {
+            const uint32_t v = (r0[x0 * 4 + c] + r0[x1 * 4 + c] +
+                                r1[x0 * 4 + c] + r1[x1 * 4 + c] + 2) >> 2;
+            p |= v << (c * 8);
+        }
+    }
+    return p;
+}
+
+static void resample_half_band(void* that, int32_t y0, int32_t y1) {
+    const resample_half_t* h = (const resample_half_t*)that;
+    const int32_t dw = (h->sw + 1) / 2;
+    for (int32_t y = y0; y < y1; y++) {
+        const uint8_t* r0 = h->s + (int64_t)y * 2 * h->s_stride;
+        const uint8_t* r1 = y * 2 + 1 < h->sh ? r0 + h->s_stride : r0;
+        uint32_t* d = (uint32_t*)(h->d + (int64_t)y * h->d_stride);
+        int32_t x = 0;
+        #ifdef resample_sse2
+            if (!h->gamma) {
+                const __m128i z = _mm_setzero_si128();
+                const __m128i two = _mm_set1_epi16(2);
+                for (; x * 2 + 4 <= h->sw; x += 2) { // 4x2 -> 2x1 pixels
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(r0 + x * 8));
+                    const __m128i b = _mm_loadu_si128((const __m128i*)(r1 + x * 8));
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, z),
+                                               _mm_unpacklo_epi8(b, z));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, z),
+                                               _mm_unpackhi_epi8(b, z));
+                    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                    __m128i v = _mm_unpacklo_epi64(lo, hi);
+                    v = _mm_srli_epi16(_mm_add_epi16(v, two), 2);
+                    _mm_storel_epi64((__m128i*)(d + x), _mm_packus_epi16(v, v));
+                }
+            }
+        #endif
+        for (; x < dw; x++) {
+            d[x] = resample_half_pixel(h, r0, r1, x * 2,
+                                       min(x * 2 + 1, h->sw - 1));
+        }
+    }
+}
+
+static void resample_half(uint8_t* d, int32_t d_stride, const uint8_t* s,
+        int32_t sw, int32_t sh, int32_t s_stride, bool gamma) {
+    assert(sw > 0 && sh > 0);
+    if (gamma) { linear_init(); }
+    resample_half_t h = { d, d_stride, s, sw, sh, s_stride, gamma };
+    conversions.bands(&h, resample_half_band, (sw + 1) / 2, (sh + 1) / 2);
+}
+
+resample_if resample = {
+    .bgra = resample_bgra,
+    .half = resample_half
+};
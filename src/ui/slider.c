@@ -27,7 +27,7 @@ static void ui_slider_paint(ui_view_t* view) {
     assert(view->type == ui_view_slider);
     ui_slider_t* r = (ui_slider_t*)view;
     gdi.push(view->x, view->y);
-    gdi.set_clip(view->x, view->y, view->w, view->h);
+    gdi.intersect_clip(view->x, view->y, view->w, view->h); // until pop()
     const int32_t em = view->em.x;
     const int32_t em2  = max(1, em / 2);
     const int32_t em4  = max(1, em / 8);
@@ -55,7 +55,6 @@ static void ui_slider_paint(ui_view_t* view) {
     gdi.x += r->dec.view.w + em;
     const char* format = app.nls(view->text);
     gdi.text(format, r->value);
-    gdi.set_clip(0, 0, 0, 0);
     gdi.delete_pen(pen_grey30);
     gdi.delete_pen(pen_grey45);
     gdi.pop();